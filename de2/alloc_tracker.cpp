@@ -0,0 +1,245 @@
+#include "pch.h"
+#include "alloc_tracker.h"
+#include <new>
+#include <cstdlib>
+#include <thread>
+#include <iostream>
+#ifdef _WIN32
+#include <Windows.h>
+#include <DbgHelp.h>
+#pragma comment(lib, "dbghelp.lib")
+#else
+#include <execinfo.h>
+#endif
+
+namespace {
+	struct alignas(64) thread_slot {
+		std::atomic<uint64_t> allocations{ 0 }, bytes{ 0 }, frees{ 0 };
+		std::atomic<uint64_t> thread_id{ 0 };
+	};
+	//term: constant initialized, the hook may run before any dynamic initializer
+	thread_slot slots[alloc_tracker::max_threads];
+	std::atomic<size_t> next_slot{ 0 };
+
+	//term: trivially constructible thread locals, touching them never allocates
+	thread_local int slot_index = -1;
+	thread_local int scope_depth = 0;
+	thread_local bool in_hook = false;
+
+	std::mutex handler_mutex;
+	std::function<void(const std::string&)> violation_handler;
+
+	//term: threads beyond max_threads share the last slot
+	thread_slot& own_slot() {
+		if (slot_index < 0) {
+			size_t i = std::min(next_slot.fetch_add(1, std::memory_order_relaxed), alloc_tracker::max_threads - 1);
+			slot_index = (int)i;
+			slots[i].thread_id.store(std::hash<std::thread::id>{}(std::this_thread::get_id()), std::memory_order_relaxed);
+		}
+		return slots[slot_index];
+	}
+
+	std::string capture_stack(int skip) {
+		std::ostringstream out;
+#ifdef _WIN32
+		static std::mutex sym_mutex;
+		std::unique_lock<std::mutex> lock(sym_mutex);
+		HANDLE process = GetCurrentProcess();
+		static bool sym_ready = [process]() {
+			SymSetOptions(SYMOPT_UNDNAME | SYMOPT_DEFERRED_LOADS | SYMOPT_LOAD_LINES);
+			return SymInitialize(process, nullptr, TRUE) == TRUE;
+		}();
+
+		void* frames[48];
+		USHORT n = CaptureStackBackTrace(skip, 48, frames, nullptr);
+		alignas(SYMBOL_INFO) char buffer[sizeof(SYMBOL_INFO) + 256];
+		SYMBOL_INFO* symbol = (SYMBOL_INFO*)buffer;
+		for (USHORT i = 0; i < n; i++) {
+			DWORD64 address = (DWORD64)frames[i];
+			out << "  #" << i << " 0x" << std::hex << address << std::dec;
+			symbol->SizeOfStruct = sizeof(SYMBOL_INFO);
+			symbol->MaxNameLen = 255;
+			DWORD64 offset = 0;
+			if (sym_ready && SymFromAddr(process, address, &offset, symbol))
+				out << " " << symbol->Name;
+			IMAGEHLP_LINE64 line{};
+			line.SizeOfStruct = sizeof(line);
+			DWORD line_offset = 0;
+			if (sym_ready && SymGetLineFromAddr64(process, address, &line_offset, &line))
+				out << " " << line.FileName << ":" << line.LineNumber;
+			out << "\n";
+		}
+#else
+		void* frames[48];
+		int n = backtrace(frames, 48);
+		if (char** names = backtrace_symbols(frames, n)) {
+			for (int i = skip; i < n; i++)
+				out << "  #" << i - skip << " " << names[i] << "\n";
+			std::free(names);
+		}
+#endif
+		return out.str();
+	}
+}
+
+std::atomic<bool> alloc_tracker::enabled_{ false };
+std::atomic<bool> alloc_tracker::strict_{ false };
+
+bool alloc_tracker::available() {
+#ifdef DE2_TRACK_ALLOCATIONS
+	return true;
+#else
+	return false;
+#endif
+}
+
+void alloc_tracker::set_violation_handler(std::function<void(const std::string& report)> handler) {
+	std::unique_lock<std::mutex> lock(handler_mutex);
+	violation_handler = std::move(handler);
+}
+
+alloc_tracker::counts alloc_tracker::current_thread() {
+	if (slot_index < 0)
+		return {};
+	thread_slot& s = slots[slot_index];
+	return { s.allocations.load(std::memory_order_relaxed), s.bytes.load(std::memory_order_relaxed), s.frees.load(std::memory_order_relaxed) };
+}
+alloc_tracker::counts alloc_tracker::all_threads() {
+	counts c;
+	size_t n = std::min(next_slot.load(std::memory_order_relaxed), max_threads);
+	for (size_t i = 0; i < n; i++) {
+		c.allocations += slots[i].allocations.load(std::memory_order_relaxed);
+		c.bytes += slots[i].bytes.load(std::memory_order_relaxed);
+		c.frees += slots[i].frees.load(std::memory_order_relaxed);
+	}
+	return c;
+}
+std::vector<alloc_tracker::thread_counts> alloc_tracker::per_thread() {
+	size_t n = std::min(next_slot.load(std::memory_order_relaxed), max_threads);
+	std::vector<thread_counts> result(n);
+	for (size_t i = 0; i < n; i++) {
+		result[i].thread_id = slots[i].thread_id.load(std::memory_order_relaxed);
+		result[i].total = { slots[i].allocations.load(std::memory_order_relaxed), slots[i].bytes.load(std::memory_order_relaxed),
+			slots[i].frees.load(std::memory_order_relaxed) };
+	}
+	return result;
+}
+
+alloc_tracker::no_alloc_scope::no_alloc_scope() {
+	scope_depth++;
+}
+alloc_tracker::no_alloc_scope::~no_alloc_scope() {
+	scope_depth--;
+}
+
+void alloc_tracker::on_alloc(size_t size) {
+	if (!enabled() || in_hook)
+		return;
+	thread_slot& s = own_slot();
+	s.allocations.fetch_add(1, std::memory_order_relaxed);
+	s.bytes.fetch_add(size, std::memory_order_relaxed);
+	if (scope_depth > 0 && strict())
+		report(size);
+}
+void alloc_tracker::on_free() {
+	if (!enabled() || in_hook)
+		return;
+	own_slot().frees.fetch_add(1, std::memory_order_relaxed);
+}
+
+void alloc_tracker::report(size_t size) {
+	//term: the report itself allocates, those allocations are neither counted nor reported; the stack starts at the caller of operator new
+	struct hook_guard {
+		hook_guard() { in_hook = true; }
+		~hook_guard() { in_hook = false; }
+	} guard;
+
+	std::string text = "alloc_tracker: " + std::to_string(size) + " byte allocation in a no_alloc_scope\n" + capture_stack(4);
+	std::function<void(const std::string&)> handler;
+	{
+		std::unique_lock<std::mutex> lock(handler_mutex);
+		handler = violation_handler;
+	}
+	if (handler)
+		handler(text);
+	else
+		std::cerr << text;
+}
+
+#ifdef DE2_TRACK_ALLOCATIONS
+namespace {
+	void* aligned_allocate(size_t size, std::align_val_t alignment) {
+		size_t a = (size_t)alignment;
+		size = size ? (size + a - 1) / a * a : a;
+#ifdef _WIN32
+		return _aligned_malloc(size, a);
+#else
+		return std::aligned_alloc(a, size);
+#endif
+	}
+	void aligned_release(void* p) {
+#ifdef _WIN32
+		_aligned_free(p);
+#else
+		std::free(p);
+#endif
+	}
+}
+
+void* operator new(size_t size) {
+	alloc_tracker::on_alloc(size);
+	if (void* p = std::malloc(size ? size : 1))
+		return p;
+	throw std::bad_alloc();
+}
+void* operator new[](size_t size) {
+	return operator new(size);
+}
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+	alloc_tracker::on_alloc(size);
+	return std::malloc(size ? size : 1);
+}
+void* operator new[](size_t size, const std::nothrow_t& tag) noexcept {
+	return operator new(size, tag);
+}
+void* operator new(size_t size, std::align_val_t alignment) {
+	alloc_tracker::on_alloc(size);
+	if (void* p = aligned_allocate(size, alignment))
+		return p;
+	throw std::bad_alloc();
+}
+void* operator new[](size_t size, std::align_val_t alignment) {
+	return operator new(size, alignment);
+}
+void* operator new(size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+	alloc_tracker::on_alloc(size);
+	return aligned_allocate(size, alignment);
+}
+void* operator new[](size_t size, std::align_val_t alignment, const std::nothrow_t& tag) noexcept {
+	return operator new(size, alignment, tag);
+}
+
+void operator delete(void* p) noexcept {
+	if (!p)
+		return;
+	alloc_tracker::on_free();
+	std::free(p);
+}
+void operator delete[](void* p) noexcept { operator delete(p); }
+void operator delete(void* p, size_t) noexcept { operator delete(p); }
+void operator delete[](void* p, size_t) noexcept { operator delete(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { operator delete(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { operator delete(p); }
+
+void operator delete(void* p, std::align_val_t) noexcept {
+	if (!p)
+		return;
+	alloc_tracker::on_free();
+	aligned_release(p);
+}
+void operator delete[](void* p, std::align_val_t alignment) noexcept { operator delete(p, alignment); }
+void operator delete(void* p, size_t, std::align_val_t alignment) noexcept { operator delete(p, alignment); }
+void operator delete[](void* p, size_t, std::align_val_t alignment) noexcept { operator delete(p, alignment); }
+void operator delete(void* p, std::align_val_t alignment, const std::nothrow_t&) noexcept { operator delete(p, alignment); }
+void operator delete[](void* p, std::align_val_t alignment, const std::nothrow_t&) noexcept { operator delete(p, alignment); }
+#endif
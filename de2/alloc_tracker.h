@@ -0,0 +1,46 @@
+#pragma once
+
+#include <atomic>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <functional>
+
+//term: replaces global operator new when compiled with DE2_TRACK_ALLOCATIONS, counting is off until enable(true)
+class alloc_tracker {
+public:
+	struct counts {
+		uint64_t allocations{ 0 }, bytes{ 0 }, frees{ 0 };
+		counts operator-(const counts& other) const { return { allocations - other.allocations, bytes - other.bytes, frees - other.frees }; }
+	};
+	struct thread_counts {
+		uint64_t thread_id{ 0 };
+		counts total;
+	};
+
+	static bool available();
+	static void enable(bool on) { enabled_.store(on, std::memory_order_relaxed); }
+	static bool enabled() { return enabled_.load(std::memory_order_relaxed); }
+	static void set_strict(bool on) { strict_.store(on, std::memory_order_relaxed); }
+	static bool strict() { return strict_.load(std::memory_order_relaxed); }
+	static void set_violation_handler(std::function<void(const std::string& report)> handler);
+
+	static counts current_thread();
+	static counts all_threads();
+	//term: exited threads keep their totals
+	static std::vector<thread_counts> per_thread();
+
+	//term: calling thread only, nests
+	struct no_alloc_scope {
+		no_alloc_scope();
+		~no_alloc_scope();
+	};
+
+	static void on_alloc(size_t size);
+	static void on_free();
+
+	static constexpr size_t max_threads = 64;
+protected:
+	static std::atomic<bool> enabled_, strict_;
+	static void report(size_t size);
+};
@@ -0,0 +1,170 @@
+#include "pch.h"
+#include "asset_pack.h"
+#include "lz4.h"
+#include <cstring>
+#include <fstream>
+#include <algorithm>
+#include <filesystem>
+#include <stdexcept>
+
+namespace {
+	const char pack_magic[8] = { 'D', 'E', '2', 'P', 'A', 'C', 'K', 0 };
+	const uint32_t pack_version = 1;
+
+	struct pack_header {
+		char magic[8];
+		uint32_t version;
+		uint32_t entry_count;
+		uint64_t index_offset;
+		uint64_t index_size;
+	};
+
+	template<typename T> T read_at(const unsigned char* p) {
+		T v;
+		memcpy(&v, p, sizeof(T));
+		return v;
+	}
+	template<typename T> void write_pod(std::ofstream& f, const T& v) {
+		f.write((const char*)&v, sizeof(T));
+	}
+}
+
+asset_pack::asset_pack(const std::string& path) : path_(path) {
+	file_ = std::make_unique<mapped_file>(path);
+	if (file_->size() < sizeof(pack_header))
+		throw std::runtime_error("asset_pack: file too small: " + path);
+
+	pack_header h = read_at<pack_header>(file_->data());
+	if (memcmp(h.magic, pack_magic, sizeof(pack_magic)) != 0 || h.version != pack_version)
+		throw std::runtime_error("asset_pack: bad header: " + path);
+
+	auto idx = file_->span(h.index_offset, h.index_size);
+	const unsigned char* p = idx.data();
+	const unsigned char* end = p + idx.size();
+	index_.reserve(h.entry_count);
+	for (uint32_t i = 0; i < h.entry_count; i++) {
+		const size_t fixed = 3 * sizeof(uint64_t) + 2 * sizeof(uint32_t);
+		if ((size_t)(end - p) < fixed)
+			throw std::runtime_error("asset_pack: truncated index: " + path);
+		entry e;
+		e.offset = read_at<uint64_t>(p);
+		e.stored_size = read_at<uint64_t>(p + 8);
+		e.size = read_at<uint64_t>(p + 16);
+		e.flags = read_at<uint32_t>(p + 24);
+		uint32_t key_length = read_at<uint32_t>(p + 28);
+		p += fixed;
+		if ((size_t)(end - p) < key_length)
+			throw std::runtime_error("asset_pack: truncated index: " + path);
+		e.key = std::string_view((const char*)p, key_length);
+		p += key_length;
+		file_->span(e.offset, e.stored_size);
+		index_.push_back(e);
+	}
+	if (!std::is_sorted(index_.begin(), index_.end(), [](const entry& a, const entry& b) { return a.key < b.key; }))
+		throw std::runtime_error("asset_pack: index is not sorted: " + path);
+}
+
+std::string asset_pack::normalize_key(const std::string& key) {
+	return std::filesystem::path(key).lexically_normal().generic_string();
+}
+const asset_pack::entry* asset_pack::lookup(const std::string& key) const {
+	std::string k = normalize_key(key);
+	auto it = std::lower_bound(index_.begin(), index_.end(), k, [](const entry& e, const std::string& k) { return e.key < k; });
+	if (it == index_.end() || it->key != k)
+		return nullptr;
+	return &*it;
+}
+bool asset_pack::contains(const std::string& key) const {
+	return lookup(key) != nullptr;
+}
+std::optional<asset_blob> asset_pack::find(const std::string& key) const {
+	const entry* e = lookup(key);
+	if (e == nullptr)
+		return std::nullopt;
+
+	asset_blob blob;
+	blob.data = file_->span(e->offset, e->stored_size);
+	if (e->flags & lz4) {
+		auto raw = std::make_shared<std::vector<unsigned char>>(e->size);
+		lz4_decompress(blob.data.data(), blob.data.size(), raw->data(), raw->size());
+		blob.data = { raw->data(), raw->size() };
+		blob.owned = raw;
+	}
+	return blob;
+}
+
+void asset_pack::build(const std::string& pack_path, const std::vector<std::pair<std::string, std::string>>& files, bool compress) {
+	std::vector<std::pair<std::string, std::string>> sorted;
+	for (auto& [key, source] : files)
+		sorted.emplace_back(normalize_key(key), source);
+	std::sort(sorted.begin(), sorted.end());
+	for (size_t i = 1; i < sorted.size(); i++) {
+		if (sorted[i].first == sorted[i - 1].first)
+			throw std::runtime_error("asset_pack: duplicate key " + sorted[i].first);
+	}
+
+	std::ofstream f(pack_path, std::ios::binary | std::ios::trunc);
+	if (!f.is_open())
+		throw std::runtime_error("asset_pack: could not create " + pack_path);
+
+	auto pad_to = [&f](uint64_t pos) {
+		static const char zeros[alignment] = {};
+		uint64_t cur = (uint64_t)f.tellp();
+		f.write(zeros, pos - cur);
+	};
+
+	std::vector<entry> entries;
+	pad_to(alignment);
+	for (auto& [key, source] : sorted) {
+		std::ifstream in(source, std::ios::binary);
+		if (!in.is_open())
+			throw std::runtime_error("asset_pack: could not open " + source);
+		std::vector<uint8_t> raw((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+
+		entry e;
+		e.offset = (uint64_t)f.tellp();
+		e.size = raw.size();
+		std::vector<uint8_t> packed;
+		if (compress && !raw.empty())
+			packed = lz4_compress(raw.data(), raw.size());
+		if (!packed.empty() && packed.size() < raw.size()) {
+			e.flags = lz4;
+			e.stored_size = packed.size();
+			f.write((const char*)packed.data(), packed.size());
+		}
+		else {
+			e.stored_size = raw.size();
+			f.write((const char*)raw.data(), raw.size());
+		}
+		entries.push_back(e);
+		pad_to((e.offset + e.stored_size + alignment - 1) / alignment * alignment);
+	}
+
+	pack_header h{};
+	memcpy(h.magic, pack_magic, sizeof(pack_magic));
+	h.version = pack_version;
+	h.entry_count = (uint32_t)entries.size();
+	h.index_offset = (uint64_t)f.tellp();
+	for (size_t i = 0; i < entries.size(); i++) {
+		write_pod(f, entries[i].offset);
+		write_pod(f, entries[i].stored_size);
+		write_pod(f, entries[i].size);
+		write_pod(f, entries[i].flags);
+		write_pod(f, (uint32_t)sorted[i].first.size());
+		f.write(sorted[i].first.data(), sorted[i].first.size());
+	}
+	h.index_size = (uint64_t)f.tellp() - h.index_offset;
+	f.seekp(0);
+	write_pod(f, h);
+	if (!f.good())
+		throw std::runtime_error("asset_pack: write failed: " + pack_path);
+}
+void asset_pack::build_from_directory(const std::string& pack_path, const std::string& root, bool compress) {
+	std::vector<std::pair<std::string, std::string>> files;
+	for (auto& it : std::filesystem::recursive_directory_iterator(root)) {
+		if (!it.is_regular_file())
+			continue;
+		files.emplace_back(std::filesystem::relative(it.path(), root).generic_string(), it.path().string());
+	}
+	build(pack_path, files, compress);
+}
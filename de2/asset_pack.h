@@ -0,0 +1,57 @@
+#pragma once
+
+#include <span>
+#include <string>
+#include <vector>
+#include <memory>
+#include <optional>
+#include <streambuf>
+#include <string_view>
+#include "mapped_file.h"
+
+//term: a view into a mounted pack, or into memory kept alive by owned
+struct asset_blob {
+	std::span<const unsigned char> data;
+	std::shared_ptr<const void> owned;
+};
+
+class asset_streambuf : public std::streambuf {
+public:
+	asset_streambuf(std::span<const unsigned char> data) {
+		char* p = (char*)data.data();
+		setg(p, p, p + data.size());
+	}
+};
+
+//term: layout: header | 4K aligned blobs | index (offset, stored size, size, flags, key) sorted by key
+class asset_pack {
+public:
+	static constexpr size_t alignment = 4096;
+	enum entry_flags : uint32_t { none = 0, lz4 = 1 };
+
+	struct entry {
+		std::string_view key;
+		uint64_t offset{ 0 };
+		uint64_t stored_size{ 0 };
+		uint64_t size{ 0 };
+		uint32_t flags{ none };
+	};
+
+	asset_pack(const std::string& path);
+
+	bool contains(const std::string& key) const;
+	std::optional<asset_blob> find(const std::string& key) const;
+	const std::vector<entry>& entries() const { return index_; }
+	const std::string& path() const { return path_; }
+
+	static std::string normalize_key(const std::string& key);
+	static void build(const std::string& pack_path, const std::vector<std::pair<std::string, std::string>>& files, bool compress = true);
+	static void build_from_directory(const std::string& pack_path, const std::string& root, bool compress = true);
+
+protected:
+	std::string path_;
+	std::unique_ptr<mapped_file> file_;
+	std::vector<entry> index_;
+
+	const entry* lookup(const std::string& key) const;
+};
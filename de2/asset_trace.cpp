@@ -0,0 +1,141 @@
+#include "pch.h"
+#include "asset_trace.h"
+#include <stb_image.h>
+#include <fstream>
+#include <sstream>
+
+//DECODED_IMAGE
+decoded_image::~decoded_image() {
+	if (data != nullptr)
+		stbi_image_free(data);
+}
+unsigned char* decoded_image::release() {
+	unsigned char* p = data;
+	data = nullptr;
+	return p;
+}
+
+//ASSET_TRACE
+void asset_trace::start() {
+	std::unique_lock<std::mutex> lock(mutex_);
+	begin_ = std::chrono::steady_clock::now();
+	entries_.clear();
+	seen_.clear();
+	recording_ = true;
+}
+void asset_trace::record(const std::string& key) {
+	auto now = std::chrono::steady_clock::now();
+	std::unique_lock<std::mutex> lock(mutex_);
+	if (!recording_ || !seen_.insert(key).second)
+		return;
+	entries_.push_back({ key, std::chrono::duration_cast<std::chrono::milliseconds>(now - begin_) });
+}
+std::vector<asset_trace::entry> asset_trace::entries() {
+	std::unique_lock<std::mutex> lock(mutex_);
+	return entries_;
+}
+//term: one "<first use ms>\t<key>" line per asset, in first-use order
+void asset_trace::save(const std::string& path) {
+	std::vector<entry> list = entries();
+	std::ofstream f(path, std::ios::trunc);
+	if (!f.is_open())
+		throw std::runtime_error("could not write asset trace: " + path);
+	for (auto& e : list)
+		f << e.first_use.count() << '\t' << e.key << '\n';
+}
+std::vector<asset_trace::entry> asset_trace::load(const std::string& path) {
+	std::vector<entry> list;
+	std::ifstream f(path);
+	std::string line;
+	while (std::getline(f, line)) {
+		size_t tab = line.find('\t');
+		if (tab == std::string::npos || tab + 1 >= line.size())
+			continue;
+		list.push_back({ line.substr(tab + 1), std::chrono::milliseconds(atoll(line.substr(0, tab).c_str())) });
+	}
+	return list;
+}
+
+//ASSET_PREFETCHER
+void asset_prefetcher::add(const std::string& key, std::shared_future<asset_blob> blob) {
+	std::unique_lock<std::mutex> lock(mutex_);
+	if (items_.emplace(key, item{ blob, {} }).second)
+		stats_.prefetched++;
+}
+void asset_prefetcher::add(const std::string& key, std::shared_future<std::shared_ptr<decoded_image>> image) {
+	std::unique_lock<std::mutex> lock(mutex_);
+	if (items_.emplace(key, item{ {}, image }).second)
+		stats_.prefetched++;
+}
+std::optional<asset_prefetcher::item> asset_prefetcher::take(const std::string& key, bool want_image, bool wait) {
+	std::unique_lock<std::mutex> lock(mutex_);
+	if (stats_.prefetched == 0)
+		return std::nullopt;
+	auto it = items_.find(key);
+	if (it == items_.end()) {
+		//term: texture loads try take_image first and always end in take_blob, count the miss only once there
+		if (!want_image)
+			stats_.misses++;
+		return std::nullopt;
+	}
+	if (it->second.image.valid() != want_image)
+		return std::nullopt;
+	bool ready = want_image ? it->second.image.wait_for(std::chrono::seconds(0)) == std::future_status::ready : it->second.blob.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+	if (!ready && !wait) {
+		stats_.skipped++;
+		return std::nullopt;
+	}
+	item i = it->second;
+	items_.erase(it);
+	stats_.hits++;
+	if (!ready)
+		stats_.waits++;
+	return i;
+}
+std::optional<asset_blob> asset_prefetcher::take_blob(const std::string& key, bool wait) {
+	auto i = take(key, false, wait);
+	if (!i)
+		return std::nullopt;
+	try {
+		return i->blob.get();
+	}
+	catch (...) {
+		//term: a failed prefetch is not an error, the loader reports it when it retries
+		return std::nullopt;
+	}
+}
+std::shared_ptr<decoded_image> asset_prefetcher::take_image(const std::string& key, bool wait) {
+	auto i = take(key, true, wait);
+	if (!i)
+		return nullptr;
+	try {
+		return i->image.get();
+	}
+	catch (...) {
+		return nullptr;
+	}
+}
+size_t asset_prefetcher::release_unused() {
+	std::unique_lock<std::mutex> lock(mutex_);
+	size_t released = items_.size();
+	released_ += released;
+	items_.clear();
+	return released;
+}
+bool asset_prefetcher::empty() {
+	std::unique_lock<std::mutex> lock(mutex_);
+	return items_.empty();
+}
+asset_prefetcher::stats asset_prefetcher::get_stats() {
+	std::unique_lock<std::mutex> lock(mutex_);
+	stats s = stats_;
+	s.unused = items_.size() + released_;
+	return s;
+}
+std::string asset_prefetcher::report() {
+	stats s = get_stats();
+	std::stringstream ss;
+	ss << "prefetch: " << s.prefetched << " queued, " << s.hits << " hits (" << s.waits << " waited), " << s.skipped << " skipped in flight, "
+		<< s.misses << " misses, " << s.unused << " unused, hit rate " << (int)(s.hit_rate() * 100) << "%";
+	return ss.str();
+}
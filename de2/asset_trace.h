@@ -0,0 +1,71 @@
+#pragma once
+
+#include "framework.h"
+#include "asset_pack.h"
+#include <chrono>
+#include <future>
+#include <unordered_set>
+
+//term: stbi allocated pixels owned until release(); levels > 1 when the mip chain follows the base level
+struct decoded_image {
+	int width{ 0 }, height{ 0 }, comp{ 0 }, levels{ 1 };
+	unsigned char* data{ nullptr };
+
+	decoded_image() {}
+	decoded_image(const decoded_image& other) = delete;
+	decoded_image& operator=(const decoded_image& other) = delete;
+	~decoded_image();
+	unsigned char* release();
+};
+
+class asset_trace {
+public:
+	struct entry {
+		std::string key;
+		std::chrono::milliseconds first_use{ 0 };
+	};
+
+	void start();
+	void record(const std::string& key);
+	std::vector<entry> entries();
+	void save(const std::string& path);
+	static std::vector<entry> load(const std::string& path);
+
+protected:
+	std::chrono::steady_clock::time_point begin_{ std::chrono::steady_clock::now() };
+	std::vector<entry> entries_;
+	std::unordered_set<std::string> seen_;
+	std::mutex mutex_;
+	bool recording_{ false };
+};
+
+class asset_prefetcher {
+public:
+	struct stats {
+		size_t prefetched{ 0 }, hits{ 0 }, waits{ 0 }, skipped{ 0 }, misses{ 0 }, unused{ 0 };
+		double hit_rate() const { return hits + misses ? (double)hits / (double)(hits + misses) : 0.0; }
+	};
+
+	void add(const std::string& key, std::shared_future<asset_blob> blob);
+	void add(const std::string& key, std::shared_future<std::shared_ptr<decoded_image>> image);
+
+	//term: pool workers pass wait false, the read or decode they would wait for may be queued behind them
+	std::optional<asset_blob> take_blob(const std::string& key, bool wait);
+	std::shared_ptr<decoded_image> take_image(const std::string& key, bool wait);
+	size_t release_unused();
+	bool empty();
+	stats get_stats();
+	std::string report();
+
+protected:
+	struct item {
+		std::shared_future<asset_blob> blob;
+		std::shared_future<std::shared_ptr<decoded_image>> image;
+	};
+	std::optional<item> take(const std::string& key, bool want_image, bool wait);
+
+	std::unordered_map<std::string, item> items_;
+	std::mutex mutex_;
+	stats stats_;
+	size_t released_{ 0 };
+};
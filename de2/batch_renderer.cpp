@@ -0,0 +1,202 @@
+#include "pch.h"
+#include "batch_renderer.h"
+#include "frame_recorder.h"
+#include "tracer.h"
+
+batch_renderer::batch_renderer(size_t ring_size) : ring_(std::max<size_t>(ring_size, 1)) {
+	for (auto& s : ring_)
+		glGenBuffers(1, &s.pbo);
+}
+
+batch_renderer::~batch_renderer() {
+	for (auto& f : outputs_)
+		if (f.valid())
+			f.wait();
+	std::vector<GLuint> pbos, fbos, renderbuffers;
+	std::vector<GLsync> fences;
+	for (auto& s : ring_) {
+		pbos.push_back(s.pbo);
+		if (s.fence)
+			fences.push_back(s.fence);
+	}
+	for (auto& [size, t] : targets_) {
+		fbos.push_back(t.fbo);
+		renderbuffers.push_back(t.color);
+		renderbuffers.push_back(t.depth);
+	}
+	de2::get_instance().release_gl([pbos, fbos, renderbuffers, fences]() {
+		for (GLsync f : fences)
+			glDeleteSync(f);
+		glDeleteBuffers((GLsizei)pbos.size(), pbos.data());
+		glDeleteFramebuffers((GLsizei)fbos.size(), fbos.data());
+		glDeleteRenderbuffers((GLsizei)renderbuffers.size(), renderbuffers.data());
+	});
+}
+
+void batch_renderer::submit(render_job job) {
+	if (!job.world || !job.cam)
+		throw std::invalid_argument("batch_renderer: a job needs a world and a camera");
+	if (job.width <= 0 || job.height <= 0)
+		throw std::invalid_argument("batch_renderer: bad job size");
+	jobs_.push_back(std::move(job));
+}
+
+batch_renderer::target& batch_renderer::target_for(int width, int height) {
+	target& t = targets_[{ width, height }];
+	if (t.fbo)
+		return t;
+	glGenFramebuffers(1, &t.fbo);
+	glGenRenderbuffers(1, &t.color);
+	glGenRenderbuffers(1, &t.depth);
+	glBindRenderbuffer(GL_RENDERBUFFER, t.color);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+	glBindRenderbuffer(GL_RENDERBUFFER, t.depth);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+	glBindFramebuffer(GL_FRAMEBUFFER, t.fbo);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, t.color);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, t.depth);
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+		//term: dropped so the next run doesn't take it for a ready target
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		glDeleteFramebuffers(1, &t.fbo);
+		glDeleteRenderbuffers(1, &t.color);
+		glDeleteRenderbuffers(1, &t.depth);
+		targets_.erase({ width, height });
+		throw std::runtime_error("batch_renderer: incomplete framebuffer " + std::to_string(width) + "x" + std::to_string(height));
+	}
+	return t;
+}
+
+batch_renderer::counts batch_renderer::run() {
+	DE2_TRACE_SCOPE("batch", "batch_renderer::run");
+	de2& engine = de2::get_instance();
+	auto begin = std::chrono::steady_clock::now();
+	//term: restores the default framebuffer and the caller's viewport on every exit; a failed run also drops its batch so the next one starts clean
+	struct state_guard {
+		batch_renderer& self;
+		de2& engine;
+		glm::vec2 viewport;
+		GLint previous[4]{};
+		bool failed{ true };
+		state_guard(batch_renderer& owner, de2& e) : self(owner), engine(e), viewport(e.viewport) {
+			glGetIntegerv(GL_VIEWPORT, previous);
+		}
+		~state_guard() {
+			glBindFramebuffer(GL_FRAMEBUFFER, 0);
+			glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+			glViewport(previous[0], previous[1], previous[2], previous[3]);
+			engine.viewport = viewport;
+			if (!failed)
+				return;
+			for (auto& s : self.ring_) {
+				if (s.fence)
+					glDeleteSync(s.fence);
+				s.fence = nullptr;
+				s.job = {};
+			}
+			for (auto& f : self.outputs_)
+				if (f.valid())
+					f.wait();
+			self.outputs_.clear();
+			self.jobs_.clear();
+		}
+	} guard(*this, engine);
+
+	std::chrono::nanoseconds interval{ 0 };
+	size_t next = 0;
+	for (auto& job : jobs_) {
+		DE2_TRACE_SCOPE("batch", "job");
+		slot& s = ring_[next++ % ring_.size()];
+		if (s.fence)
+			collect(s);
+
+		target& t = target_for(job.width, job.height);
+		glBindFramebuffer(GL_FRAMEBUFFER, t.fbo);
+		glViewport(0, 0, job.width, job.height);
+		engine.viewport = { (float)job.width, (float)job.height };
+		renderer_.cam_ = job.cam;
+		renderer_.l = job.l;
+		renderer_.fov = job.fov;
+		renderer_.process(*job.world, interval);
+
+		size_t bytes = (size_t)job.width * job.height * 4;
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, s.pbo);
+		if (s.bytes < bytes) {
+			glBufferData(GL_PIXEL_PACK_BUFFER, bytes, nullptr, GL_STREAM_READ);
+			s.bytes = bytes;
+		}
+		glPixelStorei(GL_PACK_ALIGNMENT, 1);
+		glReadBuffer(GL_COLOR_ATTACHMENT0);
+		glReadPixels(0, 0, job.width, job.height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+		s.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		s.job = std::move(job);
+	}
+	//term: oldest first, the order they were issued in
+	for (size_t i = 0; i < ring_.size(); i++) {
+		slot& s = ring_[(next + i) % ring_.size()];
+		if (s.fence)
+			collect(s);
+	}
+	guard.failed = false;
+
+	counts c;
+	for (auto& f : outputs_) {
+		try {
+			f.get();
+		}
+		catch (const std::exception& e) {
+			std::cerr << "batch_renderer: " << e.what() << std::endl;
+			c.failed++;
+		}
+	}
+	c.jobs = jobs_.size();
+	c.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+	outputs_.clear();
+	jobs_.clear();
+	return c;
+}
+
+void batch_renderer::collect(slot& s) {
+	DE2_TRACE_SCOPE("batch", "collect");
+	GLenum waited = glClientWaitSync(s.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 10000000000ull);
+	glDeleteSync(s.fence);
+	s.fence = nullptr;
+
+	//term: the read back may not have landed, mapping now would hand out whatever the buffer held before
+	if (waited == GL_TIMEOUT_EXPIRED || waited == GL_WAIT_FAILED) {
+		std::promise<void> failed;
+		failed.set_exception(std::make_exception_ptr(std::runtime_error(waited == GL_TIMEOUT_EXPIRED ? "read-back fence timed out" : "read-back fence wait failed")));
+		outputs_.push_back(failed.get_future());
+		s.job = {};
+		return;
+	}
+
+	const int width = s.job.width, height = s.job.height;
+	const size_t stride = (size_t)width * 4;
+	std::vector<unsigned char> rgba(stride * height);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, s.pbo);
+	const unsigned char* pixels = (const unsigned char*)glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, rgba.size(), GL_MAP_READ_BIT);
+	if (pixels) {
+		for (int y = 0; y < height; y++)
+			memcpy(rgba.data() + stride * y, pixels + stride * (height - 1 - y), stride);
+		glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	outputs_.push_back(de2::get_instance().get_pool().enqueue([job = std::move(s.job), rgba = std::move(rgba), mapped = pixels != nullptr]() {
+		if (!mapped)
+			throw std::runtime_error("read-back buffer could not be mapped");
+		if (!job.output_path.empty()) {
+			std::vector<unsigned char> png = frame_recorder::encode_png(rgba.data(), job.width, job.height, false);
+			std::ofstream f(job.output_path, std::ios::binary | std::ios::trunc);
+			if (!f.is_open())
+				throw std::runtime_error("can't write " + job.output_path);
+			f.write((const char*)png.data(), png.size());
+		}
+		if (job.on_done)
+			job.on_done(job, rgba);
+	}));
+	s.job = render_job();
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include "de2.h"
+#include <span>
+#include <future>
+
+struct render_job {
+	ecs_s::registry* world{ nullptr };
+	std::shared_ptr<camera> cam;
+	std::shared_ptr<light> l;
+	int width{ 256 }, height{ 256 };
+	float fov{ glm::pi<float>() / 4 };
+	std::string output_path;
+	//term: pool worker, top-down rgba8 rows
+	std::function<void(const render_job& job, std::span<const unsigned char> rgba)> on_done;
+};
+
+//term: one context only, programs hold their view and projection uniforms and are shared by every context
+class batch_renderer {
+public:
+	struct counts {
+		uint64_t jobs{ 0 }, failed{ 0 };
+		double seconds{ 0 };
+		double images_per_sec() const { return seconds > 0 ? jobs / seconds : 0; }
+	};
+
+	batch_renderer(size_t ring_size = 4);
+	virtual ~batch_renderer();
+	batch_renderer(const batch_renderer& other) = delete;
+	batch_renderer& operator=(const batch_renderer& other) = delete;
+
+	void submit(render_job job);
+	//term: render thread, the scenes must be uploaded
+	counts run();
+protected:
+	struct target {
+		GLuint fbo{ 0 }, color{ 0 }, depth{ 0 };
+	};
+	struct slot {
+		GLuint pbo{ 0 };
+		size_t bytes{ 0 };
+		GLsync fence{ nullptr };
+		render_job job;
+	};
+
+	target& target_for(int width, int height);
+	void collect(slot& s);
+
+	renderer_system renderer_{ false };
+	std::vector<render_job> jobs_;
+	std::map<std::pair<int, int>, target> targets_;
+	std::vector<slot> ring_;
+	std::vector<std::future<void>> outputs_;
+};
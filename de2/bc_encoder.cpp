@@ -0,0 +1,159 @@
+#include "pch.h"
+#include "bc_encoder.h"
+#include <cmath>
+#include <cstring>
+#include <cstdint>
+#include <algorithm>
+
+size_t bc_block_bytes(bc_format f) {
+	return f == bc_format::bc1 || f == bc_format::bc4 ? 8 : 16;
+}
+
+size_t bc_level_bytes(int width, int height, bc_format f) {
+	return (size_t)((width + 3) / 4) * ((height + 3) / 4) * bc_block_bytes(f);
+}
+
+namespace {
+	uint16_t to_565(const float c[3]) {
+		int r = std::clamp((int)std::lround(c[0] * 31 / 255), 0, 31);
+		int g = std::clamp((int)std::lround(c[1] * 63 / 255), 0, 63);
+		int b = std::clamp((int)std::lround(c[2] * 31 / 255), 0, 31);
+		return (uint16_t)(r << 11 | g << 5 | b);
+	}
+	void from_565(uint16_t v, int c[3]) {
+		c[0] = (v >> 11 & 31) * 255 / 31;
+		c[1] = (v >> 5 & 63) * 255 / 63;
+		c[2] = (v & 31) * 255 / 31;
+	}
+
+	//term: 4 color mode, color0 > color1; equal endpoints encode a flat block
+	void encode_color_block(const unsigned char block[64], unsigned char* out) {
+		float mean[3] = {};
+		for (int i = 0; i < 16; i++)
+			for (int c = 0; c < 3; c++)
+				mean[c] += block[i * 4 + c] / 16.0f;
+		float cov[6] = {};
+		for (int i = 0; i < 16; i++) {
+			float d[3] = { block[i * 4] - mean[0], block[i * 4 + 1] - mean[1], block[i * 4 + 2] - mean[2] };
+			cov[0] += d[0] * d[0]; cov[1] += d[0] * d[1]; cov[2] += d[0] * d[2];
+			cov[3] += d[1] * d[1]; cov[4] += d[1] * d[2]; cov[5] += d[2] * d[2];
+		}
+		//term: a few power iterations are enough for the principal axis of 16 points
+		float axis[3] = { 1, 1, 1 };
+		for (int n = 0; n < 4; n++) {
+			float x = cov[0] * axis[0] + cov[1] * axis[1] + cov[2] * axis[2];
+			float y = cov[1] * axis[0] + cov[3] * axis[1] + cov[4] * axis[2];
+			float z = cov[2] * axis[0] + cov[4] * axis[1] + cov[5] * axis[2];
+			float len = std::max({ std::fabs(x), std::fabs(y), std::fabs(z) });
+			if (len < 1e-6f)
+				break;
+			axis[0] = x / len; axis[1] = y / len; axis[2] = z / len;
+		}
+		float lo = 1e9f, hi = -1e9f;
+		for (int i = 0; i < 16; i++) {
+			float t = (block[i * 4] - mean[0]) * axis[0] + (block[i * 4 + 1] - mean[1]) * axis[1] + (block[i * 4 + 2] - mean[2]) * axis[2];
+			lo = std::min(lo, t);
+			hi = std::max(hi, t);
+		}
+		float norm = axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2];
+		float e0[3], e1[3];
+		for (int c = 0; c < 3; c++) {
+			e0[c] = mean[c] + axis[c] * hi / norm;
+			e1[c] = mean[c] + axis[c] * lo / norm;
+		}
+		uint16_t c0 = to_565(e0), c1 = to_565(e1);
+		if (c0 < c1)
+			std::swap(c0, c1);
+
+		uint32_t indices = 0;
+		if (c0 != c1) {
+			int palette[4][3];
+			from_565(c0, palette[0]);
+			from_565(c1, palette[1]);
+			for (int c = 0; c < 3; c++) {
+				palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+				palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+			}
+			for (int i = 0; i < 16; i++) {
+				int best = 0, best_error = INT32_MAX;
+				for (int p = 0; p < 4; p++) {
+					int dr = block[i * 4] - palette[p][0], dg = block[i * 4 + 1] - palette[p][1], db = block[i * 4 + 2] - palette[p][2];
+					int error = dr * dr + dg * dg + db * db;
+					if (error < best_error) {
+						best_error = error;
+						best = p;
+					}
+				}
+				indices |= (uint32_t)best << (i * 2);
+			}
+		}
+		out[0] = (unsigned char)c0; out[1] = (unsigned char)(c0 >> 8);
+		out[2] = (unsigned char)c1; out[3] = (unsigned char)(c1 >> 8);
+		for (int b = 0; b < 4; b++)
+			out[4 + b] = (unsigned char)(indices >> (b * 8));
+	}
+
+	//term: 8 value mode, red0 = max > red1 = min; the channel is read every 4 bytes starting at block
+	void encode_channel_block(const unsigned char* block, unsigned char* out) {
+		int lo = 255, hi = 0;
+		for (int i = 0; i < 16; i++) {
+			lo = std::min(lo, (int)block[i * 4]);
+			hi = std::max(hi, (int)block[i * 4]);
+		}
+		uint64_t indices = 0;
+		if (hi != lo) {
+			int palette[8] = { hi, lo };
+			for (int p = 2; p < 8; p++)
+				palette[p] = ((8 - p) * hi + (p - 1) * lo) / 7;
+			for (int i = 0; i < 16; i++) {
+				int best = 0, best_error = INT32_MAX;
+				for (int p = 0; p < 8; p++) {
+					int error = std::abs(block[i * 4] - palette[p]);
+					if (error < best_error) {
+						best_error = error;
+						best = p;
+					}
+				}
+				indices |= (uint64_t)best << (i * 3);
+			}
+		}
+		out[0] = (unsigned char)hi;
+		out[1] = (unsigned char)lo;
+		for (int b = 0; b < 6; b++)
+			out[2 + b] = (unsigned char)(indices >> (b * 8));
+	}
+}
+
+std::vector<unsigned char> encode_bc(const unsigned char* rgba, int width, int height, bc_format f) {
+	std::vector<unsigned char> out(bc_level_bytes(width, height, f));
+	const size_t block_bytes = bc_block_bytes(f);
+	unsigned char* dst = out.data();
+	unsigned char block[64];
+	for (int by = 0; by < height; by += 4) {
+		for (int bx = 0; bx < width; bx += 4) {
+			for (int y = 0; y < 4; y++) {
+				const unsigned char* row = rgba + (size_t)std::min(by + y, height - 1) * width * 4;
+				for (int x = 0; x < 4; x++)
+					memcpy(block + (y * 4 + x) * 4, row + (size_t)std::min(bx + x, width - 1) * 4, 4);
+			}
+			switch (f) {
+			case bc_format::bc1:
+				encode_color_block(block, dst);
+				break;
+			case bc_format::bc3:
+				encode_channel_block(block + 3, dst);
+				encode_color_block(block, dst + 8);
+				break;
+			case bc_format::bc4:
+				encode_channel_block(block, dst);
+				break;
+			case bc_format::bc5:
+				encode_channel_block(block, dst);
+				encode_channel_block(block + 1, dst + 8);
+				break;
+			}
+			dst += block_bytes;
+		}
+	}
+	return out;
+}
@@ -0,0 +1,12 @@
+#pragma once
+
+#include <vector>
+#include <cstddef>
+
+enum class bc_format { bc1, bc3, bc4, bc5 };
+
+size_t bc_block_bytes(bc_format f);
+size_t bc_level_bytes(int width, int height, bc_format f);
+
+//term: bc4 encodes red, bc5 red and green
+std::vector<unsigned char> encode_bc(const unsigned char* rgba, int width, int height, bc_format f);
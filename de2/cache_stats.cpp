@@ -0,0 +1,100 @@
+#include "pch.h"
+#include "cache_stats.h"
+#include <bit>
+
+//LATENCY HISTOGRAM
+void latency_histogram::record(std::chrono::nanoseconds elapsed) {
+	uint64_t ns = elapsed.count() > 0 ? (uint64_t)elapsed.count() : 0;
+	size_t bucket = std::min<size_t>(std::bit_width(ns), bucket_count - 1);
+	buckets_[bucket].fetch_add(1, std::memory_order_relaxed);
+	count_.fetch_add(1, std::memory_order_relaxed);
+	total_ns_.fetch_add(ns, std::memory_order_relaxed);
+
+	uint64_t prev = max_ns_.load(std::memory_order_relaxed);
+	while (prev < ns && !max_ns_.compare_exchange_weak(prev, ns, std::memory_order_relaxed));
+}
+latency_histogram::snapshot latency_histogram::get_snapshot() const {
+	snapshot s;
+	for (size_t i = 0; i < bucket_count; i++)
+		s.buckets[i] = buckets_[i].load(std::memory_order_relaxed);
+	s.count = count_.load(std::memory_order_relaxed);
+	s.total_ns = total_ns_.load(std::memory_order_relaxed);
+	s.max_ns = max_ns_.load(std::memory_order_relaxed);
+	return s;
+}
+void latency_histogram::reset() {
+	for (auto& b : buckets_)
+		b.store(0, std::memory_order_relaxed);
+	count_.store(0, std::memory_order_relaxed);
+	total_ns_.store(0, std::memory_order_relaxed);
+	max_ns_.store(0, std::memory_order_relaxed);
+}
+uint64_t latency_histogram::snapshot::percentile_ns(double p) const {
+	uint64_t total = 0;
+	for (auto b : buckets)
+		total += b;
+	if (total == 0)
+		return 0;
+
+	uint64_t rank = (uint64_t)std::ceil(std::clamp(p, 0.0, 1.0) * total);
+	uint64_t seen = 0;
+	for (size_t i = 0; i < bucket_count; i++) {
+		seen += buckets[i];
+		if (seen >= rank && buckets[i] > 0)
+			return std::min<uint64_t>(i == 0 ? 0 : (1ull << i) - 1, max_ns);
+	}
+	return max_ns;
+}
+std::string latency_histogram::snapshot::to_json() const {
+	std::ostringstream o;
+	o << "{\"count\":" << count << ",\"mean_ns\":" << (uint64_t)mean_ns() << ",\"max_ns\":" << max_ns
+		<< ",\"p50_ns\":" << percentile_ns(0.5) << ",\"p90_ns\":" << percentile_ns(0.9) << ",\"p99_ns\":" << percentile_ns(0.99)
+		<< ",\"buckets\":[";
+	//term: trailing empty buckets are dropped, bucket i counts samples below 2^i ns
+	size_t used = bucket_count;
+	while (used > 0 && buckets[used - 1] == 0)
+		used--;
+	for (size_t i = 0; i < used; i++)
+		o << (i ? "," : "") << buckets[i];
+	o << "]}";
+	return o.str();
+}
+
+
+//CACHE STATS
+void cache_counters::reset() {
+	for (auto* c : { &hits, &misses, &inserts, &updates, &evictions, &erases, &lock_acquisitions, &contended_locks, &lock_wait_ns, &l2_hits, &l2_misses, &l2_writes })
+		c->store(0, std::memory_order_relaxed);
+}
+void cache_stats::snapshot::add(const cache_counters& c) {
+	hits += c.hits.load(std::memory_order_relaxed);
+	misses += c.misses.load(std::memory_order_relaxed);
+	inserts += c.inserts.load(std::memory_order_relaxed);
+	updates += c.updates.load(std::memory_order_relaxed);
+	evictions += c.evictions.load(std::memory_order_relaxed);
+	erases += c.erases.load(std::memory_order_relaxed);
+	lock_acquisitions += c.lock_acquisitions.load(std::memory_order_relaxed);
+	contended_locks += c.contended_locks.load(std::memory_order_relaxed);
+	lock_wait_ns += c.lock_wait_ns.load(std::memory_order_relaxed);
+	l2_hits += c.l2_hits.load(std::memory_order_relaxed);
+	l2_misses += c.l2_misses.load(std::memory_order_relaxed);
+	l2_writes += c.l2_writes.load(std::memory_order_relaxed);
+}
+cache_stats::snapshot cache_stats::get_snapshot() const {
+	snapshot s;
+	s.resident_bytes = resident_bytes.load(std::memory_order_relaxed);
+	s.miss_latency = miss_latency.get_snapshot();
+	return s;
+}
+void cache_stats::reset() {
+	miss_latency.reset();
+}
+std::string cache_stats::snapshot::to_json() const {
+	std::ostringstream o;
+	o << "{\"hits\":" << hits << ",\"misses\":" << misses << ",\"hit_rate\":" << hit_rate()
+		<< ",\"inserts\":" << inserts << ",\"updates\":" << updates << ",\"evictions\":" << evictions << ",\"erases\":" << erases
+		<< ",\"lock_acquisitions\":" << lock_acquisitions << ",\"contended_locks\":" << contended_locks << ",\"lock_wait_ns\":" << lock_wait_ns
+		<< ",\"l2_hits\":" << l2_hits << ",\"l2_misses\":" << l2_misses << ",\"l2_writes\":" << l2_writes
+		<< ",\"resident_bytes\":" << resident_bytes << ",\"miss_latency\":" << miss_latency.to_json() << "}";
+	return o.str();
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <cstdint>
+
+//term: log2 buckets over nanoseconds, recording is safe from any thread
+class latency_histogram {
+public:
+	static constexpr size_t bucket_count = 40;
+
+	struct snapshot {
+		std::array<uint64_t, bucket_count> buckets{};
+		uint64_t count{ 0 }, total_ns{ 0 }, max_ns{ 0 };
+
+		double mean_ns() const { return count ? (double)total_ns / count : 0; }
+		//term: p in [0, 1]
+		uint64_t percentile_ns(double p) const;
+		std::string to_json() const;
+	};
+
+	void record(std::chrono::nanoseconds elapsed);
+	snapshot get_snapshot() const;
+	void reset();
+protected:
+	std::array<std::atomic<uint64_t>, bucket_count> buckets_{};
+	std::atomic<uint64_t> count_{ 0 }, total_ns_{ 0 }, max_ns_{ 0 };
+};
+
+struct cache_counters {
+	std::atomic<uint64_t> hits{ 0 }, misses{ 0 }, inserts{ 0 }, updates{ 0 }, evictions{ 0 }, erases{ 0 };
+	std::atomic<uint64_t> lock_acquisitions{ 0 }, contended_locks{ 0 }, lock_wait_ns{ 0 };
+	std::atomic<uint64_t> l2_hits{ 0 }, l2_misses{ 0 }, l2_writes{ 0 };
+
+	void add(std::atomic<uint64_t>& counter, uint64_t n = 1) { counter.fetch_add(n, std::memory_order_relaxed); }
+	void reset();
+};
+
+//term: a snapshot never blocks the cache and is not a consistent cut
+class cache_stats {
+public:
+	struct snapshot {
+		uint64_t hits{ 0 }, misses{ 0 }, inserts{ 0 }, updates{ 0 }, evictions{ 0 }, erases{ 0 };
+		uint64_t lock_acquisitions{ 0 }, contended_locks{ 0 }, lock_wait_ns{ 0 };
+		uint64_t l2_hits{ 0 }, l2_misses{ 0 }, l2_writes{ 0 };
+		int64_t resident_bytes{ 0 };
+		latency_histogram::snapshot miss_latency;
+
+		void add(const cache_counters& c);
+		double hit_rate() const { return hits + misses ? (double)hits / (hits + misses) : 0; }
+		std::string to_json() const;
+	};
+
+	//term: kept by the residency manager, the cache itself only counts entries
+	std::atomic<int64_t> resident_bytes{ 0 };
+	//term: recorded by whoever loads the value
+	latency_histogram miss_latency;
+
+	snapshot get_snapshot() const;
+	void reset();
+};
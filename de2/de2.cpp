@@ -3,42 +3,216 @@
 #include "model.h"
 #include "camera.h"
 #include "shader.h"
+#include "mipmap.h"
+#include <stb_image.h>
+#include "GLFW/glfw3.h"
+#ifdef _WIN32
 #include <Windows.h>
 #define GLFW_EXPOSE_NATIVE_WIN32
-#include "GLFW/glfw3.h"
 #include "GLFW/glfw3native.h"
+#endif
 
 de2::de2(){
     on_resize = [&](int width, int height) { resize(width, height); };
     on_key = [&](int key, int scancode, int action, int mods) { if (key == GLFW_KEY_ESCAPE && action == GLFW_PRESS) glfwSetWindowShouldClose(window, GLFW_TRUE);};
     on_process_input = [&]() { };
-    
+    model_cache_.set_on_evict([this](const string_id& key, std::shared_ptr<model>&) { residency_.untrack(key); });
+    mesh_cache_.set_on_evict([this](const std::string& key, std::shared_ptr<mesh>&) { residency_.untrack(string_id::hashed(key)); });
+    texture_cache_.set_on_evict([this](const std::string& key, std::shared_ptr<texture>&) { residency_.untrack(string_id::hashed(key)); });
 }
 de2& de2::get_instance() {
     static de2 pInstance;
     return pInstance;
 }
 void de2::set_title(const std::string& title) {
+    title_ = title;
     glfwSetWindowTitle(window, title.c_str());
 }
 std::string de2::get_title() {
+#ifdef _WIN32
     std::string title(GetWindowTextLength(glfwGetWin32Window(de2::get_instance().window)) + 1, '\0');
     GetWindowTextA(glfwGetWin32Window(de2::get_instance().window), &title[0], title.size());
     return title;
+#else
+    //term: glfw 3.3 has no title getter, the last title set is returned
+    return title_;
+#endif
 }
 void de2::resize(size_t width, size_t height) {
     viewport.x = width; viewport.y = height; glViewport(0, 0, width, height);
 }
-bool de2::has_model(const std::string& key) {
+bool de2::has_model(string_id key) {
     return model_cache_.exists(key);
 }
+std::string de2::mesh_key(const std::string& path, bool is_left_handed) {
+    return "mesh:" + asset_pack::normalize_key(path) + (is_left_handed ? "" : "|rh");
+}
+std::string de2::texture_key(const std::string& path) {
+    return "texture:" + asset_pack::normalize_key(path);
+}
+std::shared_ptr<mesh> de2::load_mesh(const std::string& path, bool is_left_handed) {
+    std::string key = mesh_key(path, is_left_handed);
+    if (auto cached = mesh_cache_.try_get(key)) {
+        residency_.touch(string_id::hashed(key));
+        return *cached;
+    }
+    return mesh_flights_.run(key, [&]() {
+        if (auto cached = mesh_cache_.try_get(key))
+            return *cached;
+        std::string p = path;
+        return share_mesh(key, std::make_shared<mesh>(p, is_left_handed));
+    }).get();
+}
+std::shared_ptr<texture> de2::load_texture(const std::string& path) {
+    std::string key = texture_key(path);
+    if (auto cached = texture_cache_.try_get(key)) {
+        residency_.touch(string_id::hashed(key));
+        return *cached;
+    }
+    return texture_flights_.run(key, [&]() {
+        if (auto cached = texture_cache_.try_get(key))
+            return *cached;
+        return share_texture(key, std::make_shared<texture>(path));
+    }).get();
+}
+std::shared_ptr<mesh> de2::share_mesh(const std::string& key, std::shared_ptr<mesh> m) {
+    if (auto cached = mesh_cache_.try_get(key))
+        return *cached;
+    m->cache_key = key;
+    mesh_cache_.put(key, m);
+    track_residency(key, mesh_cache_, m);
+    return m;
+}
+std::shared_ptr<texture> de2::share_texture(const std::string& key, std::shared_ptr<texture> t) {
+    if (auto cached = texture_cache_.try_get(key))
+        return *cached;
+    t->cache_key = key;
+    texture_cache_.put(key, t);
+    track_residency(key, texture_cache_, t);
+    return t;
+}
+void de2::open_disk_cache(const std::string& path, size_t capacity_bytes) {
+    using blob_ptr = std::shared_ptr<const std::vector<unsigned char>>;
+    decoded_cache_.attach_l2(std::make_shared<disk_cache>(path, capacity_bytes), {
+        [](const std::string& key) { return key; },
+        [](const blob_ptr& blob) { return std::optional<std::vector<unsigned char>>(*blob); },
+        [](std::span<const unsigned char> data) { return std::optional<blob_ptr>(std::make_shared<const std::vector<unsigned char>>(data.begin(), data.end())); }
+    });
+}
+std::string de2::decoded_key(const std::string& kind, const std::string& path) {
+    if (!decoded_cache_.l2())
+        return "";
+    if (auto blob = find_packed(path))
+        return kind + ":" + path + "@p" + std::to_string(blob->data.size());
+
+    std::error_code ec;
+    auto size = std::filesystem::file_size(path, ec);
+    if (ec)
+        return "";
+    auto time = std::filesystem::last_write_time(path, ec);
+    if (ec)
+        return "";
+    return kind + ":" + path + "@" + std::to_string(size) + "." + std::to_string(time.time_since_epoch().count());
+}
+void de2::mount(const std::string& pack_path) {
+    auto pack = std::make_shared<asset_pack>(pack_path);
+    std::unique_lock<std::shared_mutex> lock(packs_mutex_);
+    packs_.push_back(pack);
+}
+std::optional<asset_blob> de2::read_asset(const std::string& key) {
+    trace_.record(key);
+    if (auto blob = prefetcher_.take_blob(key, !pool_.on_worker_thread()))
+        return blob;
+    return find_packed(key);
+}
+std::optional<asset_blob> de2::find_packed(const std::string& key) {
+    std::shared_lock<std::shared_mutex> lock(packs_mutex_);
+    for (auto it = packs_.rbegin(); it != packs_.rend(); ++it) {
+        if (auto blob = (*it)->find(key))
+            return blob;
+    }
+    return std::nullopt;
+}
+std::shared_ptr<decoded_image> de2::take_prefetched_image(const std::string& key) {
+    trace_.record(key);
+    return prefetcher_.take_image(key, !pool_.on_worker_thread());
+}
+void de2::start_prefetch() {
+    static const std::unordered_set<std::string> image_types{ ".bmp", ".png", ".jpg", ".jpeg", ".tga", ".psd", ".gif", ".hdr", ".pic", ".pnm" };
+    for (auto& e : asset_trace::load(asset_trace_path)) {
+        std::string ext = std::filesystem::path(e.key).extension().string();
+        std::transform(ext.begin(), ext.end(), ext.begin(), [](char c) { return (char)tolower(c); });
+
+        if (image_types.contains(ext)) {
+            prefetcher_.add(e.key, read_raw_async(e.key, [](asset_blob blob) {
+                auto img = std::make_shared<decoded_image>();
+                img->data = stbi_load_from_memory(blob.data.data(), (int)blob.data.size(), &img->width, &img->height, &img->comp, 0);
+                if (img->data == nullptr)
+                    throw std::runtime_error("failed to decode prefetched image");
+                if (texture::cpu_mipmaps)
+                    img->data = append_mip_chain(img->data, img->width, img->height, img->comp, texture::srgb_mipmaps, img->levels);
+                return img;
+            }).share());
+        }
+        else {
+            prefetcher_.add(e.key, read_raw_async(e.key, [](asset_blob blob) { return blob; }).share());
+        }
+    }
+}
+void de2::save_asset_trace() {
+    if (!asset_trace_path.empty())
+        trace_.save(asset_trace_path);
+}
+std::future<std::shared_ptr<texture>> de2::load_texture_async(const std::string& path) {
+    //term: only an image the prefetcher has already decoded is adopted, one still in flight is read and decoded again
+    if (auto img = prefetcher_.take_image(path, false)) {
+        trace_.record(path);
+        return pool_.enqueue([img]() { return std::make_shared<texture>(*img); });
+    }
+    //term: a decoded copy skips both the read and the decode, a corrupt one falls back to the sync loader
+    std::string decoded = decoded_key("texture", path);
+    if (!decoded.empty() && decoded_cache_.contains(decoded)) {
+        return pool_.enqueue([this, path, decoded]() {
+            auto t = std::make_shared<texture>();
+            if (auto blob = decoded_cache_.try_get(decoded); blob && t->deserialize(**blob))
+                return t;
+            return std::make_shared<texture>(path);
+        });
+    }
+    return read_asset_async(path, [this, decoded](asset_blob blob) {
+        auto t = std::make_shared<texture>(blob.data.data(), blob.data.size());
+        if (!decoded.empty() && !t->compressed())
+            decoded_cache_.put(decoded, std::make_shared<const std::vector<unsigned char>>(t->serialize()));
+        return t;
+    });
+}
+std::future<std::shared_ptr<mesh>> de2::load_mesh_async(const std::string& path, bool is_left_handed) {
+    std::string decoded = decoded_key(is_left_handed ? "mesh" : "mesh_rh", path);
+    if (!decoded.empty() && decoded_cache_.contains(decoded)) {
+        return pool_.enqueue([path, is_left_handed]() {
+            std::string p = path;
+            return std::make_shared<mesh>(p, is_left_handed);
+        });
+    }
+    return read_asset_async(path, [this, path, is_left_handed, decoded](asset_blob blob) {
+        auto m = std::make_shared<mesh>();
+        m->name = path;
+        asset_streambuf buf(blob.data);
+        std::istream in(&buf);
+        if (!m->parse_obj(in, is_left_handed))
+            throw std::runtime_error("failed to parse mesh: " + path);
+        if (!decoded.empty())
+            decoded_cache_.put(decoded, std::make_shared<const std::vector<unsigned char>>(m->serialize()));
+        return m;
+    });
+}
 
 
 void de2::init() {
     glfwSetErrorCallback([](int error, const char* desc) { if (de2::get_instance().on_error) de2::get_instance().on_error(error, desc); });
 
     if (!glfwInit())
-        throw std::exception("failed to init glfw");
+        throw std::runtime_error("failed to init glfw");
 
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
@@ -47,10 +221,11 @@ void de2::init() {
     window = glfwCreateWindow(viewport.x, viewport.y, "", (GLFWmonitor*)NULL, (GLFWwindow*)NULL);
     if (window == NULL) {
         glfwTerminate();
-        throw std::exception("failed to create a window");
+        throw std::runtime_error("failed to create a window");
     }
 
     glfwMakeContextCurrent(window);
+    gl_deletions_.set_owner_thread();
     glfwSetFramebufferSizeCallback(window, [](GLFWwindow* window, int width, int height) { if (de2::get_instance().on_resize) de2::get_instance().on_resize(width, height); });
     glfwSetMouseButtonCallback(window, [](GLFWwindow* window, int button, int action, int mods) { if(de2::get_instance().mouse_button_callback) de2::get_instance().mouse_button_callback(window, button, action, mods);});
     glfwSetCursorPosCallback(window, [](GLFWwindow* window, double xpos, double ypos) {if(de2::get_instance().cursor_pos_callback) de2::get_instance().cursor_pos_callback(window, xpos, ypos);});
@@ -58,54 +233,132 @@ void de2::init() {
     glfwSetKeyCallback(window, [](GLFWwindow* window, int key, int scancode, int action, int mods){ if(de2::get_instance().on_key) de2::get_instance().on_key(key, scancode, action, mods); });
     
     if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
-        throw std::exception("failed to init glad");
+        throw std::runtime_error("failed to init glad");
 
     glEnable(GL_DEPTH_TEST);
     glEnable(GL_CULL_FACE);
     glCullFace(GL_BACK);
     glFrontFace(GL_CCW);
     resize(viewport.x, viewport.y);
+    texture_uploads_.init();
+
+    if (!asset_trace_path.empty()) {
+        start_prefetch();
+        trace_.start();
+    }
 }
 
 
 void de2::run() {
+#ifdef DE2_TRACING
+    tracer::set_thread_name("render");
+#endif
+#ifdef _DEBUG
+    //term: "name"_id keys never pass through the interning constructor, register them before the first frame
+    for (auto& [name, prg] : programs)
+        string_id::check(name);
+#endif
     auto begin = std::chrono::high_resolution_clock::now();
     auto fps_begin = std::chrono::high_resolution_clock::now();
     size_t cfps = 0;
     while (!glfwWindowShouldClose(window))
     {
         GLenum err = 0;
-        for (auto f : get_subs<pre_render>()) {
-            f(std::chrono::high_resolution_clock::now() - begin);
-        }
+        auto allocs_begin = alloc_tracker::current_thread();
+        render_stats::frame().reset();
+        bool capturing = !capture_frame_path.empty();
+        if (capturing)
+            gl_capture::begin();
+        std::chrono::high_resolution_clock::time_point end;
+        {
+            //term: a capture appends to its stream, so the frame it records is exempt from strict mode
+            std::optional<alloc_tracker::no_alloc_scope> no_alloc;
+            if (alloc_tracker::strict() && last_frame.index >= alloc_warmup_frames && !capturing)
+                no_alloc.emplace();
 
-        for (auto f : get_subs<render>()) {
-            f(std::chrono::high_resolution_clock::now() - begin);
-        }
+            profiler.enter(frame_phase::pre_render);
+            {
+                DE2_TRACE_SCOPE("frame", "pre_render");
+                for (auto& f : get_subs<pre_render>()) {
+                    f(std::chrono::high_resolution_clock::now() - begin);
+                }
+            }
+
+            profiler.enter(frame_phase::render);
+            {
+                DE2_TRACE_SCOPE("frame", "render");
+                for (auto& f : get_subs<render>()) {
+                    f(std::chrono::high_resolution_clock::now() - begin);
+                }
+            }
 
-        auto end = std::chrono::high_resolution_clock::now();
-        for (auto f : get_subs<post_render>()) {
-            f(std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin));
+            end = std::chrono::high_resolution_clock::now();
+            profiler.enter(frame_phase::post_render);
+            {
+                DE2_TRACE_SCOPE("frame", "post_render");
+                for (auto& f : get_subs<post_render>()) {
+                    f(std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin));
+                }
+            }
+        }
+        last_frame.index++;
+        last_frame.frame_time = std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin);
+        last_frame.allocations = alloc_tracker::current_thread() - allocs_begin;
+        last_frame.render = render_stats::frame();
+        //term: a failed capture is a debugging aid gone wrong, it must not stop the engine
+        if (capturing) {
+            try {
+                gl_capture::save(capture_frame_path, gl_capture::end());
+            }
+            catch (const std::exception& e) {
+                std::cerr << "capture of " << capture_frame_path << " failed: " << e.what() << std::endl;
+            }
+            capture_frame_path.clear();
         }
 
         begin = end;
 
         //term: fps counter;
         cfps++;
-        if (std::chrono::duration_cast<std::chrono::milliseconds>(end - begin).count() > 10000000) {
+        if (std::chrono::duration_cast<std::chrono::milliseconds>(end - fps_begin).count() >= 1000) {
             //perf = "Frame Time(msec): " + std::to_string(1000 / cfps) + " - ";
             fps = cfps;
             fps_begin = end;
             cfps = 0;
         }
 
-        glfwSwapBuffers(de2::get_instance().window);
-        glfwPollEvents();
+        profiler.enter(frame_phase::swap);
+        {
+            DE2_TRACE_SCOPE("frame", "swap");
+            int width = 0, height = 0;
+            glfwGetFramebufferSize(window, &width, &height);
+            recorder.capture(width, height);
+            glfwSwapBuffers(de2::get_instance().window);
+            glfwPollEvents();
+        }
+
+        profiler.enter(frame_phase::housekeeping);
+        {
+            DE2_TRACE_SCOPE("frame", "housekeeping");
+            //term: before next_frame, so the models drawn this frame still count as in use
+            residency_.enforce();
+            residency_.next_frame();
+            gl_deletions_.drain();
+            texture_uploads_.pump();
+            mip_residency_.update();
+            if (last_frame.index == prefetch_frames)
+                prefetcher_.release_unused();
+        }
         if (err != GL_NO_ERROR) {
             //TODO:: error handling
         }
     }
 
+    profiler.stop();
+    recorder.stop();
+    texture_uploads_.stop();
+    save_asset_trace();
+    gl_deletions_.drain();
     glfwDestroyWindow(window);
     glfwTerminate();
     exit(EXIT_SUCCESS);
@@ -113,14 +366,18 @@ void de2::run() {
 
 
 //RENDERER_SYSTEM
-renderer_system::renderer_system() {
+renderer_system::renderer_system(bool bind_input) {
     cam_ = std::make_shared<euler_angle_orbit>();
+    if (!bind_input)
+        return;
 
     de2::get_instance().mouse_button_callback = [&](GLFWwindow* window, int button, int action, int mods) { cam_->mouse_button_callback(window, button, action, mods); };
     de2::get_instance().mouse_wheel_callback = [&](GLFWwindow* window, double xoffset, double yoffset) { cam_->mouse_wheel_callback(window, xoffset, yoffset); };
     de2::get_instance().cursor_pos_callback = [&](GLFWwindow* window, double xpos, double ypos) { mouse_pos = { xpos, ypos }; cam_->cursor_pos_callback(window, xpos, ypos); };
 }
 void renderer_system::process(ecs_s::registry& world, std::chrono::nanoseconds& interval) {
+    if (gl_capture::recording())
+        gl_capture::clear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT, { 0.2f, 0.2f, 0.2f, 1.0f });
     glClearColor(0.2f, 0.2f, 0.2f, 1.0f);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
     if (de2::get_instance().viewport.x == 0 || de2::get_instance().viewport.x == 0)
@@ -128,24 +385,38 @@ void renderer_system::process(ecs_s::registry& world, std::chrono::nanoseconds&
 
     glm::mat4 view = get_view();
     glm::mat4 projection = get_projection();
+    de2::get_instance().mip_residency_.set_view(view, projection, de2::get_instance().viewport);
 
-    for (auto pp : de2::get_instance().programs) {
-        pp.second->setuniform("view", view);
-        pp.second->setuniform("projection", projection);
-        pp.second->setuniform("view_pos", cam_->get_world_pos());
+    for (auto& [name, prg] : de2::get_instance().programs) {
+        prg->setuniform("view"_id, view);
+        prg->setuniform("projection"_id, projection);
+        prg->setuniform("view_pos"_id, cam_->get_world_pos());
 
         if (l) {
-            pp.second->setuniform("light.ambient", l->ambient);
-            pp.second->setuniform("light.diffuse", l->diffuse);
-            pp.second->setuniform("light.specular", l->specular);
-            pp.second->setuniform("light.position", l->position);
+            prg->setuniform("light.ambient"_id, l->ambient);
+            prg->setuniform("light.diffuse"_id, l->diffuse);
+            prg->setuniform("light.specular"_id, l->specular);
+            prg->setuniform("light.position"_id, l->position);
         }
     }
 
+    //term: cached models drawn this frame are stamped so the residency manager won't evict them at the end of it
+    de2& engine = de2::get_instance();
     world.view<std::shared_ptr<model>, visible> ([&](ecs_s::entity e, std::shared_ptr<model>& m, visible v) {
+        if (m->cache_key != string_id{})
+            engine.residency_.touch(m->cache_key);
         m->draw();
     });
 
+    //term: handles resolve through the dense pool, stale ones are skipped
+    world.view<model_handle, visible>([&](ecs_s::entity e, model_handle& h, visible v) {
+        if (model* m = engine.get_model(h)) {
+            if (m->cache_key != string_id{})
+                engine.residency_.touch(m->cache_key);
+            m->draw();
+        }
+    });
+
 };
 
 glm::mat4 renderer_system::get_view() {
@@ -5,17 +5,35 @@
 //https://github.com/ademirtug/ecs_s/
 #include "../../ecs_s/ecs_s.hpp"
 #include "thread_pool.h"
+#include "asset_pack.h"
+#include "io_service.h"
+#include "asset_trace.h"
+#include "residency.h"
+#include "single_flight.hpp"
+#include "resource_pool.hpp"
+#include "alloc_tracker.h"
+#include "frame_profiler.h"
+#include "render_stats.h"
+#include "gl_capture.h"
+#include "frame_recorder.h"
+#include "texture_streamer.h"
+#include "mip_residency.h"
 #include <any>
+#include <shared_mutex>
 #include <iostream>
 
 class mesh;
 class model;
+class texture;
 class light;
 class camera;
 
 struct visible { bool value{ true }; };
 struct invisible {};
 
+//term: pod component resolving to a model in de2::models_
+using model_handle = handle<model>;
+
 template<typename T>
 class sub_system {
 public:
@@ -24,7 +42,7 @@ public:
 
 class renderer_system : public sub_system<std::chrono::nanoseconds> {
 public:
-    renderer_system();
+    renderer_system(bool bind_input = true);
     void enable_fill_mode();
     void enable_point_mode();
     void enable_wireframe_mode();
@@ -69,34 +87,81 @@ public:
     void set_title(const std::string& title);
     std::string get_title();
     void resize(size_t width, size_t height);
-    bool has_model(const std::string& key);
+    bool has_model(string_id key);
+    thread_pool& get_pool() { return pool_; }
+
+    //term: packs mounted later shadow earlier ones
+    void mount(const std::string& pack_path);
+    std::optional<asset_blob> read_asset(const std::string& key);
+    std::shared_ptr<decoded_image> take_prefetched_image(const std::string& key);
+    void save_asset_trace();
+    //term: render thread; models_ keeps the model resident until release_model, a released handle resolves to nullptr
+    model_handle add_model(std::shared_ptr<model> md) { return models_.emplace(std::move(md)); }
+    model* get_model(model_handle h) { auto md = models_.get(h); return md ? md->get() : nullptr; }
+    bool release_model(model_handle h) { return models_.release(h); }
+
+    void open_disk_cache(const std::string& path, size_t capacity_bytes);
+    //term: empty when the cache is off or the source is unknown
+    std::string decoded_key(const std::string& kind, const std::string& path);
+    //term: any thread, the delete runs on the render thread at the end of the next frame
+    void release_gl(std::function<void()> f) { gl_deletions_.release(std::move(f)); }
+
+    template<typename F>
+    auto read_asset_async(const std::string& key, F decode) -> std::future<std::invoke_result_t<F, asset_blob>> {
+        trace_.record(key);
+        if (auto blob = prefetcher_.take_blob(key, !pool_.on_worker_thread()))
+            return pool_.enqueue([decode, blob = *blob]() { return decode(blob); });
+        return read_raw_async(key, decode);
+    }
+    std::future<std::shared_ptr<texture>> load_texture_async(const std::string& path);
+    std::future<std::shared_ptr<mesh>> load_mesh_async(const std::string& path, bool is_left_handed = true);
+
+    std::shared_ptr<mesh> load_mesh(const std::string& path, bool is_left_handed = true);
+    std::shared_ptr<texture> load_texture(const std::string& path);
+    static std::string mesh_key(const std::string& path, bool is_left_handed = true);
+    static std::string texture_key(const std::string& path);
+    //term: returns the cached one when another copy won the race
+    std::shared_ptr<mesh> share_mesh(const std::string& key, std::shared_ptr<mesh> m);
+    std::shared_ptr<texture> share_texture(const std::string& key, std::shared_ptr<texture> t);
     
     template<typename T, typename ...Ts>
-    [[nodiscard]] std::shared_ptr<model> load_model(const std::string& key, Ts... args) {
-        if (model_cache_.exists(key))
-            return std::static_pointer_cast<T>(model_cache_.get(key));
+    [[nodiscard]] std::shared_ptr<model> load_model(string_id key, Ts... args) {
+        std::shared_ptr<model> md;
+        if (auto cached = model_cache_.try_get(key)) {
+            residency_.touch(key);
+            md = same_model_key(*cached, key);
+        }
+        else {
+            md = same_model_key(model_flights_.run(key, [&]() { return build_model<T>(key, args...); }).get(), key);
+        }
 
-        std::shared_ptr<T> md = std::make_shared<T>(std::forward<Ts>(args)...);
+        //term: models built on the pool get their gpu buffers here
         md->upload();
-        model_cache_.put(key, md);
+        residency_.update(key, md->cpu_bytes(), md->gpu_bytes());
         return md;
     }
+    //term: the result is not uploaded, call upload() on the render thread
     template<typename T, typename ...Ts>
-    [[nodiscard]] auto load_model_async(std::string key = "", Ts... args) -> decltype(auto) {
-        return pool_.enqueue([this, key, args...]() {
-            if (model_cache_.exists(key)) {
-                return model_cache_.get(key);
-            }
-            std::shared_ptr<model> md;
-            try {
-                md = std::make_shared<T>(args...);
-                return md;
-            }
-            catch (std::exception e) {
-                //std::cout << "pool error: key ->" << key << " - " << e.what();
-            }
-            return md;
-        });
+    [[nodiscard]] std::shared_future<std::shared_ptr<model>> load_model_async(string_id key = ""_id, Ts... args) {
+        if (auto cached = model_cache_.try_get(key)) {
+            residency_.touch(key);
+            std::promise<std::shared_ptr<model>> ready;
+            ready.set_value(same_model_key(*cached, key));
+            return ready.get_future().share();
+        }
+
+        auto [future, leader] = model_flights_.join(key);
+        if (leader) {
+            pool_.enqueue([this, key, args...]() {
+                try {
+                    model_flights_.complete(key, build_model<T>(key, args...));
+                }
+                catch (...) {
+                    model_flights_.fail(key, std::current_exception());
+                }
+            });
+        }
+        return future;
     }
     template<typename T, typename F>
     void on(F&& f) {
@@ -115,14 +180,99 @@ public:
     std::function<void (GLFWwindow* window, double xoffset, double yoffset)>    mouse_wheel_callback;
     std::function<void(GLFWwindow* window, int button, int action, int mods)>   mouse_button_callback;
 
-    std::unordered_map<std::string, std::shared_ptr<program>> programs;
+    std::unordered_map<string_id, std::shared_ptr<program>> programs;
     glm::vec2 viewport{ 1024, 768 };
     GLFWwindow* window{ nullptr };
     size_t fps{ 0 };
-    thread_safe_lru_cache<std::string, std::shared_ptr<model>> model_cache_;
+    struct frame_stats {
+        uint64_t index{ 0 };
+        std::chrono::nanoseconds frame_time{ 0 };
+        alloc_tracker::counts allocations;
+        render_stats render;
+    } last_frame;
+    frame_profiler profiler;
+    //term: one shot, cleared once the next frame is captured
+    std::string capture_frame_path;
+    frame_recorder recorder;
+    uint64_t alloc_warmup_frames{ 120 };
+    //term: declared before the caches so it outlives the resources queued into it
+    gl_deletion_queue gl_deletions_;
+    //term: declared before the caches so it outlives their textures
+    texture_streamer texture_uploads_;
+    //term: set enabled before loading
+    mip_residency mip_residency_;
+    residency_manager residency_;
+    thread_safe_lru_cache<string_id, std::shared_ptr<model>> model_cache_;
+    resource_pool<std::shared_ptr<model>, model> models_;
+    thread_safe_lru_cache<std::string, std::shared_ptr<mesh>> mesh_cache_;
+    thread_safe_lru_cache<std::string, std::shared_ptr<texture>> texture_cache_;
+    thread_safe_lru_cache<std::string, std::shared_ptr<const std::vector<unsigned char>>, 64, 4> decoded_cache_;
+
+    //term: set before init
+    std::string asset_trace_path;
+    uint64_t prefetch_frames{ 600 };
+    asset_trace trace_;
+    asset_prefetcher prefetcher_;
 protected:
     de2();
     thread_pool pool_;
+    io_service io_{ pool_ };
+    std::vector<std::shared_ptr<asset_pack>> packs_;
+    std::shared_mutex packs_mutex_;
+    std::string title_;
+
+    std::optional<asset_blob> find_packed(const std::string& key);
+    void start_prefetch();
+    //term: a resource still held outside its cache is not evicted, models in models_ count as held
+    template<typename K, typename T>
+    void track_residency(const K& key, thread_safe_lru_cache<K, std::shared_ptr<T>>& cache, const std::shared_ptr<T>& r) {
+        string_id id;
+        if constexpr (std::is_same_v<K, string_id>)
+            id = key;
+        else
+            id = string_id::hashed(key);
+        residency_.track(id, r->cpu_bytes(), r->gpu_bytes(), [&cache, key]() {
+            auto cached = cache.peek(key);
+            if (cached && cached->use_count() > 2)
+                return false;
+            cache.erase(key);
+            return true;
+        }, &cache.stats());
+    }
+
+    //term: model keys are compared by hash, a cached model under another name is a collision, not a hit
+    static const std::shared_ptr<model>& same_model_key(const std::shared_ptr<model>& md, string_id key) {
+        if (md && md->cache_key.c_str() != key.c_str() && strcmp(md->cache_key.c_str(), key.c_str()) != 0)
+            throw std::runtime_error(std::string("model cache: '") + md->cache_key.c_str() + "' and '" + key.c_str() + "' share a hash");
+        return md;
+    }
+
+    single_flight<string_id, std::shared_ptr<model>> model_flights_;
+    single_flight<std::string, std::shared_ptr<mesh>> mesh_flights_;
+    single_flight<std::string, std::shared_ptr<texture>> texture_flights_;
+
+    template<typename T, typename ...Ts>
+    std::shared_ptr<model> build_model(string_id key, Ts... args) {
+        if (auto cached = model_cache_.try_get(key))
+            return same_model_key(*cached, key);
+        string_id::check(key);
+        auto begin = std::chrono::steady_clock::now();
+        std::shared_ptr<model> md = std::make_shared<T>(args...);
+        model_cache_.stats().miss_latency.record(std::chrono::steady_clock::now() - begin);
+        md->cache_key = key;
+        model_cache_.put(key, md);
+        track_residency(key, model_cache_, md);
+        return md;
+    }
+
+    template<typename F>
+    auto read_raw_async(const std::string& key, F decode) -> std::future<std::invoke_result_t<F, asset_blob>> {
+        if (auto blob = find_packed(key))
+            return pool_.enqueue([decode, blob = *blob]() { return decode(blob); });
+        return io_.read_async(key, [decode](std::shared_ptr<io_buffer> buffer) {
+            return decode(asset_blob{ buffer->span(), buffer });
+        });
+    }
     
 };
 
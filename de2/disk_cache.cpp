@@ -0,0 +1,306 @@
+#include "pch.h"
+#include "disk_cache.h"
+#include "string_id.h"
+#include <cstring>
+
+namespace {
+	const char disk_magic[8] = { 'D', 'E', '2', 'D', 'I', 'S', 'K', '\0' };
+	const uint32_t disk_version = 1;
+	const size_t page_size = 4096;
+	const size_t extent_alignment = 64;
+
+	enum slot_state : uint32_t { slot_empty = 0, slot_valid = 1 };
+
+	size_t align_up(size_t v, size_t a) {
+		return (v + a - 1) / a * a;
+	}
+}
+
+struct disk_cache::header {
+	char magic[8];
+	uint32_t version;
+	uint32_t slot_count;
+	uint64_t capacity;
+	uint64_t data_offset;
+	uint64_t clock;
+};
+
+//term: the blob extent holds the key bytes followed by the value, data_crc covers both
+struct disk_cache::slot {
+	uint64_t offset, size;
+	uint64_t key_hash;
+	uint32_t key_size, data_crc;
+	uint32_t state, slot_crc;
+	//term: lru clock, left out of slot_crc so touching an entry is a single unflushed store
+	uint64_t stamp;
+	uint8_t reserved[16];
+};
+static_assert(sizeof(disk_cache::slot) == 64, "disk_cache::slot must stay 64 bytes");
+
+uint32_t disk_cache::crc32(const unsigned char* data, size_t size, uint32_t crc) {
+	static const std::array<uint32_t, 256> table = []() {
+		std::array<uint32_t, 256> t{};
+		for (uint32_t i = 0; i < 256; i++) {
+			uint32_t c = i;
+			for (int k = 0; k < 8; k++)
+				c = c & 1 ? 0xedb88320u ^ (c >> 1) : c >> 1;
+			t[i] = c;
+		}
+		return t;
+	}();
+
+	crc = ~crc;
+	for (size_t i = 0; i < size; i++)
+		crc = table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+	return ~crc;
+}
+static uint32_t slot_checksum(const disk_cache::slot& s) {
+	return disk_cache::crc32((const unsigned char*)&s, offsetof(disk_cache::slot, slot_crc));
+}
+
+disk_cache::disk_cache(const std::string& path, size_t capacity_bytes, uint32_t slot_count) : slot_count_(slot_count) {
+	if (slot_count == 0)
+		throw std::invalid_argument("disk_cache: slot_count must not be zero");
+	capacity_ = align_up(capacity_bytes, page_size);
+	data_offset_ = align_up(page_size + (size_t)slot_count * sizeof(slot), page_size);
+	file_ = std::make_unique<mapped_file>(path, data_offset_ + capacity_);
+
+	header& h = head();
+	if (memcmp(h.magic, disk_magic, sizeof(disk_magic)) == 0 && h.version == disk_version && h.slot_count == slot_count_
+		&& h.capacity == capacity_ && h.data_offset == data_offset_)
+		load();
+	else
+		format();
+}
+disk_cache::~disk_cache() {
+	try {
+		flush();
+	}
+	catch (...) {
+	}
+}
+
+disk_cache::header& disk_cache::head() {
+	return *(header*)file_->writable_data();
+}
+disk_cache::slot& disk_cache::slot_at(uint32_t i) {
+	return *(slot*)(file_->writable_data() + page_size + (size_t)i * sizeof(slot));
+}
+
+void disk_cache::format() {
+	//term: slots are cleared and flushed before the header is written, a crash in between leaves an unrecognized file
+	memset(file_->writable_data(), 0, data_offset_);
+	file_->flush(0, data_offset_);
+
+	header& h = head();
+	h.version = disk_version;
+	h.slot_count = slot_count_;
+	h.capacity = capacity_;
+	h.data_offset = data_offset_;
+	h.clock = 0;
+	memcpy(h.magic, disk_magic, sizeof(disk_magic));
+	file_->flush(0, sizeof(header));
+
+	index_.clear();
+	order_.clear();
+	free_.clear();
+	free_[0] = capacity_;
+	free_slots_.clear();
+	for (uint32_t i = slot_count_; i > 0; i--)
+		free_slots_.push_back(i - 1);
+	used_ = 0;
+	clock_ = 0;
+}
+
+void disk_cache::load() {
+	struct live {
+		uint32_t slot;
+		uint64_t offset, size, stamp;
+	};
+	std::vector<live> entries;
+	const unsigned char* data = file_->data() + data_offset_;
+	clock_ = head().clock;
+
+	for (uint32_t i = 0; i < slot_count_; i++) {
+		slot& s = slot_at(i);
+		if (s.state != slot_valid)
+			continue;
+		bool sane = s.slot_crc == slot_checksum(s) && s.offset % extent_alignment == 0 && s.offset <= capacity_
+			&& s.size <= capacity_ - s.offset && s.key_size <= s.size;
+		if (sane)
+			entries.push_back({ i, s.offset, s.size, s.stamp });
+		else
+			s.state = slot_empty;
+	}
+
+	//term: extents of a crashed eviction can overlap a newer write, keep the first and let data_crc judge it on read
+	std::sort(entries.begin(), entries.end(), [](const live& a, const live& b) { return a.offset < b.offset; });
+	std::vector<live> kept;
+	size_t cursor = 0;
+	for (auto& e : entries) {
+		slot& s = slot_at(e.slot);
+		std::string key((const char*)data + e.offset, s.key_size);
+		if (e.offset < cursor || s.key_hash != fnv1a_64(key) || index_.contains(key)) {
+			s.state = slot_empty;
+			continue;
+		}
+		if (e.offset > cursor)
+			free_[cursor] = e.offset - cursor;
+		cursor = e.offset + align_up(e.size, extent_alignment);
+		used_ += align_up(e.size, extent_alignment);
+		index_[key] = { e.slot, false, order_.end() };
+		kept.push_back(e);
+		clock_ = std::max(clock_, e.stamp);
+	}
+	if (cursor < capacity_)
+		free_[cursor] = capacity_ - cursor;
+
+	std::sort(kept.begin(), kept.end(), [](const live& a, const live& b) { return a.stamp > b.stamp; });
+	for (auto& e : kept) {
+		slot& s = slot_at(e.slot);
+		std::string key((const char*)data + e.offset, s.key_size);
+		order_.push_back(key);
+		index_[key].order = std::prev(order_.end());
+	}
+
+	for (uint32_t i = slot_count_; i > 0; i--) {
+		if (slot_at(i - 1).state != slot_valid)
+			free_slots_.push_back(i - 1);
+	}
+}
+
+void disk_cache::write_slot(uint32_t i, const slot& s) {
+	slot_at(i) = s;
+	file_->flush(page_size + (size_t)i * sizeof(slot), sizeof(slot));
+}
+void disk_cache::release(std::unordered_map<std::string, entry>::iterator it) {
+	slot& s = slot_at(it->second.slot);
+	//term: not flushed, a stale valid slot fails its data_crc once the extent is reused
+	s.state = slot_empty;
+	free_extent((size_t)s.offset, align_up((size_t)s.size, extent_alignment));
+	used_ -= align_up((size_t)s.size, extent_alignment);
+	free_slots_.push_back(it->second.slot);
+	order_.erase(it->second.order);
+	index_.erase(it);
+}
+void disk_cache::free_extent(size_t offset, size_t size) {
+	auto it = free_.emplace(offset, size).first;
+	auto next = std::next(it);
+	if (next != free_.end() && it->first + it->second == next->first) {
+		it->second += next->second;
+		free_.erase(next);
+	}
+	if (it != free_.begin()) {
+		auto prev = std::prev(it);
+		if (prev->first + prev->second == it->first) {
+			prev->second += it->second;
+			free_.erase(it);
+		}
+	}
+}
+std::optional<size_t> disk_cache::allocate(size_t size) {
+	size = align_up(size, extent_alignment);
+	for (auto it = free_.begin(); it != free_.end(); ++it) {
+		if (it->second < size)
+			continue;
+		size_t offset = it->first, remaining = it->second - size;
+		free_.erase(it);
+		if (remaining)
+			free_[offset + size] = remaining;
+		return offset;
+	}
+	return std::nullopt;
+}
+
+std::optional<std::vector<unsigned char>> disk_cache::get(const std::string& key) {
+	std::unique_lock<std::mutex> lock(mutex_);
+	auto it = index_.find(key);
+	if (it == index_.end())
+		return std::nullopt;
+
+	slot& s = slot_at(it->second.slot);
+	const unsigned char* p = file_->data() + data_offset_ + s.offset;
+	if (!it->second.verified) {
+		if (crc32(p, (size_t)s.size) != s.data_crc) {
+			release(it);
+			return std::nullopt;
+		}
+		it->second.verified = true;
+	}
+
+	s.stamp = ++clock_;
+	order_.splice(order_.begin(), order_, it->second.order);
+	return std::vector<unsigned char>(p + s.key_size, p + s.size);
+}
+
+bool disk_cache::put(const std::string& key, std::span<const unsigned char> data) {
+	size_t size = key.size() + data.size();
+	if (align_up(size, extent_alignment) > capacity_)
+		return false;
+
+	std::unique_lock<std::mutex> lock(mutex_);
+	if (auto it = index_.find(key); it != index_.end())
+		release(it);
+
+	//term: evict from the cold end until both a slot and a large enough extent are free
+	std::optional<size_t> offset;
+	while (free_slots_.empty() || !(offset = allocate(size))) {
+		if (order_.empty())
+			return false;
+		release(index_.find(order_.back()));
+	}
+
+	//term: blob first and flushed, the slot that makes it visible is written last
+	unsigned char* p = file_->writable_data() + data_offset_ + *offset;
+	memcpy(p, key.data(), key.size());
+	if (!data.empty())
+		memcpy(p + key.size(), data.data(), data.size());
+	file_->flush(data_offset_ + *offset, size);
+
+	slot s{};
+	s.offset = *offset;
+	s.size = size;
+	s.key_hash = fnv1a_64(key);
+	s.key_size = (uint32_t)key.size();
+	s.data_crc = crc32(p, size);
+	s.state = slot_valid;
+	s.stamp = ++clock_;
+	s.slot_crc = slot_checksum(s);
+
+	uint32_t i = free_slots_.back();
+	free_slots_.pop_back();
+	write_slot(i, s);
+
+	order_.push_front(key);
+	index_[key] = { i, true, order_.begin() };
+	used_ += align_up(size, extent_alignment);
+	return true;
+}
+
+bool disk_cache::contains(const std::string& key) {
+	std::unique_lock<std::mutex> lock(mutex_);
+	return index_.contains(key);
+}
+bool disk_cache::erase(const std::string& key) {
+	std::unique_lock<std::mutex> lock(mutex_);
+	auto it = index_.find(key);
+	if (it == index_.end())
+		return false;
+	uint32_t i = it->second.slot;
+	release(it);
+	file_->flush(page_size + (size_t)i * sizeof(slot), sizeof(slot));
+	return true;
+}
+void disk_cache::flush() {
+	std::unique_lock<std::mutex> lock(mutex_);
+	head().clock = clock_;
+	file_->flush(0, data_offset_);
+}
+size_t disk_cache::size() {
+	std::unique_lock<std::mutex> lock(mutex_);
+	return index_.size();
+}
+size_t disk_cache::used_bytes() {
+	std::unique_lock<std::mutex> lock(mutex_);
+	return used_;
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include "mapped_file.h"
+#include <map>
+#include <list>
+#include <span>
+#include <mutex>
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <optional>
+#include <unordered_map>
+
+//term: slots and blobs carry crc32s, a torn write after a crash only loses that entry
+class disk_cache {
+public:
+	disk_cache(const std::string& path, size_t capacity_bytes, uint32_t slot_count = 16384);
+	~disk_cache();
+	disk_cache(const disk_cache& other) = delete;
+	disk_cache& operator=(const disk_cache& other) = delete;
+
+	std::optional<std::vector<unsigned char>> get(const std::string& key);
+	//term: returns false when the blob can never fit
+	bool put(const std::string& key, std::span<const unsigned char> data);
+	bool contains(const std::string& key);
+	bool erase(const std::string& key);
+	void flush();
+
+	size_t size();
+	size_t used_bytes();
+	size_t capacity() const { return capacity_; }
+
+	static uint32_t crc32(const unsigned char* data, size_t size, uint32_t crc = 0);
+
+	struct header;
+	struct slot;
+
+protected:
+	std::unique_ptr<mapped_file> file_;
+	size_t capacity_{ 0 }, data_offset_{ 0 }, used_{ 0 };
+	uint32_t slot_count_{ 0 };
+	uint64_t clock_{ 0 };
+
+	struct entry {
+		uint32_t slot;
+		bool verified;
+		std::list<std::string>::iterator order;
+	};
+	std::unordered_map<std::string, entry> index_;
+	std::list<std::string> order_;
+	std::map<size_t, size_t> free_;
+	std::vector<uint32_t> free_slots_;
+	std::mutex mutex_;
+
+	header& head();
+	slot& slot_at(uint32_t i);
+	void format();
+	void load();
+	void release(std::unordered_map<std::string, entry>::iterator it);
+	void free_extent(size_t offset, size_t size);
+	std::optional<size_t> allocate(size_t size);
+	void write_slot(uint32_t i, const slot& s);
+};
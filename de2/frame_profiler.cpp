@@ -0,0 +1,339 @@
+#include "pch.h"
+#include "frame_profiler.h"
+#include <cstring>
+#ifdef __linux__
+#include <time.h>
+#include <dlfcn.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <cxxabi.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+const char* to_string(frame_phase p) {
+	switch (p) {
+	case frame_phase::idle: return "idle";
+	case frame_phase::pre_render: return "pre_render";
+	case frame_phase::render: return "render";
+	case frame_phase::post_render: return "post_render";
+	case frame_phase::swap: return "swap";
+	case frame_phase::housekeeping: return "housekeeping";
+	default: return "unknown";
+	}
+}
+
+std::string frame_profiler::report::to_json() const {
+	std::ostringstream o;
+	o << "{\"frames\":" << frames << ",\"lost_samples\":" << lost_samples << ",\"hardware_counters\":" << (hardware_counters ? "true" : "false")
+		<< ",\"phases\":{";
+	for (size_t i = 0; i < phases.size(); i++) {
+		const phase_stats& p = phases[i];
+		o << (i ? "," : "") << "\"" << to_string((frame_phase)i) << "\":{\"time_ns\":" << p.time_ns << ",\"samples\":" << p.samples
+			<< ",\"other_samples\":" << p.other_samples << ",\"cycles\":" << p.cycles << ",\"instructions\":" << p.instructions
+			<< ",\"llc_misses\":" << p.llc_misses << ",\"branch_misses\":" << p.branch_misses
+			<< ",\"ipc\":" << p.ipc() << ",\"llc_mpki\":" << p.llc_mpki() << "}";
+	}
+	o << "},\"hotspots\":[";
+	for (size_t i = 0; i < hotspots.size(); i++) {
+		std::string symbol;
+		for (char c : hotspots[i].symbol) {
+			if (c == '"' || c == '\\')
+				symbol += '\\';
+			symbol += c;
+		}
+		o << (i ? "," : "") << "{\"phase\":\"" << to_string(hotspots[i].phase) << "\",\"ip\":\"0x" << std::hex << hotspots[i].ip << std::dec
+			<< "\",\"samples\":" << hotspots[i].samples << ",\"symbol\":\"" << symbol << "\"}";
+	}
+	o << "]}";
+	return o.str();
+}
+
+frame_profiler::~frame_profiler() {
+	stop();
+}
+
+#ifdef __linux__
+namespace {
+	//term: data pages per sampled thread, a power of two; about 10ms of samples at the default rate fit many times over
+	const size_t ring_pages = 8;
+
+	uint64_t monotonic_ns() {
+		timespec ts;
+		clock_gettime(CLOCK_MONOTONIC, &ts);
+		return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+	}
+	int perf_open(perf_event_attr& attr, pid_t tid, int group) {
+		return (int)syscall(SYS_perf_event_open, &attr, tid, -1, group, PERF_FLAG_FD_CLOEXEC);
+	}
+	void copy_ring(const unsigned char* data, uint64_t size, uint64_t pos, void* out, size_t n) {
+		size_t offset = pos & (size - 1), first = std::min<size_t>(n, size - offset);
+		memcpy(out, data + offset, first);
+		memcpy((unsigned char*)out + first, data, n - first);
+	}
+}
+
+bool frame_profiler::start(uint32_t sample_hz) {
+	if (running_)
+		return true;
+	error_.clear();
+	main_tid_ = (uint32_t)syscall(SYS_gettid);
+	size_t page = (size_t)sysconf(_SC_PAGESIZE);
+
+	//term: the hardware group is optional, virtual machines often hide the pmu
+	const uint64_t configs[4] = { PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES };
+	for (int i = 0; i < 4; i++) {
+		perf_event_attr attr{};
+		attr.size = sizeof(attr);
+		attr.type = PERF_TYPE_HARDWARE;
+		attr.config = configs[i];
+		attr.read_format = PERF_FORMAT_GROUP;
+		attr.exclude_kernel = 1;
+		attr.exclude_hv = 1;
+		counter_fds_[i] = perf_open(attr, 0, i ? counter_fds_[0] : -1);
+		if (counter_fds_[i] < 0) {
+			error_ = std::string("hardware counters unavailable: ") + strerror(errno);
+			for (int& fd : counter_fds_) {
+				if (fd >= 0)
+					close(fd);
+				fd = -1;
+			}
+			break;
+		}
+	}
+
+	DIR* dir = opendir("/proc/self/task");
+	while (dirent* e = dir ? readdir(dir) : nullptr) {
+		if (e->d_name[0] == '.')
+			continue;
+		perf_event_attr attr{};
+		attr.size = sizeof(attr);
+		attr.type = PERF_TYPE_SOFTWARE;
+		attr.config = PERF_COUNT_SW_TASK_CLOCK;
+		attr.freq = 1;
+		attr.sample_freq = sample_hz;
+		attr.sample_type = PERF_SAMPLE_IP | PERF_SAMPLE_TID | PERF_SAMPLE_TIME;
+		attr.use_clockid = 1;
+		attr.clockid = CLOCK_MONOTONIC;
+		attr.exclude_kernel = 1;
+		attr.exclude_hv = 1;
+
+		sampler s;
+		s.tid = (uint32_t)atoi(e->d_name);
+		s.fd = perf_open(attr, (pid_t)s.tid, -1);
+		if (s.fd < 0) {
+			error_ = std::string("sampling unavailable: ") + strerror(errno);
+			continue;
+		}
+		s.ring_size = (ring_pages + 1) * page;
+		s.ring = mmap(nullptr, s.ring_size, PROT_READ | PROT_WRITE, MAP_SHARED, s.fd, 0);
+		if (s.ring == MAP_FAILED) {
+			close(s.fd);
+			continue;
+		}
+		samplers_.push_back(s);
+	}
+	if (dir)
+		closedir(dir);
+
+	if (samplers_.empty() && counter_fds_[0] < 0) {
+		error_ += ", check /proc/sys/kernel/perf_event_paranoid";
+		return false;
+	}
+
+	totals_.hardware_counters = counter_fds_[0] >= 0;
+	read_counters(last_counters_);
+	last_ns_ = monotonic_ns();
+	phase_ = frame_phase::idle;
+	running_ = true;
+	stop_ = false;
+	collector_ = std::thread([this]() {
+		while (!stop_.load()) {
+			std::this_thread::sleep_for(std::chrono::milliseconds(10));
+			drain();
+		}
+		drain();
+	});
+	return true;
+}
+
+void frame_profiler::stop() {
+	if (!running_)
+		return;
+	switch_phase(frame_phase::idle);
+	stop_ = true;
+	collector_.join();
+	close_all();
+	running_ = false;
+}
+
+void frame_profiler::close_all() {
+	for (auto& s : samplers_) {
+		munmap(s.ring, s.ring_size);
+		close(s.fd);
+	}
+	samplers_.clear();
+	for (int& fd : counter_fds_) {
+		if (fd >= 0)
+			close(fd);
+		fd = -1;
+	}
+}
+
+bool frame_profiler::read_counters(uint64_t* values) {
+	if (counter_fds_[0] < 0)
+		return false;
+	struct {
+		uint64_t nr;
+		uint64_t values[4];
+	} group;
+	if (read(counter_fds_[0], &group, sizeof(group)) != (ssize_t)sizeof(group))
+		return false;
+	memcpy(values, group.values, sizeof(group.values));
+	return true;
+}
+
+void frame_profiler::switch_phase(frame_phase p) {
+	uint64_t now = monotonic_ns();
+	uint64_t values[4];
+	bool counted = read_counters(values);
+	{
+		std::unique_lock<std::mutex> lock(mutex_);
+		phase_stats& s = totals_.phases[(size_t)phase_];
+		s.time_ns += now - last_ns_;
+		if (counted) {
+			s.cycles += values[0] - last_counters_[0];
+			s.instructions += values[1] - last_counters_[1];
+			s.llc_misses += values[2] - last_counters_[2];
+			s.branch_misses += values[3] - last_counters_[3];
+		}
+		if (p == frame_phase::pre_render)
+			totals_.frames++;
+	}
+	if (counted)
+		memcpy(last_counters_, values, sizeof(values));
+	last_ns_ = now;
+	phase_ = p;
+
+	uint64_t seq = transition_seq_.load(std::memory_order_relaxed);
+	transitions_[seq % transition_count].store(now << 3 | (uint64_t)p, std::memory_order_relaxed);
+	transition_seq_.store(seq + 1, std::memory_order_release);
+}
+
+frame_phase frame_profiler::phase_at(uint64_t ns) {
+	uint64_t seq = transition_seq_.load(std::memory_order_acquire);
+	uint64_t lo = seq > transition_count ? seq - transition_count : 0, hi = seq;
+	if (lo == hi || (transitions_[lo % transition_count].load(std::memory_order_relaxed) >> 3) > ns)
+		return frame_phase::idle;
+	while (hi - lo > 1) {
+		uint64_t mid = lo + (hi - lo) / 2;
+		if ((transitions_[mid % transition_count].load(std::memory_order_relaxed) >> 3) <= ns)
+			lo = mid;
+		else
+			hi = mid;
+	}
+	return (frame_phase)(transitions_[lo % transition_count].load(std::memory_order_relaxed) & 7);
+}
+
+void frame_profiler::drain() {
+	struct sample {
+		uint64_t ip;
+		uint32_t pid, tid;
+		uint64_t time;
+	};
+	std::vector<std::pair<frame_phase, sample>> batch;
+	uint64_t lost = 0;
+	size_t page = (size_t)sysconf(_SC_PAGESIZE);
+
+	for (auto& s : samplers_) {
+		auto* meta = (perf_event_mmap_page*)s.ring;
+		const unsigned char* data = (const unsigned char*)s.ring + page;
+		uint64_t size = ring_pages * page;
+		uint64_t head = __atomic_load_n(&meta->data_head, __ATOMIC_ACQUIRE);
+		uint64_t tail = meta->data_tail;
+		while (tail < head) {
+			perf_event_header h;
+			copy_ring(data, size, tail, &h, sizeof(h));
+			if (h.size == 0)
+				break;
+			if (h.type == PERF_RECORD_SAMPLE) {
+				sample r;
+				copy_ring(data, size, tail + sizeof(h), &r, sizeof(r));
+				batch.push_back({ phase_at(r.time), r });
+			}
+			else if (h.type == PERF_RECORD_LOST) {
+				uint64_t record[2];
+				copy_ring(data, size, tail + sizeof(h), record, sizeof(record));
+				lost += record[1];
+			}
+			tail += h.size;
+		}
+		__atomic_store_n(&meta->data_tail, tail, __ATOMIC_RELEASE);
+	}
+
+	std::unique_lock<std::mutex> lock(mutex_);
+	totals_.lost_samples += lost;
+	for (auto& [p, r] : batch) {
+		phase_stats& ps = totals_.phases[(size_t)p];
+		(r.tid == main_tid_ ? ps.samples : ps.other_samples)++;
+		ips_[(size_t)p][r.ip]++;
+	}
+}
+#else
+bool frame_profiler::start(uint32_t sample_hz) {
+	error_ = "frame_profiler needs linux perf_event_open";
+	return false;
+}
+void frame_profiler::stop() {
+}
+void frame_profiler::close_all() {
+}
+bool frame_profiler::read_counters(uint64_t* values) {
+	return false;
+}
+void frame_profiler::switch_phase(frame_phase p) {
+}
+frame_phase frame_profiler::phase_at(uint64_t ns) {
+	return frame_phase::idle;
+}
+void frame_profiler::drain() {
+}
+#endif
+
+frame_profiler::report frame_profiler::get_report(size_t top_hotspots) {
+	report r;
+	{
+		std::unique_lock<std::mutex> lock(mutex_);
+		r = totals_;
+		for (size_t p = 0; p < ips_.size(); p++) {
+			std::vector<std::pair<uint64_t, uint64_t>> ips(ips_[p].begin(), ips_[p].end());
+			size_t n = std::min(top_hotspots, ips.size());
+			std::partial_sort(ips.begin(), ips.begin() + n, ips.end(), [](auto& a, auto& b) { return a.second > b.second; });
+			for (size_t i = 0; i < n; i++)
+				r.hotspots.push_back({ (frame_phase)p, ips[i].first, ips[i].second, "" });
+		}
+	}
+
+#ifdef __linux__
+	for (auto& h : r.hotspots) {
+		Dl_info info;
+		if (!dladdr((void*)h.ip, &info) || !info.dli_sname)
+			continue;
+		int status = 0;
+		char* demangled = abi::__cxa_demangle(info.dli_sname, nullptr, nullptr, &status);
+		h.symbol = status == 0 && demangled ? demangled : info.dli_sname;
+		free(demangled);
+	}
+#endif
+	return r;
+}
+
+void frame_profiler::reset() {
+	std::unique_lock<std::mutex> lock(mutex_);
+	bool hardware = totals_.hardware_counters;
+	totals_ = report();
+	totals_.hardware_counters = hardware;
+	for (auto& m : ips_)
+		m.clear();
+}
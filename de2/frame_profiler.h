@@ -0,0 +1,94 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <unordered_map>
+
+enum class frame_phase : uint32_t { idle, pre_render, render, post_render, swap, housekeeping, count };
+const char* to_string(frame_phase p);
+
+//term: linux perf_event_open; samples of every thread go to the frame phase the render thread was in at that time
+//the render thread also reads a hardware counter group at each phase change, so each phase gets its own cycles, instructions, llc and branch misses
+//elsewhere start() fails and enter() stays a single branch
+class frame_profiler {
+public:
+	struct phase_stats {
+		uint64_t time_ns{ 0 }, cycles{ 0 }, instructions{ 0 }, llc_misses{ 0 }, branch_misses{ 0 };
+		uint64_t samples{ 0 }, other_samples{ 0 };
+
+		double ipc() const { return cycles ? (double)instructions / cycles : 0; }
+		double llc_mpki() const { return instructions ? 1000.0 * llc_misses / instructions : 0; }
+	};
+	struct hotspot {
+		frame_phase phase;
+		uint64_t ip, samples;
+		std::string symbol;
+	};
+	struct report {
+		std::array<phase_stats, (size_t)frame_phase::count> phases{};
+		uint64_t frames{ 0 }, lost_samples{ 0 };
+		bool hardware_counters{ false };
+		std::vector<hotspot> hotspots;
+		std::string to_json() const;
+	};
+
+	frame_profiler() = default;
+	~frame_profiler();
+	frame_profiler(const frame_profiler& other) = delete;
+	frame_profiler& operator=(const frame_profiler& other) = delete;
+
+	//term: render thread, after the worker threads exist; threads created later are not sampled
+	bool start(uint32_t sample_hz = 997);
+	void stop();
+	bool running() const { return running_; }
+	const std::string& last_error() const { return error_; }
+
+	//term: render thread only, no allocation
+	void enter(frame_phase p) {
+		if (running_)
+			switch_phase(p);
+	}
+
+	report get_report(size_t top_hotspots = 10);
+	void reset();
+
+protected:
+	struct sampler {
+		int fd{ -1 };
+		void* ring{ nullptr };
+		size_t ring_size{ 0 };
+		uint32_t tid{ 0 };
+	};
+
+	bool running_{ false };
+	std::string error_;
+	uint32_t main_tid_{ 0 };
+	std::vector<sampler> samplers_;
+	int counter_fds_[4]{ -1, -1, -1, -1 };
+	uint64_t last_counters_[4]{};
+	uint64_t last_ns_{ 0 };
+	frame_phase phase_{ frame_phase::idle };
+
+	//term: phase changes as (time << 3 | phase), a ring the collector searches to place each sample
+	static constexpr size_t transition_count = 4096;
+	std::array<std::atomic<uint64_t>, transition_count> transitions_{};
+	std::atomic<uint64_t> transition_seq_{ 0 };
+
+	std::mutex mutex_;
+	report totals_;
+	std::array<std::unordered_map<uint64_t, uint64_t>, (size_t)frame_phase::count> ips_;
+
+	std::thread collector_;
+	std::atomic<bool> stop_{ false };
+
+	void switch_phase(frame_phase p);
+	bool read_counters(uint64_t* values);
+	frame_phase phase_at(uint64_t ns);
+	void drain();
+	void close_all();
+};
@@ -0,0 +1,331 @@
+#include "pch.h"
+#include "frame_recorder.h"
+#include "disk_cache.h"
+#include "tracer.h"
+#include <cstdio>
+#include <iostream>
+
+namespace {
+	void put_be32(std::vector<unsigned char>& out, uint32_t v) {
+		out.push_back((unsigned char)(v >> 24));
+		out.push_back((unsigned char)(v >> 16));
+		out.push_back((unsigned char)(v >> 8));
+		out.push_back((unsigned char)v);
+	}
+	void put_chunk(std::vector<unsigned char>& out, const char* type, const std::vector<unsigned char>& data) {
+		put_be32(out, (uint32_t)data.size());
+		size_t begin = out.size();
+		out.insert(out.end(), type, type + 4);
+		out.insert(out.end(), data.begin(), data.end());
+		put_be32(out, disk_cache::crc32(out.data() + begin, out.size() - begin));
+	}
+
+	//term: full range bt.601 (jfif), what C420jpeg declares; 16.16 fixed point
+	inline unsigned char luma(const unsigned char* p) {
+		return (unsigned char)((19595 * p[0] + 38470 * p[1] + 7471 * p[2] + 32768) >> 16);
+	}
+}
+
+std::vector<unsigned char> frame_recorder::encode_png(const unsigned char* rgba, int width, int height, bool bottom_up) {
+	const size_t stride = (size_t)width * 4;
+	//term: every row is filter byte 0 followed by the pixels, stored in deflate blocks of at most 65535 bytes
+	std::vector<unsigned char> raw;
+	raw.reserve((stride + 1) * height);
+	for (int y = 0; y < height; y++) {
+		const unsigned char* row = rgba + stride * (bottom_up ? height - 1 - y : y);
+		raw.push_back(0);
+		raw.insert(raw.end(), row, row + stride);
+	}
+
+	std::vector<unsigned char> z{ 0x78, 0x01 };
+	z.reserve(raw.size() + raw.size() / 65535 * 5 + 16);
+	size_t pos = 0;
+	do {
+		size_t n = std::min<size_t>(65535, raw.size() - pos);
+		z.push_back(pos + n == raw.size() ? 1 : 0);
+		z.push_back((unsigned char)n);
+		z.push_back((unsigned char)(n >> 8));
+		z.push_back((unsigned char)~n);
+		z.push_back((unsigned char)(~n >> 8));
+		z.insert(z.end(), raw.begin() + pos, raw.begin() + pos + n);
+		pos += n;
+	} while (pos < raw.size());
+	uint32_t a = 1, b = 0;
+	for (unsigned char c : raw) {
+		a = (a + c) % 65521;
+		b = (b + a) % 65521;
+	}
+	put_be32(z, (b << 16) | a);
+
+	std::vector<unsigned char> png{ 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+	std::vector<unsigned char> ihdr;
+	put_be32(ihdr, (uint32_t)width);
+	put_be32(ihdr, (uint32_t)height);
+	ihdr.insert(ihdr.end(), { 8, 6, 0, 0, 0 });
+	put_chunk(png, "IHDR", ihdr);
+	put_chunk(png, "IDAT", z);
+	put_chunk(png, "IEND", {});
+	return png;
+}
+
+frame_recorder::~frame_recorder() {
+	{
+		std::unique_lock<std::mutex> lock(mutex_);
+		stopping_ = true;
+	}
+	cv_.notify_all();
+	if (encoder_.joinable())
+		encoder_.join();
+}
+
+void frame_recorder::start(const std::string& path, output format, int fps, size_t ring_size) {
+	if (recording_)
+		throw std::runtime_error("frame_recorder: already recording");
+	if (ring_size < 2)
+		throw std::invalid_argument("frame_recorder: ring_size must be at least 2");
+	if (format != output::png) {
+		file_.open(path, std::ios::binary | std::ios::trunc);
+		if (!file_.is_open())
+			throw std::runtime_error("frame_recorder: can't write " + path);
+	}
+	if (ring_size != ring_size_) {
+		drain();
+		release_ring();
+		ring_size_ = ring_size;
+	}
+	path_ = path;
+	format_ = format;
+	fps_ = fps;
+	record_width_ = record_height_ = 0;
+	frame_ = 0;
+	recording_ = true;
+	if (!encoder_.joinable())
+		encoder_ = std::thread(&frame_recorder::encode_loop, this);
+}
+
+void frame_recorder::screenshot(const std::string& path) {
+	screenshot_path_ = path;
+	if (!encoder_.joinable())
+		encoder_ = std::thread(&frame_recorder::encode_loop, this);
+}
+
+void frame_recorder::capture(int width, int height) {
+	if (ring_.empty() && !recording_ && screenshot_path_.empty())
+		return;
+	DE2_TRACE_SCOPE("frame", "frame_recorder::capture");
+	auto begin = std::chrono::steady_clock::now();
+	service(false);
+
+	bool record = recording_;
+	if (record && record_width_ == 0) {
+		record_width_ = width;
+		record_height_ = height;
+	}
+	if (record && (width != record_width_ || height != record_height_)) {
+		dropped_++;
+		record = false;
+	}
+	if ((record || !screenshot_path_.empty()) && width > 0 && height > 0) {
+		slot* s = resize_ring(width, height) ? ring_[issued_ % ring_.size()].get() : nullptr;
+		if (!s || s->state.load(std::memory_order_acquire) != slot_state::free) {
+			//term: the gpu or the encoder is a whole ring behind; a pending screenshot waits for the next frame
+			if (record)
+				dropped_++;
+		}
+		else {
+			glBindBuffer(GL_PIXEL_PACK_BUFFER, s->pbo);
+			glPixelStorei(GL_PACK_ALIGNMENT, 1);
+			glReadBuffer(GL_BACK);
+			glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+			glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+			s->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+			s->width = width;
+			s->height = height;
+			s->record = record;
+			s->frame = record ? frame_++ : 0;
+			s->screenshot = std::move(screenshot_path_);
+			screenshot_path_.clear();
+			s->state.store(slot_state::reading, std::memory_order_release);
+			issued_++;
+			captured_++;
+		}
+	}
+	last_cost_ns_ = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - begin).count();
+}
+
+void frame_recorder::stop() {
+	recording_ = false;
+	drain();
+	release_ring();
+	if (file_.is_open())
+		file_.close();
+}
+
+bool frame_recorder::in_flight() const {
+	return mapped_ < issued_ || std::any_of(ring_.begin(), ring_.end(), [](auto& s) { return s->state.load() != slot_state::free; });
+}
+
+void frame_recorder::drain() {
+	while (in_flight()) {
+		service(true);
+		std::this_thread::yield();
+	}
+}
+
+frame_recorder::counts frame_recorder::stats() const {
+	counts c;
+	c.captured = captured_;
+	c.written = written_;
+	c.dropped = dropped_;
+	c.last_cost = std::chrono::nanoseconds(last_cost_ns_.load());
+	return c;
+}
+
+void frame_recorder::service(bool wait) {
+	for (auto& s : ring_) {
+		if (s->state.load(std::memory_order_acquire) != slot_state::encoded)
+			continue;
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, s->pbo);
+		glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+		s->pixels = nullptr;
+		s->state.store(slot_state::free, std::memory_order_release);
+	}
+	for (; mapped_ < issued_; mapped_++) {
+		slot& s = *ring_[mapped_ % ring_.size()];
+		GLenum r = glClientWaitSync(s.fence, wait ? GL_SYNC_FLUSH_COMMANDS_BIT : 0, wait ? 1000000000 : 0);
+		if (r == GL_TIMEOUT_EXPIRED)
+			break;
+		glDeleteSync(s.fence);
+		s.fence = nullptr;
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, s.pbo);
+		s.pixels = (const unsigned char*)glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, (GLsizeiptr)s.width * s.height * 4, GL_MAP_READ_BIT);
+		s.state.store(slot_state::encoding, std::memory_order_release);
+		{
+			std::unique_lock<std::mutex> lock(mutex_);
+			queue_.push_back(&s);
+		}
+		cv_.notify_one();
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+}
+
+//term: the ring is rebuilt for a new size only once nothing is in flight
+bool frame_recorder::resize_ring(int width, int height) {
+	if (!ring_.empty() && width == ring_width_ && height == ring_height_)
+		return true;
+	if (in_flight())
+		return false;
+	release_ring();
+	for (size_t i = 0; i < ring_size_; i++) {
+		auto s = std::make_unique<slot>();
+		glGenBuffers(1, &s->pbo);
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, s->pbo);
+		glBufferData(GL_PIXEL_PACK_BUFFER, (GLsizeiptr)width * height * 4, nullptr, GL_STREAM_READ);
+		ring_.push_back(std::move(s));
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	ring_width_ = width;
+	ring_height_ = height;
+	return true;
+}
+
+void frame_recorder::release_ring() {
+	for (auto& s : ring_) {
+		if (s->fence)
+			glDeleteSync(s->fence);
+		glDeleteBuffers(1, &s->pbo);
+	}
+	ring_.clear();
+	issued_ = mapped_ = 0;
+	ring_width_ = ring_height_ = 0;
+}
+
+void frame_recorder::encode_loop() {
+#ifdef DE2_TRACING
+	tracer::set_thread_name("frame_recorder");
+#endif
+	for (;;) {
+		slot* s = nullptr;
+		{
+			std::unique_lock<std::mutex> lock(mutex_);
+			cv_.wait(lock, [this]() { return stopping_ || !queue_.empty(); });
+			if (queue_.empty())
+				return;
+			s = queue_.front();
+			queue_.pop_front();
+		}
+		try {
+			write(*s);
+		}
+		catch (const std::exception& e) {
+			std::cerr << "frame_recorder: " << e.what() << std::endl;
+			dropped_++;
+		}
+		s->state.store(slot_state::encoded, std::memory_order_release);
+	}
+}
+
+void frame_recorder::write(slot& s) {
+	DE2_TRACE_SCOPE("io", "frame_recorder::write");
+	if (!s.pixels)
+		throw std::runtime_error("read-back buffer could not be mapped");
+	auto write_png = [&](const std::string& path) {
+		std::vector<unsigned char> png = encode_png(s.pixels, s.width, s.height, true);
+		std::ofstream f(path, std::ios::binary | std::ios::trunc);
+		if (!f.is_open())
+			throw std::runtime_error("can't write " + path);
+		f.write((const char*)png.data(), png.size());
+	};
+
+	if (!s.screenshot.empty())
+		write_png(s.screenshot);
+	if (!s.record)
+		return;
+
+	const size_t stride = (size_t)s.width * 4;
+	switch (format_) {
+	case output::png: {
+		char suffix[32];
+		snprintf(suffix, sizeof(suffix), "_%06llu.png", (unsigned long long)s.frame);
+		write_png(path_ + suffix);
+		break;
+	}
+	case output::raw:
+		for (int y = s.height - 1; y >= 0; y--)
+			file_.write((const char*)s.pixels + stride * y, stride);
+		break;
+	case output::y4m: {
+		if (s.frame == 0)
+			file_ << "YUV4MPEG2 W" << s.width << " H" << s.height << " F" << fps_ << ":1 Ip A1:1 C420jpeg\n";
+		const int cw = (s.width + 1) / 2, ch = (s.height + 1) / 2;
+		std::vector<unsigned char> yuv((size_t)s.width * s.height + (size_t)cw * ch * 2);
+		unsigned char* py = yuv.data();
+		unsigned char* pu = py + (size_t)s.width * s.height;
+		unsigned char* pv = pu + (size_t)cw * ch;
+		for (int y = 0; y < s.height; y++) {
+			const unsigned char* row = s.pixels + stride * (s.height - 1 - y);
+			for (int x = 0; x < s.width; x++)
+				*py++ = luma(row + x * 4);
+		}
+		//term: chroma from the 2x2 average, edge pixels repeat on odd sizes
+		for (int cy = 0; cy < ch; cy++) {
+			const unsigned char* r0 = s.pixels + stride * (s.height - 1 - cy * 2);
+			const unsigned char* r1 = s.pixels + stride * (s.height - 1 - std::min(cy * 2 + 1, s.height - 1));
+			for (int cx = 0; cx < cw; cx++) {
+				int x0 = cx * 2 * 4, x1 = std::min(cx * 2 + 1, s.width - 1) * 4;
+				int r = r0[x0] + r0[x1] + r1[x0] + r1[x1];
+				int g = r0[x0 + 1] + r0[x1 + 1] + r1[x0 + 1] + r1[x1 + 1];
+				int b = r0[x0 + 2] + r0[x1 + 2] + r1[x0 + 2] + r1[x1 + 2];
+				*pu++ = (unsigned char)std::clamp((-11059 * r - 21709 * g + 32768 * b + (128 << 18) + (1 << 17)) >> 18, 0, 255);
+				*pv++ = (unsigned char)std::clamp((32768 * r - 27439 * g - 5329 * b + (128 << 18) + (1 << 17)) >> 18, 0, 255);
+			}
+		}
+		file_ << "FRAME\n";
+		file_.write((const char*)yuv.data(), yuv.size());
+		break;
+	}
+	}
+	if (!file_.good() && format_ != output::png)
+		throw std::runtime_error("write to " + path_ + " failed");
+	written_++;
+}
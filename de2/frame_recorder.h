@@ -0,0 +1,84 @@
+#pragma once
+
+#include "glad/glad.h"
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <cstdint>
+#include <condition_variable>
+
+//term: read-backs go through a fenced pixel pack ring, frames are dropped rather than waited for when it falls a whole ring behind
+class frame_recorder {
+public:
+	enum class output { raw, png, y4m };
+	struct counts {
+		uint64_t captured{ 0 }, written{ 0 }, dropped{ 0 };
+		std::chrono::nanoseconds last_cost{ 0 };
+	};
+
+	frame_recorder() = default;
+	virtual ~frame_recorder();
+	frame_recorder(const frame_recorder& other) = delete;
+	frame_recorder& operator=(const frame_recorder& other) = delete;
+
+	//term: frames of another size than the first are dropped
+	void start(const std::string& path, output format, int fps = 60, size_t ring_size = 4);
+	void screenshot(const std::string& path);
+	//term: render thread, with the frame still in the back buffer
+	void capture(int width, int height);
+	//term: needs the context
+	void stop();
+
+	bool recording() const { return recording_; }
+	counts stats() const;
+
+	//term: stored deflate blocks, no compression dependency
+	static std::vector<unsigned char> encode_png(const unsigned char* rgba, int width, int height, bool bottom_up);
+protected:
+	enum class slot_state { free, reading, encoding, encoded };
+	struct slot {
+		GLuint pbo{ 0 };
+		GLsync fence{ nullptr };
+		std::atomic<slot_state> state{ slot_state::free };
+		const unsigned char* pixels{ nullptr };
+		int width{ 0 }, height{ 0 };
+		uint64_t frame{ 0 };
+		bool record{ false };
+		std::string screenshot;
+	};
+
+	void service(bool wait);
+	bool in_flight() const;
+	void drain();
+	bool resize_ring(int width, int height);
+	void release_ring();
+	void encode_loop();
+	void write(slot& s);
+
+	std::vector<std::unique_ptr<slot>> ring_;
+	size_t ring_size_{ 4 };
+	uint64_t issued_{ 0 }, mapped_{ 0 };
+	int ring_width_{ 0 }, ring_height_{ 0 };
+
+	bool recording_{ false };
+	output format_{ output::raw };
+	std::string path_, screenshot_path_;
+	int fps_{ 60 }, record_width_{ 0 }, record_height_{ 0 };
+	uint64_t frame_{ 0 };
+	std::ofstream file_;
+
+	std::thread encoder_;
+	std::mutex mutex_;
+	std::condition_variable cv_;
+	std::deque<slot*> queue_;
+	bool stopping_{ false };
+
+	std::atomic<uint64_t> captured_{ 0 }, written_{ 0 }, dropped_{ 0 };
+	std::atomic<int64_t> last_cost_ns_{ 0 };
+};
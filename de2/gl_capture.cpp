@@ -0,0 +1,700 @@
+#include "pch.h"
+#include "gl_capture.h"
+#include "shader.h"
+#include <set>
+#include <map>
+#include <iomanip>
+
+namespace {
+	//term: "DE2C" read as a little endian u32
+	constexpr uint32_t capture_magic = 0x43324544;
+	constexpr uint32_t capture_version = 1;
+
+	//term: unsigned operands go to command a, b, c in order, then the location, the floats and the offset
+	struct op_layout {
+		const char* name;
+		uint8_t uints;
+		bool location;
+		uint8_t floats;
+		bool offset;
+	};
+	const op_layout& layout(gl_capture::op o) {
+		static const op_layout layouts[] = {
+			{ "invalid", 0, false, 0, false },
+			{ "clear", 1, false, 4, false },
+			{ "use_program", 1, false, 0, false },
+			{ "uniform_1i", 2, true, 0, false },
+			{ "uniform_1f", 1, true, 1, false },
+			{ "uniform_3f", 1, true, 3, false },
+			{ "uniform_mat4", 1, true, 16, false },
+			{ "bind_vao", 1, false, 0, false },
+			{ "bind_texture", 2, false, 0, false },
+			{ "draw_elements", 3, false, 0, true },
+			{ "draw_arrays", 3, false, 0, false },
+		};
+		if ((size_t)o == 0 || (size_t)o >= std::size(layouts))
+			throw std::runtime_error("gl_capture: unknown op " + std::to_string((int)o));
+		return layouts[(size_t)o];
+	}
+
+	template<typename T>
+	void put(std::vector<unsigned char>& out, const T& v) {
+		const unsigned char* p = (const unsigned char*)&v;
+		out.insert(out.end(), p, p + sizeof(T));
+	}
+	void put_bytes(std::vector<unsigned char>& out, const void* data, size_t size) {
+		const unsigned char* p = (const unsigned char*)data;
+		out.insert(out.end(), p, p + size);
+	}
+
+	class reader {
+		std::span<const unsigned char> data_;
+		size_t pos_{ 0 };
+	public:
+		reader(std::span<const unsigned char> data) : data_(data) {}
+		std::span<const unsigned char> bytes(size_t size) {
+			if (size > data_.size() - pos_)
+				throw std::runtime_error("gl_capture: truncated stream");
+			auto s = data_.subspan(pos_, size);
+			pos_ += size;
+			return s;
+		}
+		template<typename T>
+		T get() {
+			T v;
+			memcpy(&v, bytes(sizeof(T)).data(), sizeof(T));
+			return v;
+		}
+		bool done() const { return pos_ >= data_.size(); }
+	};
+
+	void write_command(std::vector<unsigned char>& out, const gl_replay::command& c) {
+		const op_layout& l = layout(c.op);
+		const GLuint uints[] = { c.a, c.b, c.c };
+		put(out, c.op);
+		for (uint8_t i = 0; i < l.uints; i++)
+			put(out, uints[i]);
+		if (l.location)
+			put(out, c.location);
+		put_bytes(out, c.values, l.floats * sizeof(float));
+		if (l.offset)
+			put(out, c.offset);
+	}
+	gl_replay::command read_command(reader& r) {
+		gl_replay::command c;
+		c.op = r.get<gl_capture::op>();
+		const op_layout& l = layout(c.op);
+		GLuint* uints[] = { &c.a, &c.b, &c.c };
+		for (uint8_t i = 0; i < l.uints; i++)
+			*uints[i] = r.get<GLuint>();
+		if (l.location)
+			c.location = r.get<GLint>();
+		for (uint8_t i = 0; i < l.floats; i++)
+			c.values[i] = r.get<float>();
+		if (l.offset)
+			c.offset = r.get<uint64_t>();
+		return c;
+	}
+
+	struct vertex_attrib {
+		GLuint index, buffer;
+		GLint size;
+		GLenum type;
+		GLint normalized, integer;
+		GLsizei stride;
+		uint64_t offset;
+	};
+	struct vao_snapshot {
+		GLuint id, element_buffer;
+		std::vector<vertex_attrib> attribs;
+	};
+	struct program_snapshot {
+		GLuint id;
+		GLenum format;
+		std::span<const unsigned char> binary;
+	};
+	struct buffer_snapshot {
+		GLuint id;
+		std::span<const unsigned char> data;
+	};
+	struct texture_snapshot {
+		GLuint id;
+		GLint width, height;
+		std::span<const unsigned char> rgba;
+	};
+	struct parsed_capture {
+		std::vector<program_snapshot> programs;
+		std::vector<buffer_snapshot> buffers;
+		std::vector<vao_snapshot> vaos;
+		std::vector<texture_snapshot> textures;
+		std::vector<gl_replay::command> commands;
+	};
+
+	parsed_capture parse(std::span<const unsigned char> stream) {
+		reader r(stream);
+		if (r.get<uint32_t>() != capture_magic)
+			throw std::runtime_error("gl_capture: not a capture stream");
+		if (r.get<uint32_t>() != capture_version)
+			throw std::runtime_error("gl_capture: unsupported capture version");
+
+		parsed_capture p;
+		for (uint32_t n = r.get<uint32_t>(); n > 0; n--) {
+			program_snapshot s;
+			s.id = r.get<GLuint>();
+			s.format = r.get<GLenum>();
+			s.binary = r.bytes(r.get<uint32_t>());
+			p.programs.push_back(s);
+		}
+		for (uint32_t n = r.get<uint32_t>(); n > 0; n--) {
+			buffer_snapshot s;
+			s.id = r.get<GLuint>();
+			s.data = r.bytes(r.get<uint32_t>());
+			p.buffers.push_back(s);
+		}
+		for (uint32_t n = r.get<uint32_t>(); n > 0; n--) {
+			vao_snapshot s;
+			s.id = r.get<GLuint>();
+			s.element_buffer = r.get<GLuint>();
+			for (uint32_t i = r.get<uint32_t>(); i > 0; i--) {
+				vertex_attrib a;
+				a.index = r.get<GLuint>();
+				a.buffer = r.get<GLuint>();
+				a.size = r.get<GLint>();
+				a.type = r.get<GLenum>();
+				a.normalized = r.get<GLint>();
+				a.integer = r.get<GLint>();
+				a.stride = r.get<GLsizei>();
+				a.offset = r.get<uint64_t>();
+				s.attribs.push_back(a);
+			}
+			p.vaos.push_back(s);
+		}
+		for (uint32_t n = r.get<uint32_t>(); n > 0; n--) {
+			texture_snapshot s;
+			s.id = r.get<GLuint>();
+			s.width = r.get<GLint>();
+			s.height = r.get<GLint>();
+			if (s.width < 0 || s.height < 0)
+				throw std::runtime_error("gl_capture: bad texture size");
+			s.rgba = r.bytes((size_t)s.width * s.height * 4);
+			p.textures.push_back(s);
+		}
+		reader commands(r.bytes(r.get<uint32_t>()));
+		while (!commands.done())
+			p.commands.push_back(read_command(commands));
+		return p;
+	}
+
+	std::vector<unsigned char>& command_stream() {
+		static std::vector<unsigned char> s;
+		return s;
+	}
+	void record(const gl_replay::command& c) {
+		write_command(command_stream(), c);
+	}
+}
+
+std::atomic<bool> gl_capture::recording_{ false };
+
+void gl_capture::begin() {
+	command_stream().clear();
+	recording_.store(true, std::memory_order_relaxed);
+}
+
+std::vector<unsigned char> gl_capture::end() {
+	recording_.store(false, std::memory_order_relaxed);
+	std::vector<unsigned char>& commands = command_stream();
+
+	std::set<GLuint> programs, buffers, vaos, textures;
+	reader r(commands);
+	while (!r.done()) {
+		gl_replay::command c = read_command(r);
+		switch (c.op) {
+		case op::use_program:
+		case op::uniform_1i:
+		case op::uniform_1f:
+		case op::uniform_3f:
+		case op::uniform_mat4:
+			if (c.a)
+				programs.insert(c.a);
+			break;
+		case op::bind_vao:
+			if (c.a)
+				vaos.insert(c.a);
+			break;
+		case op::bind_texture:
+			if (c.b)
+				textures.insert(c.b);
+			break;
+		default:
+			break;
+		}
+	}
+
+	std::vector<unsigned char> out;
+	put(out, capture_magic);
+	put(out, capture_version);
+
+	if (!programs.empty() && !GLAD_GL_VERSION_4_1 && !GLAD_GL_ARB_get_program_binary)
+		throw std::runtime_error("gl_capture: program snapshots need gl 4.1 or ARB_get_program_binary");
+	put(out, (uint32_t)programs.size());
+	for (GLuint id : programs) {
+		GLint length = 0;
+		glGetProgramiv(id, GL_PROGRAM_BINARY_LENGTH, &length);
+		std::vector<unsigned char> binary(std::max(length, 0));
+		GLsizei written = 0;
+		GLenum format = 0;
+		if (length > 0)
+			glGetProgramBinary(id, length, &written, &format, binary.data());
+		if (written <= 0)
+			throw std::runtime_error("gl_capture: program " + std::to_string(id) + " has no retrievable binary");
+		put(out, id);
+		put(out, format);
+		put(out, (uint32_t)written);
+		put_bytes(out, binary.data(), written);
+	}
+
+	//term: vertex arrays are read first, the buffers they point at are snapshotted with them
+	std::vector<vao_snapshot> vao_snapshots;
+	GLint max_attribs = 0;
+	glGetIntegerv(GL_MAX_VERTEX_ATTRIBS, &max_attribs);
+	for (GLuint id : vaos) {
+		glBindVertexArray(id);
+		vao_snapshot v;
+		v.id = id;
+		GLint value = 0;
+		glGetIntegerv(GL_ELEMENT_ARRAY_BUFFER_BINDING, &value);
+		v.element_buffer = value;
+		if (v.element_buffer)
+			buffers.insert(v.element_buffer);
+		for (GLint i = 0; i < max_attribs; i++) {
+			glGetVertexAttribiv(i, GL_VERTEX_ATTRIB_ARRAY_ENABLED, &value);
+			if (!value)
+				continue;
+			vertex_attrib a;
+			a.index = (GLuint)i;
+			glGetVertexAttribiv(i, GL_VERTEX_ATTRIB_ARRAY_BUFFER_BINDING, &value);
+			a.buffer = value;
+			glGetVertexAttribiv(i, GL_VERTEX_ATTRIB_ARRAY_SIZE, &a.size);
+			glGetVertexAttribiv(i, GL_VERTEX_ATTRIB_ARRAY_TYPE, &value);
+			a.type = value;
+			glGetVertexAttribiv(i, GL_VERTEX_ATTRIB_ARRAY_NORMALIZED, &a.normalized);
+			glGetVertexAttribiv(i, GL_VERTEX_ATTRIB_ARRAY_INTEGER, &a.integer);
+			glGetVertexAttribiv(i, GL_VERTEX_ATTRIB_ARRAY_STRIDE, &a.stride);
+			void* pointer = nullptr;
+			glGetVertexAttribPointerv(i, GL_VERTEX_ATTRIB_ARRAY_POINTER, &pointer);
+			a.offset = (uint64_t)(uintptr_t)pointer;
+			if (a.buffer)
+				buffers.insert(a.buffer);
+			v.attribs.push_back(a);
+		}
+		vao_snapshots.push_back(v);
+	}
+	glBindVertexArray(0);
+
+	put(out, (uint32_t)buffers.size());
+	std::vector<unsigned char> data;
+	for (GLuint id : buffers) {
+		GLint size = 0;
+		glBindBuffer(GL_COPY_READ_BUFFER, id);
+		glGetBufferParameteriv(GL_COPY_READ_BUFFER, GL_BUFFER_SIZE, &size);
+		data.resize(std::max(size, 0));
+		if (size > 0)
+			glGetBufferSubData(GL_COPY_READ_BUFFER, 0, size, data.data());
+		put(out, id);
+		put(out, (uint32_t)data.size());
+		put_bytes(out, data.data(), data.size());
+	}
+	glBindBuffer(GL_COPY_READ_BUFFER, 0);
+
+	put(out, (uint32_t)vao_snapshots.size());
+	for (auto& v : vao_snapshots) {
+		put(out, v.id);
+		put(out, v.element_buffer);
+		put(out, (uint32_t)v.attribs.size());
+		for (auto& a : v.attribs) {
+			put(out, a.index);
+			put(out, a.buffer);
+			put(out, a.size);
+			put(out, a.type);
+			put(out, a.normalized);
+			put(out, a.integer);
+			put(out, a.stride);
+			put(out, a.offset);
+		}
+	}
+
+	//term: level 0 as rgba8, replay rebuilds the mip chain
+	put(out, (uint32_t)textures.size());
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	for (GLuint id : textures) {
+		GLint width = 0, height = 0;
+		glBindTexture(GL_TEXTURE_2D, id);
+		glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_WIDTH, &width);
+		glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_HEIGHT, &height);
+		data.resize((size_t)width * height * 4);
+		if (!data.empty())
+			glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_UNSIGNED_BYTE, data.data());
+		put(out, id);
+		put(out, width);
+		put(out, height);
+		put_bytes(out, data.data(), data.size());
+	}
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	put(out, (uint32_t)commands.size());
+	put_bytes(out, commands.data(), commands.size());
+	commands.clear();
+	return out;
+}
+
+void gl_capture::clear(GLuint mask, const glm::vec4& color) {
+	gl_replay::command c;
+	c.op = op::clear;
+	c.a = mask;
+	memcpy(c.values, &color[0], sizeof(float) * 4);
+	record(c);
+}
+void gl_capture::use_program(GLuint program) {
+	gl_replay::command c;
+	c.op = op::use_program;
+	c.a = program;
+	record(c);
+}
+void gl_capture::uniform(GLuint program, GLint location, GLint v) {
+	gl_replay::command c;
+	c.op = op::uniform_1i;
+	c.a = program;
+	c.b = (GLuint)v;
+	c.location = location;
+	record(c);
+}
+void gl_capture::uniform(GLuint program, GLint location, GLfloat v) {
+	gl_replay::command c;
+	c.op = op::uniform_1f;
+	c.a = program;
+	c.location = location;
+	c.values[0] = v;
+	record(c);
+}
+void gl_capture::uniform(GLuint program, GLint location, const glm::vec3& v) {
+	gl_replay::command c;
+	c.op = op::uniform_3f;
+	c.a = program;
+	c.location = location;
+	memcpy(c.values, &v[0], sizeof(float) * 3);
+	record(c);
+}
+void gl_capture::uniform(GLuint program, GLint location, const glm::mat4& v) {
+	gl_replay::command c;
+	c.op = op::uniform_mat4;
+	c.a = program;
+	c.location = location;
+	memcpy(c.values, &v[0][0], sizeof(float) * 16);
+	record(c);
+}
+void gl_capture::bind_vao(GLuint vao) {
+	gl_replay::command c;
+	c.op = op::bind_vao;
+	c.a = vao;
+	record(c);
+}
+void gl_capture::bind_texture(GLuint unit, GLuint texture) {
+	gl_replay::command c;
+	c.op = op::bind_texture;
+	c.a = unit;
+	c.b = texture;
+	record(c);
+}
+void gl_capture::draw_elements(GLenum mode, GLsizei count, GLenum type, uint64_t offset) {
+	gl_replay::command c;
+	c.op = op::draw_elements;
+	c.a = mode;
+	c.b = (GLuint)count;
+	c.c = type;
+	c.offset = offset;
+	record(c);
+}
+void gl_capture::draw_arrays(GLenum mode, GLint first, GLsizei count) {
+	gl_replay::command c;
+	c.op = op::draw_arrays;
+	c.a = mode;
+	c.b = (GLuint)first;
+	c.c = (GLuint)count;
+	record(c);
+}
+
+void gl_capture::save(const std::string& path, const std::vector<unsigned char>& stream) {
+	std::ofstream f(path, std::ios::binary | std::ios::trunc);
+	if (!f.is_open())
+		throw std::runtime_error("gl_capture: can't write " + path);
+	f.write((const char*)stream.data(), stream.size());
+}
+
+std::vector<unsigned char> gl_capture::load(const std::string& path) {
+	std::ifstream f(path, std::ios::binary);
+	if (!f.is_open())
+		throw std::runtime_error("gl_capture: can't read " + path);
+	return std::vector<unsigned char>((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+}
+
+std::string gl_capture::to_text(std::span<const unsigned char> stream) {
+	parsed_capture p = parse(stream);
+	size_t buffer_bytes = 0;
+	for (auto& b : p.buffers)
+		buffer_bytes += b.data.size();
+
+	std::ostringstream o;
+	o << "# programs " << p.programs.size() << " buffers " << p.buffers.size() << " (" << buffer_bytes << " bytes) vaos " << p.vaos.size()
+		<< " textures " << p.textures.size() << "\n";
+
+	//term: a bind of what is already bound, or a uniform upload of the value the location already holds
+	GLuint program = 0, vao = 0;
+	std::map<GLuint, GLuint> texture_units;
+	std::map<std::pair<GLuint, GLint>, std::vector<float>> uniforms;
+	size_t redundant = 0, draws = 0;
+	for (auto& c : p.commands) {
+		const op_layout& l = layout(c.op);
+		bool same = false;
+		switch (c.op) {
+		case op::use_program:
+			same = program == c.a;
+			program = c.a;
+			break;
+		case op::bind_vao:
+			same = vao == c.a;
+			vao = c.a;
+			break;
+		case op::bind_texture: {
+			auto it = texture_units.find(c.a);
+			same = it != texture_units.end() && it->second == c.b;
+			texture_units[c.a] = c.b;
+			break;
+		}
+		case op::uniform_1i:
+		case op::uniform_1f:
+		case op::uniform_3f:
+		case op::uniform_mat4: {
+			std::vector<float> value(c.values, c.values + l.floats);
+			if (c.op == op::uniform_1i)
+				value.push_back((float)(GLint)c.b);
+			auto& previous = uniforms[{ c.a, c.location }];
+			same = previous == value;
+			previous = std::move(value);
+			break;
+		}
+		case op::draw_elements:
+		case op::draw_arrays:
+			draws++;
+			break;
+		default:
+			break;
+		}
+
+		o << l.name;
+		const GLuint uints[] = { c.a, c.b, c.c };
+		for (uint8_t i = 0; i < l.uints; i++)
+			o << " " << uints[i];
+		if (l.location)
+			o << " @" << c.location;
+		for (uint8_t i = 0; i < l.floats; i++)
+			o << " " << c.values[i];
+		if (l.offset)
+			o << " +" << c.offset;
+		if (same) {
+			o << "  # redundant";
+			redundant++;
+		}
+		o << "\n";
+	}
+	o << "# commands " << p.commands.size() << " draws " << draws << " redundant " << redundant << "\n";
+	return o.str();
+}
+
+gl_replay::gl_replay(std::span<const unsigned char> stream) {
+	parsed_capture p = parse(stream);
+	std::unordered_map<GLuint, GLuint> program_ids, buffer_ids, vao_ids, texture_ids;
+	auto remap = [](const std::unordered_map<GLuint, GLuint>& ids, GLuint id, const char* what) -> GLuint {
+		if (!id)
+			return 0;
+		auto it = ids.find(id);
+		if (it == ids.end())
+			throw std::runtime_error(std::string("gl_replay: ") + what + " " + std::to_string(id) + " has no snapshot");
+		return it->second;
+	};
+
+	if (!p.programs.empty() && !GLAD_GL_VERSION_4_1 && !GLAD_GL_ARB_get_program_binary)
+		throw std::runtime_error("gl_replay: program binaries need gl 4.1 or ARB_get_program_binary");
+	try {
+		for (auto& s : p.programs) {
+			GLuint id = glCreateProgram();
+			programs_.push_back(id);
+			glProgramBinary(id, s.format, s.binary.data(), (GLsizei)s.binary.size());
+			GLint linked = 0;
+			glGetProgramiv(id, GL_LINK_STATUS, &linked);
+			if (linked != GL_TRUE)
+				throw std::runtime_error("gl_replay: program binary rejected, captures replay on the driver that recorded them");
+			program_ids[s.id] = id;
+		}
+		for (auto& s : p.buffers) {
+			GLuint id = 0;
+			glGenBuffers(1, &id);
+			buffers_.push_back(id);
+			glBindBuffer(GL_ARRAY_BUFFER, id);
+			glBufferData(GL_ARRAY_BUFFER, s.data.size(), s.data.data(), GL_STATIC_DRAW);
+			buffer_ids[s.id] = id;
+		}
+		for (auto& s : p.vaos) {
+			GLuint id = 0;
+			glGenVertexArrays(1, &id);
+			vaos_.push_back(id);
+			glBindVertexArray(id);
+			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, remap(buffer_ids, s.element_buffer, "buffer"));
+			for (auto& a : s.attribs) {
+				glBindBuffer(GL_ARRAY_BUFFER, remap(buffer_ids, a.buffer, "buffer"));
+				if (a.integer)
+					glVertexAttribIPointer(a.index, a.size, a.type, a.stride, (const void*)(uintptr_t)a.offset);
+				else
+					glVertexAttribPointer(a.index, a.size, a.type, a.normalized ? GL_TRUE : GL_FALSE, a.stride, (const void*)(uintptr_t)a.offset);
+				glEnableVertexAttribArray(a.index);
+			}
+			vao_ids[s.id] = id;
+		}
+		glBindVertexArray(0);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+		for (auto& s : p.textures) {
+			GLuint id = 0;
+			glGenTextures(1, &id);
+			textures_.push_back(id);
+			glBindTexture(GL_TEXTURE_2D, id);
+			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, s.width, s.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, s.rgba.data());
+			glGenerateMipmap(GL_TEXTURE_2D);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+			texture_ids[s.id] = id;
+		}
+		glBindTexture(GL_TEXTURE_2D, 0);
+
+		commands_.reserve(p.commands.size());
+		for (auto c : p.commands) {
+			switch (c.op) {
+			case gl_capture::op::use_program:
+			case gl_capture::op::uniform_1i:
+			case gl_capture::op::uniform_1f:
+			case gl_capture::op::uniform_3f:
+			case gl_capture::op::uniform_mat4:
+				c.a = remap(program_ids, c.a, "program");
+				break;
+			case gl_capture::op::bind_vao:
+				c.a = remap(vao_ids, c.a, "vertex array");
+				break;
+			case gl_capture::op::bind_texture:
+				c.b = remap(texture_ids, c.b, "texture");
+				break;
+			default:
+				break;
+			}
+			commands_.push_back(c);
+		}
+	}
+	catch (...) {
+		release();
+		throw;
+	}
+}
+
+gl_replay::~gl_replay() {
+	release();
+}
+
+void gl_replay::release() {
+	for (GLuint id : programs_)
+		glDeleteProgram(id);
+	if (!vaos_.empty())
+		glDeleteVertexArrays((GLsizei)vaos_.size(), vaos_.data());
+	if (!buffers_.empty())
+		glDeleteBuffers((GLsizei)buffers_.size(), buffers_.data());
+	if (!textures_.empty())
+		glDeleteTextures((GLsizei)textures_.size(), textures_.data());
+	programs_.clear();
+	vaos_.clear();
+	buffers_.clear();
+	textures_.clear();
+}
+
+//term: without glProgramUniform the uniform's program is bound for glUniform, then the captured binding is restored
+void gl_replay::run() {
+	const bool direct = program::direct_uniforms();
+	GLuint bound = 0;
+	auto bind_for_uniform = [&](GLuint id) {
+		if (id != bound)
+			glUseProgram(id);
+	};
+	auto restore = [&](GLuint id) {
+		if (id != bound)
+			glUseProgram(bound);
+	};
+	for (auto& c : commands_) {
+		switch (c.op) {
+		case gl_capture::op::clear:
+			glClearColor(c.values[0], c.values[1], c.values[2], c.values[3]);
+			glClear(c.a);
+			break;
+		case gl_capture::op::use_program:
+			glUseProgram(c.a);
+			bound = c.a;
+			break;
+		case gl_capture::op::uniform_1i:
+			if (direct) {
+				glProgramUniform1i(c.a, c.location, (GLint)c.b);
+				break;
+			}
+			bind_for_uniform(c.a);
+			glUniform1i(c.location, (GLint)c.b);
+			restore(c.a);
+			break;
+		case gl_capture::op::uniform_1f:
+			if (direct) {
+				glProgramUniform1f(c.a, c.location, c.values[0]);
+				break;
+			}
+			bind_for_uniform(c.a);
+			glUniform1f(c.location, c.values[0]);
+			restore(c.a);
+			break;
+		case gl_capture::op::uniform_3f:
+			if (direct) {
+				glProgramUniform3fv(c.a, c.location, 1, c.values);
+				break;
+			}
+			bind_for_uniform(c.a);
+			glUniform3fv(c.location, 1, c.values);
+			restore(c.a);
+			break;
+		case gl_capture::op::uniform_mat4:
+			if (direct) {
+				glProgramUniformMatrix4fv(c.a, c.location, 1, GL_FALSE, c.values);
+				break;
+			}
+			bind_for_uniform(c.a);
+			glUniformMatrix4fv(c.location, 1, GL_FALSE, c.values);
+			restore(c.a);
+			break;
+		case gl_capture::op::bind_vao:
+			glBindVertexArray(c.a);
+			break;
+		case gl_capture::op::bind_texture:
+			glActiveTexture(GL_TEXTURE0 + c.a);
+			glBindTexture(GL_TEXTURE_2D, c.b);
+			break;
+		case gl_capture::op::draw_elements:
+			glDrawElements(c.a, (GLsizei)c.b, c.c, (const void*)(uintptr_t)c.offset);
+			break;
+		case gl_capture::op::draw_arrays:
+			glDrawArrays(c.a, (GLint)c.b, (GLsizei)c.c);
+			break;
+		}
+	}
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include "glad/glad.h"
+#include "glm/glm.hpp"
+#include <span>
+#include <atomic>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+//term: render thread only; end() snapshots every resource the calls referenced, so a capture replays without the engine
+class gl_capture {
+public:
+	enum class op : uint8_t {
+		clear = 1,
+		use_program,
+		uniform_1i,
+		uniform_1f,
+		uniform_3f,
+		uniform_mat4,
+		bind_vao,
+		bind_texture,
+		draw_elements,
+		draw_arrays
+	};
+
+	static bool recording() { return recording_.load(std::memory_order_relaxed); }
+	static void begin();
+	//term: needs the context the calls were made on
+	static std::vector<unsigned char> end();
+
+	static void clear(GLuint mask, const glm::vec4& color);
+	static void use_program(GLuint program);
+	static void uniform(GLuint program, GLint location, GLint v);
+	static void uniform(GLuint program, GLint location, GLfloat v);
+	static void uniform(GLuint program, GLint location, const glm::vec3& v);
+	static void uniform(GLuint program, GLint location, const glm::mat4& v);
+	static void bind_vao(GLuint vao);
+	static void bind_texture(GLuint unit, GLuint texture);
+	static void draw_elements(GLenum mode, GLsizei count, GLenum type, uint64_t offset);
+	static void draw_arrays(GLenum mode, GLint first, GLsizei count);
+
+	static void save(const std::string& path, const std::vector<unsigned char>& stream);
+	static std::vector<unsigned char> load(const std::string& path);
+	static std::string to_text(std::span<const unsigned char> stream);
+protected:
+	static std::atomic<bool> recording_;
+};
+
+class gl_replay {
+public:
+	struct command {
+		gl_capture::op op{};
+		GLuint a{ 0 }, b{ 0 }, c{ 0 };
+		GLint location{ -1 };
+		uint64_t offset{ 0 };
+		float values[16]{};
+	};
+
+	gl_replay(std::span<const unsigned char> stream);
+	virtual ~gl_replay();
+	gl_replay(const gl_replay& other) = delete;
+	gl_replay& operator=(const gl_replay& other) = delete;
+
+	void run();
+	size_t commands() const { return commands_.size(); }
+protected:
+	void release();
+
+	std::vector<command> commands_;
+	std::vector<GLuint> programs_, buffers_, vaos_, textures_;
+};
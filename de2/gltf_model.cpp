@@ -0,0 +1,346 @@
+#include "pch.h"
+#include "gltf_model.h"
+#include "json.h"
+#include "de2.h"
+#include <cstring>
+#include <cfloat>
+#include <future>
+
+namespace {
+	const uint32_t glb_magic = 0x46546C67;		//"glTF"
+	const uint32_t glb_chunk_json = 0x4E4F534A;	//"JSON"
+	const uint32_t glb_chunk_bin = 0x004E4942;	//"BIN\0"
+
+	uint32_t read_u32(const unsigned char* p) {
+		uint32_t v;
+		memcpy(&v, p, sizeof(v));
+		return v;
+	}
+	GLint component_count(const std::string& type) {
+		if (type == "SCALAR") return 1;
+		if (type == "VEC2") return 2;
+		if (type == "VEC3") return 3;
+		if (type == "VEC4") return 4;
+		throw std::runtime_error("gltf: unsupported accessor type " + type);
+	}
+	size_t component_size(GLenum type) {
+		switch (type) {
+		case GL_BYTE: case GL_UNSIGNED_BYTE: return 1;
+		case GL_SHORT: case GL_UNSIGNED_SHORT: return 2;
+		case GL_UNSIGNED_INT: case GL_FLOAT: return 4;
+		}
+		throw std::runtime_error("gltf: unsupported component type " + std::to_string(type));
+	}
+	template<typename T>
+	uint32_t max_index(const unsigned char* p, size_t count) {
+		T m = 0;
+		for (size_t i = 0; i < count; i++) {
+			T v;
+			memcpy(&v, p + i * sizeof(T), sizeof(T));
+			m = std::max(m, v);
+		}
+		return m;
+	}
+	glm::mat4 node_matrix(const json_value& node) {
+		if (node.has("matrix")) {
+			const json_value& m = node["matrix"];
+			glm::mat4 r;
+			for (int i = 0; i < 16; i++)
+				r[i / 4][i % 4] = (float)m[i].as_number(i % 5 == 0 ? 1 : 0);
+			return r;
+		}
+		const json_value& t = node["translation"];
+		const json_value& r = node["rotation"];
+		const json_value& s = node["scale"];
+		glm::vec3 translation{ t[0].as_number(), t[1].as_number(), t[2].as_number() };
+		glm::quat rotation{ (float)r[3].as_number(1), (float)r[0].as_number(), (float)r[1].as_number(), (float)r[2].as_number() };
+		glm::vec3 scale{ s[0].as_number(1), s[1].as_number(1), s[2].as_number(1) };
+		return glm::translate(glm::mat4(1.0f), translation) * glm::toMat4(rotation) * glm::scale(glm::mat4(1.0f), scale);
+	}
+}
+
+gltf_model::gltf_model(std::string path) : path_(path) {
+	std::span<const unsigned char> glb;
+	if (auto blob = de2::get_instance().read_asset(path)) {
+		source_ = *blob;
+		glb = source_.data;
+	}
+	else {
+		file_ = std::make_unique<mapped_file>(path);
+		glb = file_->span(0, file_->size());
+	}
+	if (glb.size() < 20 || read_u32(glb.data()) != glb_magic || read_u32(glb.data() + 4) != 2)
+		throw std::runtime_error("gltf: not a glb 2.0 file: " + path);
+
+	size_t length = std::min<size_t>(read_u32(glb.data() + 8), glb.size());
+	size_t json_length = read_u32(glb.data() + 12);
+	if (read_u32(glb.data() + 16) != glb_chunk_json || json_length > length - 20)
+		throw std::runtime_error("gltf: first chunk is not json: " + path);
+
+	auto json_chunk = glb.subspan(20, json_length);
+	size_t next = 20 + ((json_length + 3) & ~size_t(3));
+	if (next + 8 <= length && read_u32(glb.data() + next + 4) == glb_chunk_bin) {
+		size_t bin_length = read_u32(glb.data() + next);
+		if (bin_length > length - next - 8)
+			throw std::runtime_error("gltf: BIN chunk outside of file: " + path);
+		bin_ = glb.subspan(next + 8, bin_length);
+	}
+
+	json_value doc = json_value::parse(std::string_view((const char*)json_chunk.data(), json_chunk.size()));
+
+	//term: only the embedded BIN chunk is supported as buffer storage
+	for (auto& b : doc["buffers"].items()) {
+		if (b.has("uri"))
+			throw std::runtime_error("gltf: external buffers are not supported: " + path);
+	}
+	for (auto& v : doc["bufferViews"].items()) {
+		buffer_view bv;
+		bv.offset = v["byteOffset"].as_size();
+		bv.length = v["byteLength"].as_size();
+		if (bv.offset > bin_.size() || bv.length > bin_.size() - bv.offset)
+			throw std::runtime_error("gltf: buffer view outside of BIN chunk: " + path);
+		views_.push_back(bv);
+	}
+
+	//term: images decode on the pool while the node hierarchy is walked
+	load_images(doc);
+
+	if (doc["scenes"].size() > 0) {
+		const json_value& scene = doc["scenes"][doc["scene"].as_size()];
+		for (auto& n : scene["nodes"].items())
+			load_node(doc, n.as_size(), glm::mat4(1.0f));
+	}
+	else {
+		for (size_t i = 0; i < doc["meshes"].size(); i++)
+			load_mesh(doc, i, glm::mat4(1.0f));
+	}
+}
+gltf_model::~gltf_model() {
+	std::vector<GLuint> vaos, vbos;
+	for (auto& p : primitives) {
+		if (p.vao)
+			vaos.push_back(p.vao);
+	}
+	for (auto& v : views_) {
+		if (v.vbo)
+			vbos.push_back(v.vbo);
+	}
+	if (vaos.empty() && vbos.empty())
+		return;
+	de2::get_instance().release_gl([vaos, vbos]() {
+		glDeleteVertexArrays((GLsizei)vaos.size(), vaos.data());
+		glDeleteBuffers((GLsizei)vbos.size(), vbos.data());
+	});
+}
+size_t gltf_model::cpu_bytes() const {
+	size_t n = 0;
+	for (auto& img : images)
+		n += img->cpu_bytes();
+	return n;
+}
+size_t gltf_model::gpu_bytes() const {
+	size_t n = 0;
+	for (auto& v : views_)
+		n += v.vbo ? v.length : 0;
+	for (auto& img : images)
+		n += img->gpu_bytes();
+	return n;
+}
+
+void gltf_model::load_images(const json_value& doc) {
+	std::vector<std::future<std::shared_ptr<texture>>> pending;
+	thread_pool& pool = de2::get_instance().get_pool();
+
+	for (auto& img : doc["images"].items()) {
+		if (!img.has("bufferView"))
+			throw std::runtime_error("gltf: external images are not supported: " + path_);
+		const buffer_view& v = views_.at(img["bufferView"].as_size());
+		const unsigned char* data = bin_.data() + v.offset;
+		size_t size = v.length;
+		auto decode = [data, size]() { return std::make_shared<texture>(data, size); };
+
+		//term: a loader already running on the pool decodes inline so it cannot starve the pool waiting on itself
+		if (pool.on_worker_thread()) {
+			std::promise<std::shared_ptr<texture>> done;
+			done.set_value(decode());
+			pending.push_back(done.get_future());
+		}
+		else {
+			pending.push_back(pool.enqueue(decode));
+		}
+	}
+	for (auto& f : pending)
+		images.push_back(f.get());
+}
+void gltf_model::load_node(const json_value& doc, size_t node_index, const glm::mat4& parent) {
+	const json_value& node = doc["nodes"][node_index];
+	glm::mat4 transform = parent * node_matrix(node);
+	if (node.has("mesh"))
+		load_mesh(doc, node["mesh"].as_size(), transform);
+	for (auto& c : node["children"].items())
+		load_node(doc, c.as_size(), transform);
+}
+void gltf_model::load_mesh(const json_value& doc, size_t mesh_index, const glm::mat4& transform) {
+	static const std::pair<const char*, GLuint> locations[] = { { "POSITION", 0 }, { "NORMAL", 1 }, { "TEXCOORD_0", 2 } };
+	const json_value& accessors = doc["accessors"];
+	//term: gl reads count elements at stride from the accessor's offset, all of them must lie inside the uploaded view
+	auto check_range = [&](size_t view, size_t offset, size_t count, size_t stride, size_t element) {
+		size_t length = views_.at(view).length;
+		if (count > 0 && (element > length || offset > length - element || count - 1 > (length - element - offset) / stride))
+			throw std::runtime_error("gltf: accessor exceeds its buffer view: " + path_);
+	};
+
+	for (auto& prim : doc["meshes"][mesh_index]["primitives"].items()) {
+		primitive p;
+		p.mode = (GLenum)prim["mode"].as_int(GL_TRIANGLES);
+		p.transform = transform;
+
+		for (auto& [name, location] : locations) {
+			if (!prim["attributes"].has(name))
+				continue;
+			const json_value& acc = accessors[prim["attributes"][name].as_size()];
+			if (!acc.has("bufferView") || acc.has("sparse"))
+				throw std::runtime_error("gltf: sparse or empty accessors are not supported: " + path_);
+
+			attribute a;
+			a.location = location;
+			a.components = component_count(acc["type"].as_string());
+			a.type = (GLenum)acc["componentType"].as_int();
+			a.normalized = acc["normalized"].as_bool() ? GL_TRUE : GL_FALSE;
+			a.view = acc["bufferView"].as_size();
+			a.offset = acc["byteOffset"].as_size();
+			a.stride = (GLsizei)doc["bufferViews"][a.view]["byteStride"].as_size();
+			size_t element = a.components * component_size(a.type);
+			check_range(a.view, a.offset, acc["count"].as_size(), a.stride ? a.stride : element, element);
+			views_.at(a.view).used = true;
+			p.attributes.push_back(a);
+
+			//term: POSITION comes first, every other attribute is read for as many vertices
+			if (location == 0) {
+				p.count = (GLsizei)acc["count"].as_size();
+				if (acc.has("min") && acc.has("max")) {
+					glm::vec3 lo{ acc["min"][0].as_number(), acc["min"][1].as_number(), acc["min"][2].as_number() };
+					glm::vec3 hi{ acc["max"][0].as_number(), acc["max"][1].as_number(), acc["max"][2].as_number() };
+					p.bounds_center = (lo + hi) * 0.5f;
+					p.bounds_radius = glm::length(hi - lo) * 0.5f;
+				}
+			}
+			else if (acc["count"].as_size() < (size_t)p.count)
+				throw std::runtime_error("gltf: " + std::string(name) + " has fewer elements than POSITION: " + path_);
+		}
+		if (p.attributes.empty() || p.attributes.front().location != 0)
+			throw std::runtime_error("gltf: primitive without POSITION: " + path_);
+
+		if (prim.has("indices")) {
+			const json_value& acc = accessors[prim["indices"].as_size()];
+			p.index_view = acc["bufferView"].as_int(-1);
+			if (p.index_view < 0)
+				throw std::runtime_error("gltf: index accessor without buffer view: " + path_);
+			p.index_type = (GLenum)acc["componentType"].as_int();
+			p.index_offset = acc["byteOffset"].as_size();
+			size_t vertices = (size_t)p.count;
+			size_t count = acc["count"].as_size();
+			size_t index_size = component_size(p.index_type);
+			check_range(p.index_view, p.index_offset, count, index_size, index_size);
+
+			//term: gl doesn't bound indices, one past the vertex count reads outside every attribute
+			const unsigned char* indices = bin_.data() + views_.at(p.index_view).offset + p.index_offset;
+			uint32_t largest = 0;
+			switch (p.index_type) {
+			case GL_UNSIGNED_BYTE: largest = max_index<uint8_t>(indices, count); break;
+			case GL_UNSIGNED_SHORT: largest = max_index<uint16_t>(indices, count); break;
+			case GL_UNSIGNED_INT: largest = max_index<uint32_t>(indices, count); break;
+			default: throw std::runtime_error("gltf: unsupported index type: " + path_);
+			}
+			if (count > 0 && largest >= vertices)
+				throw std::runtime_error("gltf: index " + std::to_string(largest) + " past the vertex count: " + path_);
+			p.count = (GLsizei)count;
+			views_.at(p.index_view).used = true;
+		}
+
+		if (prim.has("material")) {
+			const json_value& tex = doc["materials"][prim["material"].as_size()]["pbrMetallicRoughness"]["baseColorTexture"];
+			if (tex.has("index"))
+				p.image = doc["textures"][tex["index"].as_size()]["source"].as_int(-1);
+		}
+		primitives.push_back(p);
+	}
+}
+
+bool gltf_model::upload() {
+	if (uploaded_)
+		return true;
+
+	//term: no per-vertex conversion, each referenced buffer view is copied once from the mapping
+	for (auto& v : views_) {
+		if (!v.used)
+			continue;
+		glGenBuffers(1, &v.vbo);
+		glBindBuffer(GL_ARRAY_BUFFER, v.vbo);
+		glBufferData(GL_ARRAY_BUFFER, v.length, bin_.data() + v.offset, GL_STATIC_DRAW);
+	}
+
+	for (auto& p : primitives) {
+		glGenVertexArrays(1, &p.vao);
+		glBindVertexArray(p.vao);
+		for (auto& a : p.attributes) {
+			glBindBuffer(GL_ARRAY_BUFFER, views_[a.view].vbo);
+			glVertexAttribPointer(a.location, a.components, a.type, a.normalized, a.stride, (void*)a.offset);
+			glEnableVertexAttribArray(a.location);
+		}
+		if (p.index_view >= 0)
+			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, views_[p.index_view].vbo);
+		glBindVertexArray(0);
+	}
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	for (auto& img : images)
+		img->upload();
+
+	if (!primitives.empty())
+		vao = primitives.front().vao;
+	bin_ = {};
+	file_.reset();
+	source_ = {};
+	uploaded_ = true;
+	return true;
+}
+void gltf_model::draw() {
+	prg->use();
+	prg->setuniform("material.specular"_id, specular);
+	prg->setuniform("material.shininess"_id, shininess);
+
+	render_stats& stats = render_stats::frame();
+	bool capturing = gl_capture::recording();
+	for (auto& p : primitives) {
+		prg->setuniform("model"_id, mat_model * p.transform);
+		stats.vao_binds++;
+		stats.draw_calls++;
+		stats.triangles += p.mode == GL_TRIANGLES ? p.count / 3 : 0;
+		if (capturing)
+			gl_capture::bind_vao(p.vao);
+		glBindVertexArray(p.vao);
+		if (p.image >= 0 && p.image < (int)images.size()) {
+			auto& mips = de2::get_instance().mip_residency_;
+			if (p.bounds_radius >= 0)
+				mips.request(*images[p.image], p.bounds_center, p.bounds_radius, mat_model * p.transform);
+			else
+				mips.request(*images[p.image], FLT_MAX);
+			images[p.image]->activate();
+		}
+
+		if (p.index_view >= 0) {
+			if (capturing)
+				gl_capture::draw_elements(p.mode, p.count, p.index_type, p.index_offset);
+			glDrawElements(p.mode, p.count, p.index_type, (void*)p.index_offset);
+		}
+		else {
+			if (capturing)
+				gl_capture::draw_arrays(p.mode, 0, p.count);
+			glDrawArrays(p.mode, 0, p.count);
+		}
+	}
+	if (capturing)
+		gl_capture::bind_vao(0);
+	glBindVertexArray(0);
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "framework.h"
+#include "model.h"
+#include "mapped_file.h"
+#include "asset_pack.h"
+#include <span>
+
+class json_value;
+
+//term: .glb only, buffer views go to the gpu straight from the mapped file
+class gltf_model : public model {
+public:
+	struct attribute {
+		GLuint location{ 0 };
+		GLint components{ 0 };
+		GLenum type{ GL_FLOAT };
+		GLboolean normalized{ GL_FALSE };
+		GLsizei stride{ 0 };
+		size_t offset{ 0 };
+		size_t view{ 0 };
+	};
+	struct primitive {
+		std::vector<attribute> attributes;
+		GLenum mode{ GL_TRIANGLES };
+		GLsizei count{ 0 };
+		GLenum index_type{ 0 };
+		size_t index_offset{ 0 };
+		int index_view{ -1 };
+		int image{ -1 };
+		glm::mat4 transform{ 1.0f };
+		//term: negative when the POSITION accessor has no min and max
+		glm::vec3 bounds_center{ 0, 0, 0 };
+		float bounds_radius{ -1 };
+		GLuint vao{ 0 };
+	};
+	struct buffer_view {
+		size_t offset{ 0 };
+		size_t length{ 0 };
+		bool used{ false };
+		GLuint vbo{ 0 };
+	};
+
+	gltf_model(std::string path);
+	~gltf_model() override;
+
+	void draw() override;
+	bool upload() override;
+	size_t cpu_bytes() const override;
+	size_t gpu_bytes() const override;
+
+	std::string path_;
+	std::vector<primitive> primitives;
+	std::vector<std::shared_ptr<texture>> images;
+	glm::vec3 specular{ 0.5, 0.5, 0.5 };
+	float shininess{ 16.0 };
+
+protected:
+	std::unique_ptr<mapped_file> file_;
+	asset_blob source_;
+	bool uploaded_{ false };
+	std::span<const unsigned char> bin_;
+	std::vector<buffer_view> views_;
+
+	void load_images(const json_value& doc);
+	void load_mesh(const json_value& doc, size_t mesh_index, const glm::mat4& transform);
+	void load_node(const json_value& doc, size_t node_index, const glm::mat4& parent);
+};
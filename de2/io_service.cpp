@@ -0,0 +1,418 @@
+#include "pch.h"
+#include "io_service.h"
+#include <cstring>
+#include <stdexcept>
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <sys/eventfd.h>
+#include <sys/syscall.h>
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#define DE2_HAS_IO_URING 1
+#endif
+#endif
+
+//IO_BUFFER_POOL
+namespace {
+	size_t size_class(size_t size) {
+		size_t c = 4096;
+		while (c < size)
+			c <<= 1;
+		return c;
+	}
+}
+std::shared_ptr<io_buffer> io_buffer_pool::acquire(size_t size) {
+	size_t c = size_class(size);
+	auto b = new io_buffer();
+	{
+		std::unique_lock<std::mutex> lock(mutex_);
+		auto& list = free_[c];
+		if (!list.empty()) {
+			b->storage = std::move(list.back());
+			list.pop_back();
+			retained_ -= c;
+		}
+	}
+	if (b->storage.size() != c)
+		b->storage.resize(c);
+	b->size = size;
+
+	std::weak_ptr<io_buffer_pool> owner = weak_from_this();
+	return std::shared_ptr<io_buffer>(b, [owner](io_buffer* b) {
+		if (auto pool = owner.lock())
+			pool->release(b);
+		delete b;
+	});
+}
+void io_buffer_pool::release(io_buffer* b) {
+	size_t c = b->storage.size();
+	std::unique_lock<std::mutex> lock(mutex_);
+	if (retained_ + c > max_retained_)
+		return;
+	retained_ += c;
+	free_[c].push_back(std::move(b->storage));
+}
+
+
+//IO_SERVICE
+struct io_service::request {
+	std::string path;
+	completion done;
+	std::shared_ptr<io_buffer> buffer;
+	size_t offset{ 0 };
+#ifndef _WIN32
+	int fd{ -1 };
+	iovec iov{};
+#endif
+};
+
+#ifdef DE2_HAS_IO_URING
+//term: raw io_uring rings, no liburing dependency
+struct io_service::uring {
+	int fd{ -1 }, wake_fd{ -1 };
+	unsigned *sq_head{ nullptr }, *sq_tail{ nullptr }, *sq_mask{ nullptr }, *sq_entries{ nullptr }, *sq_array{ nullptr };
+	unsigned *cq_head{ nullptr }, *cq_tail{ nullptr }, *cq_mask{ nullptr };
+	io_uring_sqe* sqes{ nullptr };
+	io_uring_cqe* cqes{ nullptr };
+	void* sq_ptr{ MAP_FAILED };
+	void* cq_ptr{ MAP_FAILED };
+	size_t sq_size{ 0 }, cq_size{ 0 }, sqes_size{ 0 };
+	unsigned local_tail{ 0 }, published_tail{ 0 };
+
+	static std::unique_ptr<uring> create(unsigned entries) {
+		auto r = std::make_unique<uring>();
+		io_uring_params p{};
+		r->fd = (int)syscall(__NR_io_uring_setup, entries, &p);
+		if (r->fd < 0)
+			return nullptr;
+
+		r->sq_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+		r->cq_size = p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe);
+		bool single = p.features & IORING_FEAT_SINGLE_MMAP;
+		if (single)
+			r->sq_size = r->cq_size = std::max(r->sq_size, r->cq_size);
+
+		r->sq_ptr = mmap(nullptr, r->sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_SQ_RING);
+		if (r->sq_ptr == MAP_FAILED)
+			return nullptr;
+		r->cq_ptr = single ? r->sq_ptr : mmap(nullptr, r->cq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_CQ_RING);
+		if (r->cq_ptr == MAP_FAILED)
+			return nullptr;
+		r->sqes_size = p.sq_entries * sizeof(io_uring_sqe);
+		void* sqes = mmap(nullptr, r->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_SQES);
+		if (sqes == MAP_FAILED)
+			return nullptr;
+		r->sqes = (io_uring_sqe*)sqes;
+
+		char* sq = (char*)r->sq_ptr;
+		char* cq = (char*)r->cq_ptr;
+		r->sq_head = (unsigned*)(sq + p.sq_off.head);
+		r->sq_tail = (unsigned*)(sq + p.sq_off.tail);
+		r->sq_mask = (unsigned*)(sq + p.sq_off.ring_mask);
+		r->sq_entries = (unsigned*)(sq + p.sq_off.ring_entries);
+		r->sq_array = (unsigned*)(sq + p.sq_off.array);
+		r->cq_head = (unsigned*)(cq + p.cq_off.head);
+		r->cq_tail = (unsigned*)(cq + p.cq_off.tail);
+		r->cq_mask = (unsigned*)(cq + p.cq_off.ring_mask);
+		r->cqes = (io_uring_cqe*)(cq + p.cq_off.cqes);
+		r->local_tail = r->published_tail = *r->sq_tail;
+
+		r->wake_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+		if (r->wake_fd < 0)
+			return nullptr;
+		return r;
+	}
+	~uring() {
+		if (sqes != nullptr)
+			munmap(sqes, sqes_size);
+		if (cq_ptr != MAP_FAILED && cq_ptr != sq_ptr)
+			munmap(cq_ptr, cq_size);
+		if (sq_ptr != MAP_FAILED)
+			munmap(sq_ptr, sq_size);
+		if (wake_fd >= 0)
+			close(wake_fd);
+		if (fd >= 0)
+			close(fd);
+	}
+
+	io_uring_sqe* next_sqe() {
+		unsigned head = std::atomic_ref<unsigned>(*sq_head).load(std::memory_order_acquire);
+		if (local_tail - head >= *sq_entries)
+			return nullptr;
+		unsigned idx = local_tail & *sq_mask;
+		sq_array[idx] = idx;
+		local_tail++;
+		io_uring_sqe* sqe = &sqes[idx];
+		memset(sqe, 0, sizeof(*sqe));
+		return sqe;
+	}
+	void prep_read(request* req) {
+		io_uring_sqe* sqe = next_sqe();
+		if (sqe == nullptr)
+			throw std::runtime_error("io_uring: submission queue full");
+		req->iov.iov_base = req->buffer->storage.data() + req->offset;
+		req->iov.iov_len = req->buffer->size - req->offset;
+		sqe->opcode = IORING_OP_READV;
+		sqe->fd = req->fd;
+		sqe->off = req->offset;
+		sqe->addr = (uint64_t)&req->iov;
+		sqe->len = 1;
+		sqe->user_data = (uint64_t)req;
+	}
+	//term: user_data 0 is the wakeup poll on wake_fd
+	void prep_wake_poll() {
+		io_uring_sqe* sqe = next_sqe();
+		if (sqe == nullptr)
+			throw std::runtime_error("io_uring: submission queue full");
+		sqe->opcode = IORING_OP_POLL_ADD;
+		sqe->fd = wake_fd;
+		sqe->poll_events = POLLIN;
+		sqe->user_data = 0;
+	}
+	void submit_and_wait() {
+		unsigned to_submit = local_tail - published_tail;
+		std::atomic_ref<unsigned>(*sq_tail).store(local_tail, std::memory_order_release);
+		published_tail = local_tail;
+		while (syscall(__NR_io_uring_enter, fd, to_submit, 1, IORING_ENTER_GETEVENTS, nullptr, 0) < 0) {
+			if (errno != EINTR)
+				throw std::runtime_error(std::string("io_uring_enter: ") + strerror(errno));
+			to_submit = 0;
+		}
+	}
+	template<typename F> void reap(F&& f) {
+		unsigned head = *cq_head;
+		while (head != std::atomic_ref<unsigned>(*cq_tail).load(std::memory_order_acquire)) {
+			io_uring_cqe cqe = cqes[head & *cq_mask];
+			head++;
+			std::atomic_ref<unsigned>(*cq_head).store(head, std::memory_order_release);
+			f(cqe);
+		}
+	}
+};
+#else
+struct io_service::uring {};
+#endif
+
+io_service::io_service(thread_pool& decode_pool, unsigned queue_depth, size_t fallback_threads)
+	: decode_pool_(decode_pool), buffers_(std::make_shared<io_buffer_pool>()), queue_depth_(std::max(queue_depth, 1u)) {
+#ifdef DE2_HAS_IO_URING
+	//term: one extra entry for the wakeup poll
+	uring_ = uring::create(queue_depth_ + 1);
+	if (uring_) {
+		threads_.push_back(std::thread(&io_service::uring_loop, this));
+		return;
+	}
+#endif
+	for (size_t i = 0; i < std::max<size_t>(fallback_threads, 1); i++)
+		threads_.push_back(std::thread(&io_service::fallback_loop, this));
+}
+io_service::~io_service() {
+	{
+		std::unique_lock<std::mutex> lock(queue_mutex_);
+		bailout_ = true;
+	}
+	cv_.notify_all();
+#ifdef DE2_HAS_IO_URING
+	if (uring_) {
+		uint64_t one = 1;
+		(void)!write(uring_->wake_fd, &one, sizeof(one));
+	}
+#endif
+	for (std::thread& th : threads_)
+		th.join();
+
+	for (auto& req : queue_)
+		finish(std::move(req), std::make_exception_ptr(std::runtime_error("io_service stopped")));
+}
+const char* io_service::backend_name() const {
+#ifdef _WIN32
+	return "ReadFile";
+#else
+	return uring_ ? "io_uring" : "pread";
+#endif
+}
+
+void io_service::read(const std::string& path, completion done) {
+	auto req = std::make_unique<request>();
+	req->path = path;
+	req->done = std::move(done);
+	{
+		std::unique_lock<std::mutex> lock(queue_mutex_);
+		if (bailout_)
+			throw std::runtime_error("io_service stopped");
+		queue_.push_back(std::move(req));
+	}
+#ifdef DE2_HAS_IO_URING
+	if (uring_) {
+		uint64_t one = 1;
+		(void)!write(uring_->wake_fd, &one, sizeof(one));
+		return;
+	}
+#endif
+	cv_.notify_one();
+}
+
+void io_service::finish(std::unique_ptr<request> req, std::exception_ptr error) {
+#ifndef _WIN32
+	if (req->fd >= 0)
+		close(req->fd);
+	req->fd = -1;
+#endif
+	std::shared_ptr<io_buffer> buffer = error ? nullptr : std::move(req->buffer);
+	completion done = std::move(req->done);
+	decode_pool_.enqueue([done, buffer, error]() {
+		done(buffer, error);
+	});
+}
+
+void io_service::read_blocking(request& req) {
+#ifdef _WIN32
+	HANDLE h = CreateFileA(req.path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (h == INVALID_HANDLE_VALUE)
+		throw std::runtime_error("could not open file: " + req.path);
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(h, &size)) {
+		CloseHandle(h);
+		throw std::runtime_error("could not stat file: " + req.path);
+	}
+	req.buffer = buffers_->acquire((size_t)size.QuadPart);
+	while (req.offset < req.buffer->size) {
+		//term: positional read, the windows counterpart of pread
+		OVERLAPPED ov{};
+		ov.Offset = (DWORD)(req.offset & 0xFFFFFFFF);
+		ov.OffsetHigh = (DWORD)((uint64_t)req.offset >> 32);
+		DWORD chunk = (DWORD)std::min<size_t>(req.buffer->size - req.offset, 1 << 30), got = 0;
+		if (!ReadFile(h, req.buffer->storage.data() + req.offset, chunk, &got, &ov) || got == 0) {
+			CloseHandle(h);
+			throw std::runtime_error("read failed: " + req.path);
+		}
+		req.offset += got;
+	}
+	CloseHandle(h);
+#else
+	req.fd = open(req.path.c_str(), O_RDONLY | O_CLOEXEC);
+	if (req.fd < 0)
+		throw std::runtime_error("could not open file: " + req.path);
+	struct stat st;
+	if (fstat(req.fd, &st) != 0)
+		throw std::runtime_error("could not stat file: " + req.path);
+	req.buffer = buffers_->acquire((size_t)st.st_size);
+	while (req.offset < req.buffer->size) {
+		ssize_t got = pread(req.fd, req.buffer->storage.data() + req.offset, req.buffer->size - req.offset, (off_t)req.offset);
+		if (got < 0 && errno == EINTR)
+			continue;
+		if (got <= 0)
+			throw std::runtime_error("read failed: " + req.path);
+		req.offset += (size_t)got;
+	}
+#endif
+}
+
+void io_service::fallback_loop() {
+	while (true) {
+		std::unique_ptr<request> req;
+		{
+			std::unique_lock<std::mutex> lock(queue_mutex_);
+			cv_.wait(lock, [this] {
+				return bailout_ || !queue_.empty();
+			});
+			if (bailout_)
+				return;
+			req = std::move(queue_.front());
+			queue_.pop_front();
+		}
+		in_flight_++;
+		std::exception_ptr error;
+		try {
+			read_blocking(*req);
+		}
+		catch (...) {
+			error = std::current_exception();
+		}
+		finish(std::move(req), error);
+		in_flight_--;
+	}
+}
+
+void io_service::uring_loop() {
+#ifdef DE2_HAS_IO_URING
+	uring& r = *uring_;
+	r.prep_wake_poll();
+
+	while (true) {
+		//term: open + fstat are done here, the reads themselves are batched into the ring
+		std::vector<std::unique_ptr<request>> started;
+		bool stopping = false;
+		{
+			std::unique_lock<std::mutex> lock(queue_mutex_);
+			stopping = bailout_;
+			while (!stopping && !queue_.empty() && in_flight_ < queue_depth_) {
+				started.push_back(std::move(queue_.front()));
+				queue_.pop_front();
+				in_flight_++;
+			}
+		}
+		if (stopping && in_flight_ == 0)
+			return;
+
+		for (auto& req : started) {
+			try {
+				req->fd = open(req->path.c_str(), O_RDONLY | O_CLOEXEC);
+				if (req->fd < 0)
+					throw std::runtime_error("could not open file: " + req->path);
+				struct stat st;
+				if (fstat(req->fd, &st) != 0)
+					throw std::runtime_error("could not stat file: " + req->path);
+				req->buffer = buffers_->acquire((size_t)st.st_size);
+				if (req->buffer->size == 0) {
+					finish(std::move(req), nullptr);
+					in_flight_--;
+					continue;
+				}
+				r.prep_read(req.get());
+				req.release();
+			}
+			catch (...) {
+				finish(std::move(req), std::current_exception());
+				in_flight_--;
+			}
+		}
+
+		r.submit_and_wait();
+		r.reap([&](const io_uring_cqe& cqe) {
+			if (cqe.user_data == 0) {
+				uint64_t v;
+				while (::read(r.wake_fd, &v, sizeof(v)) > 0) {}
+				r.prep_wake_poll();
+				return;
+			}
+			std::unique_ptr<request> req((request*)cqe.user_data);
+			if (cqe.res == -EINTR || cqe.res == -EAGAIN) {
+				r.prep_read(req.release());
+				return;
+			}
+			if (cqe.res <= 0) {
+				std::string why = "read failed: " + req->path + ": " + (cqe.res == 0 ? "unexpected end of file" : strerror(-cqe.res));
+				finish(std::move(req), std::make_exception_ptr(std::runtime_error(why)));
+				in_flight_--;
+				return;
+			}
+			req->offset += (size_t)cqe.res;
+			if (req->offset < req->buffer->size) {
+				//term: short read, queue the remainder
+				r.prep_read(req.release());
+				return;
+			}
+			finish(std::move(req), nullptr);
+			in_flight_--;
+		});
+	}
+#endif
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include "framework.h"
+#include "thread_pool.h"
+#include <span>
+#include <deque>
+#include <atomic>
+#include <future>
+#include <condition_variable>
+
+//term: the storage goes back to the pool when the last reference drops
+struct io_buffer {
+	std::vector<unsigned char> storage;
+	size_t size{ 0 };
+
+	const unsigned char* data() const { return storage.data(); }
+	std::span<const unsigned char> span() const { return { storage.data(), size }; }
+};
+
+class io_buffer_pool : public std::enable_shared_from_this<io_buffer_pool> {
+public:
+	io_buffer_pool(size_t max_retained = 64 * 1024 * 1024) : max_retained_(max_retained) {}
+	std::shared_ptr<io_buffer> acquire(size_t size);
+
+protected:
+	void release(io_buffer* buffer);
+	std::mutex mutex_;
+	std::unordered_map<size_t, std::vector<std::vector<unsigned char>>> free_;
+	size_t retained_{ 0 }, max_retained_;
+};
+
+//term: completions run on the decode pool, pool workers never block on disk
+class io_service {
+public:
+	using completion = std::function<void(std::shared_ptr<io_buffer> buffer, std::exception_ptr error)>;
+
+	io_service(thread_pool& decode_pool, unsigned queue_depth = 256, size_t fallback_threads = 4);
+	~io_service();
+	io_service(const io_service& other) = delete;
+	io_service& operator=(const io_service& other) = delete;
+
+	void read(const std::string& path, completion done);
+
+	template<typename F>
+	auto read_async(const std::string& path, F decode) -> std::future<std::invoke_result_t<F, std::shared_ptr<io_buffer>>> {
+		using R = std::invoke_result_t<F, std::shared_ptr<io_buffer>>;
+		auto result = std::make_shared<std::promise<R>>();
+		read(path, [result, decode](std::shared_ptr<io_buffer> buffer, std::exception_ptr error) {
+			if (error) {
+				result->set_exception(error);
+				return;
+			}
+			try {
+				if constexpr (std::is_void_v<R>) {
+					decode(buffer);
+					result->set_value();
+				}
+				else {
+					result->set_value(decode(buffer));
+				}
+			}
+			catch (...) {
+				result->set_exception(std::current_exception());
+			}
+		});
+		return result->get_future();
+	}
+
+	const char* backend_name() const;
+	size_t in_flight() const { return in_flight_.load(std::memory_order_relaxed); }
+
+protected:
+	struct request;
+	struct uring;
+
+	void finish(std::unique_ptr<request> req, std::exception_ptr error);
+	void fallback_loop();
+	void uring_loop();
+	void read_blocking(request& req);
+
+	thread_pool& decode_pool_;
+	std::shared_ptr<io_buffer_pool> buffers_;
+	std::unique_ptr<uring> uring_;
+	unsigned queue_depth_;
+
+	std::deque<std::unique_ptr<request>> queue_;
+	std::mutex queue_mutex_;
+	std::condition_variable cv_;
+	bool bailout_{ false };
+	std::atomic<size_t> in_flight_{ 0 };
+	std::vector<std::thread> threads_;
+};
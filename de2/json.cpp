@@ -0,0 +1,218 @@
+#include "pch.h"
+#include "json.h"
+#include <stdexcept>
+#include <cstdlib>
+
+class json_parser {
+	std::string_view s_;
+	size_t p_{ 0 };
+
+	void skip_ws() {
+		while (p_ < s_.size() && (s_[p_] == ' ' || s_[p_] == '\t' || s_[p_] == '\n' || s_[p_] == '\r'))
+			p_++;
+	}
+	[[noreturn]] void fail(const std::string& what) {
+		throw std::runtime_error("json: " + what + " at offset " + std::to_string(p_));
+	}
+	char peek() {
+		skip_ws();
+		if (p_ >= s_.size())
+			fail("unexpected end of input");
+		return s_[p_];
+	}
+	void expect(char c) {
+		if (peek() != c)
+			fail(std::string("expected '") + c + "'");
+		p_++;
+	}
+	bool consume(std::string_view word) {
+		if (s_.substr(p_, word.size()) != word)
+			return false;
+		p_ += word.size();
+		return true;
+	}
+	static void append_utf8(std::string& out, unsigned cp) {
+		if (cp < 0x80) {
+			out += (char)cp;
+		}
+		else if (cp < 0x800) {
+			out += (char)(0xC0 | (cp >> 6));
+			out += (char)(0x80 | (cp & 0x3F));
+		}
+		else if (cp < 0x10000) {
+			out += (char)(0xE0 | (cp >> 12));
+			out += (char)(0x80 | ((cp >> 6) & 0x3F));
+			out += (char)(0x80 | (cp & 0x3F));
+		}
+		else {
+			out += (char)(0xF0 | (cp >> 18));
+			out += (char)(0x80 | ((cp >> 12) & 0x3F));
+			out += (char)(0x80 | ((cp >> 6) & 0x3F));
+			out += (char)(0x80 | (cp & 0x3F));
+		}
+	}
+	unsigned parse_hex4() {
+		if (p_ + 4 > s_.size())
+			fail("bad unicode escape");
+		unsigned v = 0;
+		for (int i = 0; i < 4; i++) {
+			char c = s_[p_++];
+			v <<= 4;
+			if (c >= '0' && c <= '9') v |= c - '0';
+			else if (c >= 'a' && c <= 'f') v |= c - 'a' + 10;
+			else if (c >= 'A' && c <= 'F') v |= c - 'A' + 10;
+			else fail("bad unicode escape");
+		}
+		return v;
+	}
+	std::string parse_string() {
+		expect('"');
+		std::string out;
+		while (true) {
+			if (p_ >= s_.size())
+				fail("unterminated string");
+			char c = s_[p_++];
+			if (c == '"')
+				break;
+			if (c != '\\') {
+				out += c;
+				continue;
+			}
+			if (p_ >= s_.size())
+				fail("unterminated string");
+			char e = s_[p_++];
+			switch (e) {
+			case '"': out += '"'; break;
+			case '\\': out += '\\'; break;
+			case '/': out += '/'; break;
+			case 'b': out += '\b'; break;
+			case 'f': out += '\f'; break;
+			case 'n': out += '\n'; break;
+			case 'r': out += '\r'; break;
+			case 't': out += '\t'; break;
+			case 'u': {
+				unsigned cp = parse_hex4();
+				if (cp >= 0xD800 && cp <= 0xDBFF && consume("\\u")) {
+					unsigned lo = parse_hex4();
+					cp = 0x10000 + ((cp - 0xD800) << 10) + (lo - 0xDC00);
+				}
+				append_utf8(out, cp);
+				break;
+			}
+			default:
+				fail("bad escape");
+			}
+		}
+		return out;
+	}
+	double parse_number() {
+		size_t start = p_;
+		while (p_ < s_.size() && (isdigit((unsigned char)s_[p_]) || s_[p_] == '-' || s_[p_] == '+' || s_[p_] == '.' || s_[p_] == 'e' || s_[p_] == 'E'))
+			p_++;
+		std::string num(s_.substr(start, p_ - start));
+		char* end = nullptr;
+		double v = strtod(num.c_str(), &end);
+		if (num.empty() || end != num.c_str() + num.size())
+			fail("bad number");
+		return v;
+	}
+public:
+	json_parser(std::string_view s) : s_(s) {}
+
+	json_value parse_value() {
+		json_value v;
+		char c = peek();
+		if (c == '{') {
+			p_++;
+			v.type_ = json_value::kind::object;
+			if (peek() == '}') {
+				p_++;
+				return v;
+			}
+			while (true) {
+				std::string key = parse_string();
+				expect(':');
+				v.obj_[key] = parse_value();
+				if (peek() == ',') {
+					p_++;
+					continue;
+				}
+				expect('}');
+				break;
+			}
+		}
+		else if (c == '[') {
+			p_++;
+			v.type_ = json_value::kind::array;
+			if (peek() == ']') {
+				p_++;
+				return v;
+			}
+			while (true) {
+				v.arr_.push_back(parse_value());
+				if (peek() == ',') {
+					p_++;
+					continue;
+				}
+				expect(']');
+				break;
+			}
+		}
+		else if (c == '"') {
+			v.type_ = json_value::kind::string;
+			v.str_ = parse_string();
+		}
+		else if (consume("true")) {
+			v.type_ = json_value::kind::boolean;
+			v.b_ = true;
+		}
+		else if (consume("false")) {
+			v.type_ = json_value::kind::boolean;
+		}
+		else if (consume("null")) {
+		}
+		else {
+			v.type_ = json_value::kind::number;
+			v.num_ = parse_number();
+		}
+		return v;
+	}
+	void finish() {
+		skip_ws();
+		if (p_ != s_.size())
+			fail("trailing characters");
+	}
+};
+
+json_value json_value::parse(std::string_view text) {
+	json_parser p(text);
+	json_value v = p.parse_value();
+	p.finish();
+	return v;
+}
+
+bool json_value::has(const std::string& key) const {
+	return type_ == kind::object && obj_.find(key) != obj_.end();
+}
+const json_value& json_value::operator[](const std::string& key) const {
+	static const json_value null_value;
+	if (type_ != kind::object)
+		return null_value;
+	auto it = obj_.find(key);
+	return it == obj_.end() ? null_value : it->second;
+}
+const json_value& json_value::operator[](size_t index) const {
+	static const json_value null_value;
+	if (type_ != kind::array || index >= arr_.size())
+		return null_value;
+	return arr_[index];
+}
+size_t json_value::size() const {
+	return type_ == kind::array ? arr_.size() : type_ == kind::object ? obj_.size() : 0;
+}
+bool json_value::as_bool(bool def) const {
+	return type_ == kind::boolean ? b_ : def;
+}
+double json_value::as_number(double def) const {
+	return type_ == kind::number ? num_ : def;
+}
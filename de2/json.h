@@ -0,0 +1,45 @@
+#pragma once
+
+#include <map>
+#include <string>
+#include <vector>
+#include <memory>
+#include <string_view>
+
+//term: minimal json reader, enough for gltf headers and scene manifests
+class json_value {
+public:
+	enum class kind { null, boolean, number, string, array, object };
+
+	json_value() {}
+	static json_value parse(std::string_view text);
+
+	kind type() const { return type_; }
+	bool is_null() const { return type_ == kind::null; }
+	bool is_array() const { return type_ == kind::array; }
+	bool is_object() const { return type_ == kind::object; }
+	bool has(const std::string& key) const;
+
+	const json_value& operator[](const std::string& key) const;
+	const json_value& operator[](size_t index) const;
+	size_t size() const;
+
+	bool as_bool(bool def = false) const;
+	double as_number(double def = 0) const;
+	int as_int(int def = 0) const { return (int)as_number(def); }
+	size_t as_size(size_t def = 0) const { return (size_t)as_number((double)def); }
+	const std::string& as_string() const { return str_; }
+
+	const std::vector<json_value>& items() const { return arr_; }
+	const std::map<std::string, json_value>& members() const { return obj_; }
+
+protected:
+	kind type_{ kind::null };
+	bool b_{ false };
+	double num_{ 0 };
+	std::string str_;
+	std::vector<json_value> arr_;
+	std::map<std::string, json_value> obj_;
+
+	friend class json_parser;
+};
@@ -0,0 +1,233 @@
+#include "pch.h"
+#include "ktx2.h"
+#include "mipmap.h"
+#include "tracer.h"
+#include <stb_image.h>
+#include <cstring>
+#include <cstdlib>
+#include <stdexcept>
+
+namespace {
+	const unsigned char identifier[12] = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+
+	//term: vkFormat values
+	enum : uint32_t {
+		vk_bc1_rgb_unorm = 131, vk_bc1_rgb_srgb = 132,
+		vk_bc3_unorm = 137, vk_bc3_srgb = 138,
+		vk_bc4_unorm = 139, vk_bc5_unorm = 141,
+	};
+
+#pragma pack(push, 4)
+	struct header {
+		uint32_t vk_format, type_size, width, height, depth, layers, faces, levels, supercompression;
+		uint32_t dfd_offset, dfd_length, kvd_offset, kvd_length;
+		uint64_t sgd_offset, sgd_length;
+	};
+#pragma pack(pop)
+	static_assert(sizeof(header) == 68, "ktx2 header must be packed");
+
+	struct level_index {
+		uint64_t offset, length, uncompressed_length;
+	};
+
+	uint32_t vk_format_of(bc_format f, bool srgb) {
+		switch (f) {
+		case bc_format::bc1: return srgb ? vk_bc1_rgb_srgb : vk_bc1_rgb_unorm;
+		case bc_format::bc3: return srgb ? vk_bc3_srgb : vk_bc3_unorm;
+		case bc_format::bc4: return vk_bc4_unorm;
+		default: return vk_bc5_unorm;
+		}
+	}
+
+	template<typename T>
+	void put(std::vector<unsigned char>& out, size_t at, const T& value) {
+		memcpy(out.data() + at, &value, sizeof(T));
+	}
+
+	//term: basic data format descriptor, one sample per 64 bit half of the block
+	std::vector<uint32_t> descriptor(bc_format f, bool srgb) {
+		struct sample { uint32_t offset, channel; };
+		std::vector<sample> samples;
+		uint32_t model = 0;
+		switch (f) {
+		case bc_format::bc1: model = 128; samples = { { 0, 0 } }; break;
+		case bc_format::bc3: model = 130; samples = { { 0, 15 | 0x10 }, { 64, 0 } }; break;
+		case bc_format::bc4: model = 131; samples = { { 0, 0 } }; break;
+		case bc_format::bc5: model = 132; samples = { { 0, 0 }, { 64, 1 } }; break;
+		}
+		uint32_t block_size = 24 + 16 * (uint32_t)samples.size();
+		std::vector<uint32_t> words = {
+			4 + block_size,
+			0,
+			2 | block_size << 16,
+			model | 1 << 8 | (srgb ? 2u : 1u) << 16,
+			3 | 3 << 8,
+			(uint32_t)bc_block_bytes(f),
+			0,
+		};
+		for (auto& s : samples) {
+			words.push_back(s.offset | 63 << 16 | s.channel << 24);
+			words.push_back(0);
+			words.push_back(0);
+			words.push_back(0xFFFFFFFF);
+		}
+		return words;
+	}
+}
+
+GLenum ktx2::image::gl_format() const {
+	switch (format) {
+	case bc_format::bc1: return GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+	case bc_format::bc3: return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+	case bc_format::bc4: return GL_COMPRESSED_RED_RGTC1;
+	default: return GL_COMPRESSED_RG_RGTC2;
+	}
+}
+
+size_t ktx2::image::bytes() const {
+	size_t total = 0;
+	for (auto& l : levels)
+		total += l.blocks.size();
+	return total;
+}
+
+bool ktx2::is_ktx2(std::span<const unsigned char> file) {
+	return file.size() >= sizeof(identifier) && memcmp(file.data(), identifier, sizeof(identifier)) == 0;
+}
+
+ktx2::image ktx2::parse(std::span<const unsigned char> file) {
+	if (!is_ktx2(file) || file.size() < sizeof(identifier) + sizeof(header))
+		throw std::runtime_error("ktx2: not a ktx2 file");
+	header h;
+	memcpy(&h, file.data() + sizeof(identifier), sizeof(h));
+
+	image img;
+	switch (h.vk_format) {
+	case vk_bc1_rgb_unorm: case vk_bc1_rgb_srgb: img.format = bc_format::bc1; break;
+	case vk_bc3_unorm: case vk_bc3_srgb: img.format = bc_format::bc3; break;
+	case vk_bc4_unorm: img.format = bc_format::bc4; break;
+	case vk_bc5_unorm: img.format = bc_format::bc5; break;
+	default: throw std::runtime_error("ktx2: unsupported vkFormat " + std::to_string(h.vk_format));
+	}
+	img.srgb = h.vk_format == vk_bc1_rgb_srgb || h.vk_format == vk_bc3_srgb;
+	if (h.supercompression != 0)
+		throw std::runtime_error("ktx2: supercompressed files are not supported");
+	if (h.width == 0 || h.height == 0 || h.depth > 1 || h.layers > 1 || h.faces != 1)
+		throw std::runtime_error("ktx2: only single 2d images are supported");
+	img.width = (int)h.width;
+	img.height = (int)h.height;
+
+	const size_t index_at = sizeof(identifier) + sizeof(header);
+	const uint32_t count = std::max<uint32_t>(h.levels, 1);
+	if (count > mip_levels(img.width, img.height, 1).size() || index_at + count * sizeof(level_index) > file.size())
+		throw std::runtime_error("ktx2: bad level count");
+	for (uint32_t i = 0; i < count; i++) {
+		level_index li;
+		memcpy(&li, file.data() + index_at + i * sizeof(level_index), sizeof(li));
+		level l;
+		l.width = std::max(img.width >> i, 1);
+		l.height = std::max(img.height >> i, 1);
+		if (li.length != bc_level_bytes(l.width, l.height, img.format) || li.offset > file.size() || li.length > file.size() - li.offset)
+			throw std::runtime_error("ktx2: level " + std::to_string(i) + " out of bounds");
+		l.blocks.assign(file.data() + li.offset, file.data() + li.offset + li.length);
+		img.levels.push_back(std::move(l));
+	}
+	return img;
+}
+
+std::vector<unsigned char> ktx2::write(const image& img) {
+	const size_t count = img.levels.size();
+	std::vector<uint32_t> dfd = descriptor(img.format, img.srgb);
+	const size_t index_at = sizeof(identifier) + sizeof(header);
+	const size_t dfd_at = index_at + count * sizeof(level_index);
+	//term: levels are stored smallest first, each aligned to the block size
+	const size_t align = bc_block_bytes(img.format);
+	size_t at = (dfd_at + dfd.size() * 4 + align - 1) / align * align;
+	std::vector<size_t> offsets(count);
+	for (size_t i = count; i-- > 0; ) {
+		offsets[i] = at;
+		at = (at + img.levels[i].blocks.size() + align - 1) / align * align;
+	}
+
+	std::vector<unsigned char> out(offsets[0] + img.levels[0].blocks.size());
+	memcpy(out.data(), identifier, sizeof(identifier));
+	header h{};
+	h.vk_format = vk_format_of(img.format, img.srgb);
+	h.type_size = 1;
+	h.width = (uint32_t)img.width;
+	h.height = (uint32_t)img.height;
+	h.faces = 1;
+	h.levels = (uint32_t)count;
+	h.dfd_offset = (uint32_t)dfd_at;
+	h.dfd_length = (uint32_t)dfd.size() * 4;
+	put(out, sizeof(identifier), h);
+	for (size_t i = 0; i < count; i++) {
+		level_index li{ offsets[i], img.levels[i].blocks.size(), img.levels[i].blocks.size() };
+		put(out, index_at + i * sizeof(level_index), li);
+		memcpy(out.data() + offsets[i], img.levels[i].blocks.data(), img.levels[i].blocks.size());
+	}
+	memcpy(out.data() + dfd_at, dfd.data(), dfd.size() * 4);
+	return out;
+}
+
+ktx2::image ktx2::compress(const unsigned char* rgba, int width, int height, bc_format format, bool srgb, bool mips) {
+	DE2_TRACE_SCOPE("loader", "ktx2::compress");
+	if (width <= 0 || height <= 0)
+		throw std::invalid_argument("ktx2: bad image size");
+	bool color = format == bc_format::bc1 || format == bc_format::bc3;
+	size_t base = (size_t)width * height * 4;
+	unsigned char* chain = (unsigned char*)malloc(base);
+	if (chain == nullptr)
+		throw std::bad_alloc();
+	memcpy(chain, rgba, base);
+	int levels = 1;
+	if (mips) {
+		try {
+			chain = append_mip_chain(chain, width, height, 4, srgb && color, levels);
+		}
+		catch (...) {
+			::free(chain);
+			throw;
+		}
+	}
+
+	image img;
+	img.format = format;
+	img.srgb = srgb && color;
+	img.width = width;
+	img.height = height;
+	for (auto& l : mip_levels(width, height, 4)) {
+		if ((int)img.levels.size() == levels)
+			break;
+		img.levels.push_back({ l.width, l.height, encode_bc(chain + l.offset, l.width, l.height, format) });
+	}
+	::free(chain);
+	return img;
+}
+
+std::vector<unsigned char> ktx2::convert(std::span<const unsigned char> encoded, const bc_format* format, bool srgb, bool mips) {
+	int width = 0, height = 0, comp = 0;
+	unsigned char* rgba = stbi_load_from_memory(encoded.data(), (int)encoded.size(), &width, &height, &comp, STBI_rgb_alpha);
+	if (rgba == nullptr)
+		throw std::runtime_error(std::string("ktx2: can't decode source image: ") + stbi_failure_reason());
+	bc_format f = bc_format::bc1;
+	if (format) {
+		f = *format;
+	}
+	else {
+		for (size_t i = 3; i < (size_t)width * height * 4; i += 4)
+			if (rgba[i] != 255) {
+				f = bc_format::bc3;
+				break;
+			}
+	}
+	try {
+		std::vector<unsigned char> out = write(compress(rgba, width, height, f, srgb, mips));
+		stbi_image_free(rgba);
+		return out;
+	}
+	catch (...) {
+		stbi_image_free(rgba);
+		throw;
+	}
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include "glad/glad.h"
+#include "bc_encoder.h"
+#include <span>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+//term: one 2d image of bc1/bc3/bc4/bc5 blocks with its mip chain, no supercompression
+class ktx2 {
+public:
+	struct level {
+		int width{ 0 }, height{ 0 };
+		std::vector<unsigned char> blocks;
+	};
+	struct image {
+		bc_format format{ bc_format::bc1 };
+		bool srgb{ false };
+		int width{ 0 }, height{ 0 };
+		std::vector<level> levels;
+
+		//term: unorm for srgb files too, the engine samples without srgb decoding
+		GLenum gl_format() const;
+		size_t bytes() const;
+	};
+
+	static bool is_ktx2(std::span<const unsigned char> file);
+	static image parse(std::span<const unsigned char> file);
+	static std::vector<unsigned char> write(const image& img);
+
+	static image compress(const unsigned char* rgba, int width, int height, bc_format format, bool srgb, bool mips = true);
+	//term: without a format, bc3 when any texel is translucent, bc1 otherwise
+	static std::vector<unsigned char> convert(std::span<const unsigned char> encoded, const bc_format* format, bool srgb, bool mips = true);
+};
@@ -1,100 +1,256 @@
 #pragma once
 
 #include "framework.h"
+#include "cache_stats.h"
+#include "disk_cache.h"
+#include "tracer.h"
+#include <array>
 #include <mutex>
 #include <thread>
+#include <optional>
 
 //term: least recently used cache
-template<typename K, typename V, size_t capacity = 8192> class thread_safe_lru_cache {
+template<typename K, typename V, size_t capacity = 8192> class lru_cache {
 public:
-	typedef typename std::list<K>::iterator order_iterator_t;
+	typedef typename std::list<std::pair<K, V>>::iterator order_iterator_t;
 
-	thread_safe_lru_cache(){};
-	virtual ~thread_safe_lru_cache() {};
-	
-	bool exists(K key) {
-		{
-			std::unique_lock<std::mutex> lock(cache_mutex);
-			return data_.find(key) != data_.end();
-		}
+	lru_cache(size_t max_size = capacity) : capacity_(std::max<size_t>(max_size, 1)) {};
+	virtual ~lru_cache() {};
+
+	bool exists(const K& key) const {
+		return data_.find(key) != data_.end();
 	}
 
-	V& get(K key) {
-		{
-			std::unique_lock<std::mutex> lock(cache_mutex);
-			auto it = data_.find(key);
-			if (it == data_.end())
-				throw std::range_error("no such item in the list");
-			order_iterator_t oit = std::find(order_.begin(), order_.end(), key);
-			order_.splice(order_.begin(), order_, oit);
-			return it->second;
-		}
+	V get(const K& key) {
+		auto it = data_.find(key);
+		if (it == data_.end())
+			throw std::range_error("no such item in the list");
+		order_.splice(order_.begin(), order_, it->second);
+		return it->second->second;
 	}
 
-	void put(K key, V val) {
-		{
-			std::unique_lock<std::mutex> lock(cache_mutex);
-			auto it = data_.find(key);
-			if (it == data_.end()) {
-				data_[key] = val;
-			}
-			else {
-				order_.remove(key);
-			}
-			order_.push_front(key);
-
-			if (data_.size() > capacity) {
-				data_.erase(order_.back());
-				order_.pop_back();
-			}
+	std::optional<V> try_get(const K& key) {
+		auto it = data_.find(key);
+		if (it == data_.end())
+			return std::nullopt;
+		order_.splice(order_.begin(), order_, it->second);
+		return it->second->second;
+	}
+
+	//term: no promotion
+	std::optional<V> peek(const K& key) const {
+		auto it = data_.find(key);
+		if (it == data_.end())
+			return std::nullopt;
+		return it->second->second;
+	}
+
+	bool put(const K& key, V val) {
+		auto it = data_.find(key);
+		if (it != data_.end()) {
+			it->second->second = std::move(val);
+			order_.splice(order_.begin(), order_, it->second);
+			return false;
 		}
+		order_.emplace_front(key, std::move(val));
+		data_.emplace(key, order_.begin());
+
+		if (data_.size() > capacity_) {
+			if (on_evict)
+				on_evict(order_.back().first, order_.back().second);
+			data_.erase(order_.back().first);
+			order_.pop_back();
+		}
+		return true;
+	}
+
+	bool erase(const K& key) {
+		auto it = data_.find(key);
+		if (it == data_.end())
+			return false;
+		order_.erase(it->second);
+		data_.erase(it);
+		return true;
+	}
+
+	size_t size() const { return data_.size(); }
+	size_t max_size() const { return capacity_; }
+
+	//term: called for entries dropped by capacity, not for erase or clear
+	std::function<void(const K&, V&)> on_evict;
+	void clear() {
+		data_.clear();
+		order_.clear();
 	}
 protected:
-	std::unordered_map<K, V> data_;
-	std::list<K> order_;
-	std::mutex cache_mutex;
-	//size_t capacity;
+	std::unordered_map<K, order_iterator_t> data_;
+	std::list<std::pair<K, V>> order_;
+	size_t capacity_;
 };
 
-//term: least recently used cache
-template<typename K, typename V, size_t capacity = 8192> class lru_cache {
-public:
-	typedef typename std::list<K>::iterator order_iterator_t;
+//term: least recently used cache, eviction is LRU within a shard and capacity is split evenly between shards
+template<typename K, typename V, size_t capacity = 8192, size_t shard_count = 16> class thread_safe_lru_cache {
+	static_assert(shard_count > 0 && (shard_count & (shard_count - 1)) == 0, "shard_count must be a power of two");
 
-	lru_cache() {};
-	virtual ~lru_cache() {};
+	struct alignas(64) shard {
+		std::mutex mutex;
+		cache_counters counters;
+		lru_cache<K, V, capacity> cache{ (capacity + shard_count - 1) / shard_count };
+	};
+	shard& shard_for(const K& key) {
+		uint64_t h = std::hash<K>{}(key);
+		//term: std::hash can be the identity for integers, mix before taking the low bits
+		h ^= h >> 33;
+		h *= 0xff51afd7ed558ccdull;
+		h ^= h >> 33;
+		return shards_[h & (shard_count - 1)];
+	}
+	std::unique_lock<std::mutex> lock_shard(shard& s) {
+		std::unique_lock<std::mutex> lock(s.mutex, std::try_to_lock);
+		if (!lock.owns_lock()) {
+			auto begin = std::chrono::steady_clock::now();
+			lock.lock();
+			s.counters.add(s.counters.contended_locks);
+			s.counters.add(s.counters.lock_wait_ns, std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - begin).count());
+		}
+		s.counters.add(s.counters.lock_acquisitions);
+		return lock;
+	}
+	void put_l1(shard& s, const K& key, V val) {
+		auto lock = lock_shard(s);
+		size_t before = s.cache.size();
+		if (!s.cache.put(key, std::move(val))) {
+			s.counters.add(s.counters.updates);
+			return;
+		}
+		s.counters.add(s.counters.inserts);
+		if (s.cache.size() == before)
+			s.counters.add(s.counters.evictions);
+	}
+public:
+	thread_safe_lru_cache() {};
+	virtual ~thread_safe_lru_cache() {};
 
-	bool exists(K key) {
-		return data_.find(key) != data_.end();
+	bool exists(const K& key) {
+		shard& s = shard_for(key);
+		auto lock = lock_shard(s);
+		return s.cache.exists(key);
 	}
 
-	V& get(K key) {
-		auto it = data_.find(key);
-		if (it == data_.end())
+	//term: returns a copy, a reference would outlive the shard lock
+	V get(const K& key) {
+		auto v = try_get(key);
+		if (!v)
 			throw std::range_error("no such item in the list");
-		order_iterator_t oit = std::find(order_.begin(), order_.end(), key);
-		order_.splice(order_.begin(), order_, oit);
-		return it->second;
+		return *v;
 	}
 
-	void put(K key, V val) {
-		auto it = data_.find(key);
-		if (it == data_.end()) {
-			data_[key] = val;
+	std::optional<V> try_get(const K& key) {
+		DE2_TRACE_SCOPE("cache", "try_get");
+		shard& s = shard_for(key);
+		{
+			auto lock = lock_shard(s);
+			auto v = s.cache.try_get(key);
+			s.counters.add(v ? s.counters.hits : s.counters.misses);
+			if (v || !l2_)
+				return v;
+		}
+
+		//term: outside the shard lock
+		auto blob = l2_->get(codec_.key(key));
+		std::optional<V> v = blob ? codec_.decode(*blob) : std::nullopt;
+		s.counters.add(v ? s.counters.l2_hits : s.counters.l2_misses);
+		if (v)
+			put_l1(s, key, *v);
+		return v;
+	}
+
+	//term: memory tier only, counts no hit or miss and does not promote
+	std::optional<V> peek(const K& key) {
+		shard& s = shard_for(key);
+		std::unique_lock<std::mutex> lock(s.mutex);
+		return s.cache.peek(key);
+	}
+
+	bool contains(const K& key) {
+		if (exists(key))
+			return true;
+		return l2_ && l2_->contains(codec_.key(key));
+	}
+
+	void put(const K& key, V val) {
+		shard& s = shard_for(key);
+		if (!l2_) {
+			put_l1(s, key, std::move(val));
+			return;
 		}
-		else {
-			order_.remove(key);
+		auto blob = codec_.encode(val);
+		put_l1(s, key, std::move(val));
+		if (blob && l2_->put(codec_.key(key), *blob))
+			s.counters.add(s.counters.l2_writes);
+	}
+
+	//term: attach before the cache is shared between threads; encode returns nullopt for values that stay memory only
+	struct l2_codec {
+		std::function<std::string(const K&)> key;
+		std::function<std::optional<std::vector<unsigned char>>(const V&)> encode;
+		std::function<std::optional<V>(std::span<const unsigned char>)> decode;
+	};
+	void attach_l2(std::shared_ptr<disk_cache> l2, l2_codec codec) {
+		l2_ = l2;
+		codec_ = codec;
+	}
+	std::shared_ptr<disk_cache> l2() { return l2_; }
+
+	bool erase(const K& key) {
+		if (l2_)
+			l2_->erase(codec_.key(key));
+		shard& s = shard_for(key);
+		auto lock = lock_shard(s);
+		bool erased = s.cache.erase(key);
+		if (erased)
+			s.counters.add(s.counters.erases);
+		return erased;
+	}
+
+	//term: runs under the shard lock, must not call back into this cache
+	void set_on_evict(std::function<void(const K&, V&)> f) {
+		for (auto& s : shards_) {
+			std::unique_lock<std::mutex> lock(s.mutex);
+			s.cache.on_evict = f;
 		}
-		order_.push_front(key);
+	}
 
-		if (data_.size() > capacity) {
-			data_.erase(order_.back());
-			order_.pop_back();
+	size_t size() {
+		size_t n = 0;
+		for (auto& s : shards_) {
+			std::unique_lock<std::mutex> lock(s.mutex);
+			n += s.cache.size();
+		}
+		return n;
+	}
+	void clear() {
+		for (auto& s : shards_) {
+			std::unique_lock<std::mutex> lock(s.mutex);
+			s.cache.clear();
 		}
 	}
+
+	cache_stats& stats() { return stats_; }
+	cache_stats::snapshot get_stats() const {
+		cache_stats::snapshot snap = stats_.get_snapshot();
+		for (auto& s : shards_)
+			snap.add(s.counters);
+		return snap;
+	}
+	void reset_stats() {
+		for (auto& s : shards_)
+			s.counters.reset();
+		stats_.reset();
+	}
 protected:
-	std::unordered_map<K, V> data_;
-	std::list<K> order_;
-	std::mutex cache_mutex;
-	//size_t capacity;
+	std::array<shard, shard_count> shards_;
+	cache_stats stats_;
+	std::shared_ptr<disk_cache> l2_;
+	l2_codec codec_;
 };
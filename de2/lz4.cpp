@@ -0,0 +1,113 @@
+#include "pch.h"
+#include "lz4.h"
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+	const size_t min_match = 4;
+	const size_t last_literals = 5;
+	const size_t match_limit = 12;
+	const size_t max_offset = 65535;
+	const int hash_bits = 12;
+
+	uint32_t read32(const uint8_t* p) {
+		uint32_t v;
+		memcpy(&v, p, sizeof(v));
+		return v;
+	}
+	uint32_t hash4(uint32_t v) {
+		return (v * 2654435761u) >> (32 - hash_bits);
+	}
+	void put_length(std::vector<uint8_t>& out, size_t len) {
+		while (len >= 255) {
+			out.push_back(255);
+			len -= 255;
+		}
+		out.push_back((uint8_t)len);
+	}
+	void emit(std::vector<uint8_t>& out, const uint8_t* literals, size_t lit_len, size_t offset, size_t match_len) {
+		size_t ml = match_len ? match_len - min_match : 0;
+		out.push_back((uint8_t)((std::min<size_t>(lit_len, 15) << 4) | std::min<size_t>(ml, 15)));
+		if (lit_len >= 15)
+			put_length(out, lit_len - 15);
+		out.insert(out.end(), literals, literals + lit_len);
+		if (match_len == 0)
+			return;
+		out.push_back((uint8_t)(offset & 0xFF));
+		out.push_back((uint8_t)(offset >> 8));
+		if (ml >= 15)
+			put_length(out, ml - 15);
+	}
+}
+
+std::vector<uint8_t> lz4_compress(const uint8_t* src, size_t size) {
+	std::vector<uint8_t> out;
+	out.reserve(size / 2 + 16);
+	std::vector<int64_t> table(size_t(1) << hash_bits, -1);
+
+	size_t anchor = 0, ip = 0;
+	size_t limit = size > match_limit ? size - match_limit : 0;
+	while (ip < limit) {
+		uint32_t seq = read32(src + ip);
+		uint32_t h = hash4(seq);
+		int64_t ref = table[h];
+		table[h] = (int64_t)ip;
+
+		if (ref < 0 || ip - (size_t)ref > max_offset || read32(src + ref) != seq) {
+			ip++;
+			continue;
+		}
+		size_t len = min_match;
+		while (ip + len < size - last_literals && src[ref + len] == src[ip + len])
+			len++;
+		emit(out, src + anchor, ip - anchor, ip - (size_t)ref, len);
+		ip += len;
+		anchor = ip;
+	}
+	emit(out, src + anchor, size - anchor, 0, 0);
+	return out;
+}
+
+void lz4_decompress(const uint8_t* src, size_t src_size, uint8_t* dst, size_t dst_size) {
+	const uint8_t* ip = src;
+	const uint8_t* iend = src + src_size;
+	size_t op = 0;
+
+	auto read_length = [&](size_t len) {
+		if (len != 15)
+			return len;
+		uint8_t b;
+		do {
+			if (ip >= iend)
+				throw std::runtime_error("lz4: truncated length");
+			b = *ip++;
+			len += b;
+		} while (b == 255);
+		return len;
+	};
+
+	while (ip < iend) {
+		uint8_t token = *ip++;
+		size_t lit = read_length(token >> 4);
+		if (lit > (size_t)(iend - ip) || lit > dst_size - op)
+			throw std::runtime_error("lz4: literal run out of bounds");
+		memcpy(dst + op, ip, lit);
+		ip += lit;
+		op += lit;
+		if (ip == iend)
+			break;
+
+		if (iend - ip < 2)
+			throw std::runtime_error("lz4: truncated offset");
+		size_t offset = ip[0] | (ip[1] << 8);
+		ip += 2;
+		size_t len = read_length(token & 15) + min_match;
+		if (offset == 0 || offset > op || len > dst_size - op)
+			throw std::runtime_error("lz4: match out of bounds");
+		//term: matches may overlap their own output, copy bytewise
+		for (size_t i = 0; i < len; i++, op++)
+			dst[op] = dst[op - offset];
+	}
+	if (op != dst_size)
+		throw std::runtime_error("lz4: size mismatch");
+}
@@ -0,0 +1,10 @@
+#pragma once
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+//term: lz4 block format (no frame header), compatible with LZ4_compress_default / LZ4_decompress_safe
+std::vector<uint8_t> lz4_compress(const uint8_t* src, size_t size);
+//throws when the block is malformed or does not decode to exactly dst_size bytes
+void lz4_decompress(const uint8_t* src, size_t src_size, uint8_t* dst, size_t dst_size);
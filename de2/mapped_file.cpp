@@ -0,0 +1,145 @@
+#include "pch.h"
+#include "mapped_file.h"
+#include <stdexcept>
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+mapped_file::mapped_file(const std::string& path) {
+#ifdef _WIN32
+	HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+		throw std::runtime_error("could not open file: " + path);
+	file_ = file;
+
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(file, &size)) {
+		CloseHandle(file);
+		throw std::runtime_error("could not stat file: " + path);
+	}
+	size_ = (size_t)size.QuadPart;
+	if (size_ == 0)
+		return;
+
+	HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (mapping == NULL) {
+		CloseHandle(file);
+		throw std::runtime_error("could not map file: " + path);
+	}
+	mapping_ = mapping;
+	data_ = (unsigned char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	if (data_ == nullptr) {
+		CloseHandle(mapping);
+		CloseHandle(file);
+		throw std::runtime_error("could not map file: " + path);
+	}
+#else
+	fd_ = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+	if (fd_ < 0)
+		throw std::runtime_error("could not open file: " + path);
+
+	struct stat st;
+	if (fstat(fd_, &st) != 0) {
+		close(fd_);
+		throw std::runtime_error("could not stat file: " + path);
+	}
+	size_ = (size_t)st.st_size;
+	if (size_ == 0)
+		return;
+
+	void* p = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd_, 0);
+	if (p == MAP_FAILED) {
+		close(fd_);
+		throw std::runtime_error("could not map file: " + path);
+	}
+	data_ = (unsigned char*)p;
+#endif
+}
+mapped_file::mapped_file(const std::string& path, size_t size) : size_(size), writable_(true) {
+	if (size == 0)
+		throw std::invalid_argument("mapped_file: writable mapping needs a size");
+#ifdef _WIN32
+	HANDLE file = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, NULL, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_RANDOM_ACCESS, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+		throw std::runtime_error("could not open file: " + path);
+	file_ = file;
+
+	LARGE_INTEGER li;
+	li.QuadPart = (LONGLONG)size;
+	if (!SetFilePointerEx(file, li, NULL, FILE_BEGIN) || !SetEndOfFile(file)) {
+		CloseHandle(file);
+		throw std::runtime_error("could not resize file: " + path);
+	}
+	HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READWRITE, 0, 0, NULL);
+	if (mapping == NULL) {
+		CloseHandle(file);
+		throw std::runtime_error("could not map file: " + path);
+	}
+	mapping_ = mapping;
+	data_ = (unsigned char*)MapViewOfFile(mapping, FILE_MAP_READ | FILE_MAP_WRITE, 0, 0, 0);
+	if (data_ == nullptr) {
+		CloseHandle(mapping);
+		CloseHandle(file);
+		throw std::runtime_error("could not map file: " + path);
+	}
+#else
+	fd_ = open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+	if (fd_ < 0)
+		throw std::runtime_error("could not open file: " + path);
+	if (ftruncate(fd_, (off_t)size) != 0) {
+		close(fd_);
+		throw std::runtime_error("could not resize file: " + path);
+	}
+	void* p = mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+	if (p == MAP_FAILED) {
+		close(fd_);
+		throw std::runtime_error("could not map file: " + path);
+	}
+	data_ = (unsigned char*)p;
+#endif
+}
+mapped_file::~mapped_file() {
+#ifdef _WIN32
+	if (data_ != nullptr)
+		UnmapViewOfFile(data_);
+	if (mapping_ != nullptr)
+		CloseHandle(mapping_);
+	if (file_ != nullptr)
+		CloseHandle(file_);
+#else
+	if (data_ != nullptr)
+		munmap(data_, size_);
+	if (fd_ >= 0)
+		close(fd_);
+#endif
+}
+std::span<const unsigned char> mapped_file::span(size_t offset, size_t size) const {
+	if (offset > size_ || size > size_ - offset)
+		throw std::out_of_range("mapped_file: range outside of file");
+	return { data_ + offset, size };
+}
+unsigned char* mapped_file::writable_data() {
+	if (!writable_)
+		throw std::logic_error("mapped_file: mapping is read-only");
+	return data_;
+}
+void mapped_file::flush(size_t offset, size_t size) {
+	if (!writable_ || size == 0)
+		return;
+	if (offset > size_ || size > size_ - offset)
+		throw std::out_of_range("mapped_file: range outside of file");
+#ifdef _WIN32
+	FlushViewOfFile(data_ + offset, size);
+	FlushFileBuffers((HANDLE)file_);
+#else
+	//term: msync wants a page aligned start
+	size_t page = (size_t)sysconf(_SC_PAGESIZE);
+	size_t begin = offset & ~(page - 1);
+	msync(data_ + begin, offset + size - begin, MS_SYNC);
+#endif
+}
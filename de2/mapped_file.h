@@ -0,0 +1,32 @@
+#pragma once
+
+#include <string>
+#include <cstddef>
+#include <span>
+
+//term: read-only by default, the sized constructor maps it read-write and shared
+class mapped_file {
+	unsigned char* data_{ nullptr };
+	size_t size_{ 0 };
+	bool writable_{ false };
+#ifdef _WIN32
+	void* file_{ nullptr };
+	void* mapping_{ nullptr };
+#else
+	int fd_{ -1 };
+#endif
+public:
+	mapped_file(const std::string& path);
+	mapped_file(const std::string& path, size_t size);
+	~mapped_file();
+	mapped_file(const mapped_file& other) = delete;
+	mapped_file& operator=(const mapped_file& other) = delete;
+
+	const unsigned char* data() const { return data_; }
+	size_t size() const { return size_; }
+	std::span<const unsigned char> span(size_t offset, size_t size) const;
+
+	unsigned char* writable_data();
+	//term: blocks until the range is on disk
+	void flush(size_t offset, size_t size);
+};
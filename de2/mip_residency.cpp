@@ -0,0 +1,172 @@
+#include "pch.h"
+#include "mip_residency.h"
+#include "model.h"
+#include "mipmap.h"
+#include "de2.h"
+#include "tracer.h"
+
+int mip_residency::coarse_level(const texture& t) const {
+	int level = 0;
+	while (level < t.levels_ - 1 && std::max(t.width_ >> level, t.height_ >> level) > initial_size)
+		level++;
+	return level;
+}
+
+//term: one texel per pixel across the footprint, coarser when nothing drew it this frame
+int mip_residency::wanted_level(const texture& t) const {
+	int coarse = coarse_level(t);
+	if (t.requested_frame_ != frame_)
+		return coarse;
+	float texels = (float)std::max(t.width_, t.height_);
+	int level = (int)std::floor(std::log2(texels / std::max(t.requested_pixels_, 1.0f))) + bias;
+	return std::clamp(level, 0, coarse);
+}
+
+bool mip_residency::begin(texture& t) {
+	if (!enabled || t.levels_ < 2 || t.data_ == nullptr)
+		return false;
+	DE2_TRACE_SCOPE("gl", "mip_residency::begin");
+	std::vector<mip_level> levels = mip_levels(t.width_, t.height_, t.comp_);
+	int coarse = coarse_level(t);
+	for (int l = coarse; l < t.levels_; l++)
+		glTexImage2D(GL_TEXTURE_2D, l, texture::pixel_format(t.comp_), levels[l].width, levels[l].height, 0, texture::pixel_format(t.comp_), GL_UNSIGNED_BYTE, t.data_ + levels[l].offset);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, coarse);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, t.levels_ - 1);
+	t.progressive_ = true;
+	t.resident_level_ = coarse;
+	t.needed_level_ = coarse;
+
+	std::unique_lock<std::mutex> lock(mutex_);
+	t.needed_frame_ = frame_;
+	textures_.push_back(&t);
+	stats_.textures++;
+	stats_.resident_bytes += levels.back().offset + levels.back().bytes - levels[coarse].offset;
+	return true;
+}
+
+void mip_residency::remove(texture* t) {
+	std::unique_lock<std::mutex> lock(mutex_);
+	auto it = std::find(textures_.begin(), textures_.end(), t);
+	if (it == textures_.end())
+		return;
+	*it = textures_.back();
+	textures_.pop_back();
+	stats_.textures--;
+	stats_.resident_bytes -= t->gpu_bytes();
+}
+
+void mip_residency::set_view(const glm::mat4& view, const glm::mat4& projection, glm::vec2 viewport) {
+	view_ = view;
+	projection_ = projection;
+	viewport_ = viewport;
+}
+
+float mip_residency::projected_pixels(glm::vec3 center, float radius) const {
+	float distance = -(view_ * glm::vec4(center, 1.0f)).z;
+	//term: the camera is inside the sphere, it may fill the screen
+	if (distance <= radius)
+		return std::max(viewport_.x, viewport_.y);
+	return radius / distance * projection_[1][1] * viewport_.y;
+}
+
+void mip_residency::request(texture& t, const mesh& m, const glm::mat4& model) {
+	request(t, m.bounds_center, m.bounds_radius, model);
+}
+void mip_residency::request(texture& t, glm::vec3 center, float radius, const glm::mat4& model) {
+	if (!t.progressive_)
+		return;
+	glm::vec3 world = model * glm::vec4(center, 1.0f);
+	float scale = std::max({ glm::length(glm::vec3(model[0])), glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2])) });
+	request(t, projected_pixels(world, radius * scale));
+}
+
+void mip_residency::request(texture& t, float pixels) {
+	if (!t.progressive_)
+		return;
+	if (t.requested_frame_ != frame_) {
+		t.requested_frame_ = frame_;
+		t.requested_pixels_ = pixels;
+	}
+	else {
+		t.requested_pixels_ = std::max(t.requested_pixels_, pixels);
+	}
+}
+
+void mip_residency::upload_level(texture& t, int level) {
+	mip_level l = mip_levels(t.width_, t.height_, t.comp_)[level];
+	glBindTexture(GL_TEXTURE_2D, t.vbo_texture);
+	glTexImage2D(GL_TEXTURE_2D, level, texture::pixel_format(t.comp_), l.width, l.height, 0, texture::pixel_format(t.comp_), GL_UNSIGNED_BYTE, t.data_ + l.offset);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, level);
+	t.resident_level_ = level;
+	stats_.uploaded_levels++;
+	stats_.uploaded_bytes += l.bytes;
+	stats_.resident_bytes += l.bytes;
+}
+
+//term: the base level moves first so the texture never samples a level being released
+void mip_residency::drop_to(texture& t, int level) {
+	std::vector<mip_level> levels = mip_levels(t.width_, t.height_, t.comp_);
+	glBindTexture(GL_TEXTURE_2D, t.vbo_texture);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, level);
+	for (int l = t.resident_level_; l < level; l++) {
+		glTexImage2D(GL_TEXTURE_2D, l, texture::pixel_format(t.comp_), 0, 0, 0, texture::pixel_format(t.comp_), GL_UNSIGNED_BYTE, nullptr);
+		stats_.dropped_levels++;
+		stats_.dropped_bytes += levels[l].bytes;
+		stats_.resident_bytes -= levels[l].bytes;
+	}
+	t.resident_level_ = level;
+}
+
+void mip_residency::account(texture& t) {
+	if (!t.cache_key.empty())
+		de2::get_instance().residency_.update(string_id::hashed(t.cache_key), t.cpu_bytes(), t.gpu_bytes());
+}
+
+void mip_residency::update() {
+	std::unique_lock<std::mutex> lock(mutex_);
+	if (textures_.empty()) {
+		frame_++;
+		return;
+	}
+	DE2_TRACE_SCOPE("gl", "mip_residency::update");
+
+	//term: the finest level needed within drop_after_frames is what stays resident
+	std::vector<texture*> finer;
+	for (texture* t : textures_) {
+		int wanted = wanted_level(*t);
+		if (wanted <= t->needed_level_ || frame_ - t->needed_frame_ > drop_after_frames) {
+			t->needed_level_ = wanted;
+			t->needed_frame_ = frame_;
+		}
+		if (t->needed_level_ > t->resident_level_) {
+			drop_to(*t, t->needed_level_);
+			account(*t);
+		}
+		else if (t->needed_level_ < t->resident_level_) {
+			finer.push_back(t);
+		}
+	}
+
+	//term: the textures magnified the most go first, one level per texture and round until the budget is spent
+	auto blur = [](const texture* t) { return t->requested_pixels_ / (float)std::max(t->width_ >> t->resident_level_, t->height_ >> t->resident_level_); };
+	std::sort(finer.begin(), finer.end(), [&](const texture* a, const texture* b) { return blur(a) > blur(b); });
+	uint64_t uploaded_before = stats_.uploaded_bytes;
+	while (!finer.empty()) {
+		for (texture* t : finer) {
+			if (stats_.uploaded_bytes - uploaded_before >= bytes_per_frame)
+				break;
+			upload_level(*t, t->resident_level_ - 1);
+			account(*t);
+		}
+		if (stats_.uploaded_bytes - uploaded_before >= bytes_per_frame)
+			break;
+		std::erase_if(finer, [](const texture* t) { return t->resident_level_ <= t->needed_level_; });
+	}
+	glBindTexture(GL_TEXTURE_2D, 0);
+	frame_++;
+}
+
+mip_residency::counts mip_residency::stats() const {
+	std::unique_lock<std::mutex> lock(mutex_);
+	return stats_;
+}
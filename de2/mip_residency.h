@@ -0,0 +1,58 @@
+#pragma once
+
+#include "glad/glad.h"
+#include <glm/glm.hpp>
+#include <mutex>
+#include <vector>
+#include <cstdint>
+
+class texture;
+class mesh;
+
+//term: the texture keeps its cpu mip chain, levels outside the resident range are clamped off with GL_TEXTURE_BASE_LEVEL
+class mip_residency {
+public:
+	struct counts {
+		uint64_t uploaded_levels{ 0 }, dropped_levels{ 0 }, uploaded_bytes{ 0 }, dropped_bytes{ 0 };
+		size_t textures{ 0 }, resident_bytes{ 0 };
+	};
+
+	mip_residency() = default;
+	mip_residency(const mip_residency& other) = delete;
+	mip_residency& operator=(const mip_residency& other) = delete;
+
+	//term: render thread, with the texture bound
+	bool begin(texture& t);
+	//term: any thread, from the texture's destructor
+	void remove(texture* t);
+
+	void set_view(const glm::mat4& view, const glm::mat4& projection, glm::vec2 viewport);
+	float projected_pixels(glm::vec3 center, float radius) const;
+	//term: render thread, per draw
+	void request(texture& t, const mesh& m, const glm::mat4& model);
+	void request(texture& t, glm::vec3 center, float radius, const glm::mat4& model);
+	void request(texture& t, float pixels);
+	//term: render thread, after the draws
+	void update();
+
+	counts stats() const;
+
+	bool enabled{ false };
+	int initial_size{ 64 };
+	size_t bytes_per_frame{ 16 << 20 };
+	uint64_t drop_after_frames{ 120 };
+	int bias{ 0 };
+protected:
+	int coarse_level(const texture& t) const;
+	int wanted_level(const texture& t) const;
+	void upload_level(texture& t, int level);
+	void drop_to(texture& t, int level);
+	void account(texture& t);
+
+	mutable std::mutex mutex_;
+	std::vector<texture*> textures_;
+	glm::mat4 view_{ 1.0f }, projection_{ 1.0f };
+	glm::vec2 viewport_{ 0, 0 };
+	uint64_t frame_{ 0 };
+	counts stats_;
+};
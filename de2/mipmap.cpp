@@ -0,0 +1,123 @@
+#include "pch.h"
+#include "mipmap.h"
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+#include <new>
+#if defined(_M_X64) || defined(__SSE2__)
+#include <emmintrin.h>
+#define DE2_MIPMAP_SSE2
+#endif
+
+std::vector<mip_level> mip_levels(int width, int height, int comp) {
+	std::vector<mip_level> levels;
+	size_t offset = 0;
+	while (true) {
+		size_t bytes = (size_t)width * height * comp;
+		levels.push_back({ width, height, offset, bytes });
+		offset += bytes;
+		if (width == 1 && height == 1)
+			break;
+		width = std::max(width / 2, 1);
+		height = std::max(height / 2, 1);
+	}
+	return levels;
+}
+
+size_t mip_chain_bytes(int width, int height, int comp) {
+	const mip_level last = mip_levels(width, height, comp).back();
+	return last.offset + last.bytes;
+}
+
+namespace {
+	struct srgb_tables {
+		float to_linear[256];
+		//term: indexed by linear * 4095, fine enough that a round trip of every 8 bit value is exact
+		unsigned char to_srgb[4096];
+
+		srgb_tables() {
+			for (int i = 0; i < 256; i++) {
+				float c = i / 255.0f;
+				to_linear[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+			}
+			for (int i = 0; i < 4096; i++) {
+				float l = i / 4095.0f;
+				float c = l <= 0.0031308f ? l * 12.92f : 1.055f * std::pow(l, 1 / 2.4f) - 0.055f;
+				to_srgb[i] = (unsigned char)std::lround(std::clamp(c, 0.0f, 1.0f) * 255);
+			}
+		}
+	};
+	const srgb_tables& tables() {
+		static const srgb_tables t;
+		return t;
+	}
+
+	void downsample_row(const unsigned char* r0, const unsigned char* r1, int width, int comp, int x_begin, int x_end, unsigned char* dst, bool srgb) {
+		const srgb_tables* t = srgb ? &tables() : nullptr;
+		for (int x = x_begin; x < x_end; x++) {
+			//term: clamped so a one pixel wide level still reads inside the row
+			size_t a = (size_t)std::min(x * 2, width - 1) * comp, b = (size_t)std::min(x * 2 + 1, width - 1) * comp;
+			for (int c = 0; c < comp; c++) {
+				if (t && c < 3) {
+					float l = t->to_linear[r0[a + c]] + t->to_linear[r0[b + c]] + t->to_linear[r1[a + c]] + t->to_linear[r1[b + c]];
+					dst[(size_t)x * comp + c] = t->to_srgb[(int)(l * 0.25f * 4095 + 0.5f)];
+				}
+				else {
+					dst[(size_t)x * comp + c] = (unsigned char)((r0[a + c] + r0[b + c] + r1[a + c] + r1[b + c] + 2) >> 2);
+				}
+			}
+		}
+	}
+
+#ifdef DE2_MIPMAP_SSE2
+	//term: four rgba8 output pixels per iteration, sums in 16 bit lanes; returns the first pixel left for the scalar tail
+	int downsample_row_sse2(const unsigned char* r0, const unsigned char* r1, int out_width, unsigned char* dst) {
+		const __m128i zero = _mm_setzero_si128(), two = _mm_set1_epi16(2);
+		int x = 0;
+		for (; x + 4 <= out_width; x += 4) {
+			__m128i a0 = _mm_loadu_si128((const __m128i*)(r0 + x * 8)), a1 = _mm_loadu_si128((const __m128i*)(r0 + x * 8 + 16));
+			__m128i b0 = _mm_loadu_si128((const __m128i*)(r1 + x * 8)), b1 = _mm_loadu_si128((const __m128i*)(r1 + x * 8 + 16));
+			//term: each sum holds two horizontally adjacent source pixels
+			__m128i s0 = _mm_add_epi16(_mm_unpacklo_epi8(a0, zero), _mm_unpacklo_epi8(b0, zero));
+			__m128i s1 = _mm_add_epi16(_mm_unpackhi_epi8(a0, zero), _mm_unpackhi_epi8(b0, zero));
+			__m128i s2 = _mm_add_epi16(_mm_unpacklo_epi8(a1, zero), _mm_unpacklo_epi8(b1, zero));
+			__m128i s3 = _mm_add_epi16(_mm_unpackhi_epi8(a1, zero), _mm_unpackhi_epi8(b1, zero));
+			__m128i p01 = _mm_add_epi16(_mm_unpacklo_epi64(s0, s1), _mm_unpackhi_epi64(s0, s1));
+			__m128i p23 = _mm_add_epi16(_mm_unpacklo_epi64(s2, s3), _mm_unpackhi_epi64(s2, s3));
+			p01 = _mm_srli_epi16(_mm_add_epi16(p01, two), 2);
+			p23 = _mm_srli_epi16(_mm_add_epi16(p23, two), 2);
+			_mm_storeu_si128((__m128i*)(dst + x * 4), _mm_packus_epi16(p01, p23));
+		}
+		return x;
+	}
+#endif
+}
+
+void downsample(const unsigned char* src, int width, int height, int comp, unsigned char* dst, bool srgb) {
+	const int out_width = std::max(width / 2, 1), out_height = std::max(height / 2, 1);
+	const size_t stride = (size_t)width * comp, out_stride = (size_t)out_width * comp;
+	for (int y = 0; y < out_height; y++) {
+		const unsigned char* r0 = src + stride * std::min(y * 2, height - 1);
+		const unsigned char* r1 = src + stride * std::min(y * 2 + 1, height - 1);
+		unsigned char* out = dst + out_stride * y;
+		int x = 0;
+#ifdef DE2_MIPMAP_SSE2
+		if (comp == 4 && !srgb && width >= 2)
+			x = downsample_row_sse2(r0, r1, out_width, out);
+#endif
+		downsample_row(r0, r1, width, comp, x, out_width, out, srgb);
+	}
+}
+
+unsigned char* append_mip_chain(unsigned char* pixels, int width, int height, int comp, bool srgb, int& levels) {
+	std::vector<mip_level> chain = mip_levels(width, height, comp);
+	const mip_level& last = chain.back();
+	unsigned char* grown = (unsigned char*)realloc(pixels, last.offset + last.bytes);
+	if (grown == nullptr)
+		throw std::bad_alloc();
+	for (size_t i = 1; i < chain.size(); i++)
+		downsample(grown + chain[i - 1].offset, chain[i - 1].width, chain[i - 1].height, comp, grown + chain[i].offset, srgb);
+	levels = (int)chain.size();
+	return grown;
+}
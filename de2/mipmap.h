@@ -0,0 +1,18 @@
+#pragma once
+
+#include <vector>
+#include <cstddef>
+
+struct mip_level {
+	int width{ 0 }, height{ 0 };
+	size_t offset{ 0 }, bytes{ 0 };
+};
+
+std::vector<mip_level> mip_levels(int width, int height, int comp);
+size_t mip_chain_bytes(int width, int height, int comp);
+
+//term: an odd last row or column is dropped
+void downsample(const unsigned char* src, int width, int height, int comp, unsigned char* dst, bool srgb);
+
+//term: reallocs pixels, returns the new pointer and frees nothing on failure
+unsigned char* append_mip_chain(unsigned char* pixels, int width, int height, int comp, bool srgb, int& levels);
@@ -6,6 +6,8 @@
 #include "shader.h"
 #include <stb_image.h>
 #include "de2.h"
+#include "mipmap.h"
+#include "ktx2.h"
 #include <iostream>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
@@ -28,6 +30,27 @@ std::vector<std::string> split(const std::string& s, char delim) {
 	split(s, delim, std::back_inserter(elems));
 	return elems;
 }
+//term: decoded asset blobs are a magic tag followed by raw fields, only ever read back by the same build
+namespace {
+	const uint32_t mesh_blob_tag = 0x3148534d;		//MSH1
+	const uint32_t texture_blob_tag = 0x32584554;	//TEX2
+
+	template<typename T>
+	void append(std::vector<unsigned char>& out, const T* data, size_t count) {
+		const unsigned char* p = (const unsigned char*)data;
+		out.insert(out.end(), p, p + sizeof(T) * count);
+	}
+	template<typename T>
+	bool take(std::span<const unsigned char>& in, T* data, size_t count) {
+		size_t size = sizeof(T) * count;
+		if (in.size() < size)
+			return false;
+		memcpy(data, in.data(), size);
+		in = in.subspan(size);
+		return true;
+	}
+}
+
 std::vector<int> split_i(const std::string& s, char delim) {
 	std::stringstream ss(s);
 	std::string i;
@@ -39,47 +62,269 @@ std::vector<int> split_i(const std::string& s, char delim) {
 }
 
 //TEXTURE
-//texture::texture() {
-//}
+texture::texture() {
+}
 
 texture::texture(const std::string& filename) {
 	path_ = filename;
 	load();
 }
-texture::texture(const std::shared_ptr<std::vector<unsigned char>> data) {
-	data_ = stbi_load_from_memory(data->data(), data->size(), &width_, &height_, &comp_, STBI_rgb_alpha);
+texture::texture(const std::shared_ptr<std::vector<unsigned char>> data) : texture(data->data(), data->size()) {
+}
+texture::texture(const unsigned char* encoded, size_t size) {
+	if (ktx2::is_ktx2({ encoded, size })) {
+		load_ktx2({ encoded, size });
+		return;
+	}
+	data_ = stbi_load_from_memory(encoded, (int)size, &width_, &height_, &comp_, STBI_rgb_alpha);
+	if (data_ == nullptr)
+		throw std::runtime_error("failed to decode image from memory");
+	comp_ = 4;
+	build_mips();
+}
+texture::texture(int width, int height, int comp, const unsigned char* pixels) : width_(width), height_(height), comp_(comp) {
+	//term: stbi_image_free releases with free()
+	size_t size = (size_t)width * height * comp;
+	data_ = (unsigned char*)malloc(size);
+	if (data_ == nullptr)
+		throw std::bad_alloc();
+	memcpy(data_, pixels, size);
+	build_mips();
+}
+texture::texture(decoded_image& img) {
+	adopt(img);
 }
 texture::~texture() {
+	//term: streaming_ is cleared on the render thread under the streamer's lock, ask the streamer instead of reading it here
+	//a cancelled job's name is deleted by the streamer, otherwise it has been handed over to vbo_texture already
+	bool cancelled = de2::get_instance().texture_uploads_.cancel(this);
+	if (progressive_)
+		de2::get_instance().mip_residency_.remove(this);
 	free();
-	glDeleteBuffers(1, &vbo_texture);
+	if (!cancelled && vbo_texture)
+		de2::get_instance().release_gl([name = vbo_texture]() { glDeleteTextures(1, &name); });
 }
 void texture::free() {
 	if (data_ != nullptr)
 		stbi_image_free(data_);
 	data_ = nullptr;
+	levels_ = 1;
 }
 void texture::load() {
+	DE2_TRACE_SCOPE("loader", "texture::load");
+	de2& engine = de2::get_instance();
+	if (auto img = engine.take_prefetched_image(path_)) {
+		adopt(*img);
+		return;
+	}
+	std::string decoded = engine.decoded_key("texture", path_);
+	if (!decoded.empty()) {
+		if (auto blob = engine.decoded_cache_.try_get(decoded); blob && deserialize(**blob))
+			return;
+	}
+
+	//term: ktx2 files are already in their upload form and skip the decoded cache
 	//TODO: crash happens if the image is corrupted
-	data_ = stbi_load(path_.c_str(), &width_, &height_, &comp_, 0);
+	if (auto blob = engine.read_asset(path_)) {
+		if (ktx2::is_ktx2(blob->data)) {
+			load_ktx2(blob->data);
+			return;
+		}
+		data_ = stbi_load_from_memory(blob->data.data(), (int)blob->data.size(), &width_, &height_, &comp_, 0);
+	}
+	else if (std::filesystem::path(path_).extension() == ".ktx2") {
+		std::ifstream f(path_, std::ios::binary);
+		if (!f.is_open())
+			throw std::runtime_error("failed to load image file: " + path_);
+		std::vector<unsigned char> file((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+		load_ktx2(file);
+		return;
+	}
+	else {
+		data_ = stbi_load(path_.c_str(), &width_, &height_, &comp_, 0);
+	}
 	if (data_ == nullptr)
 		throw std::runtime_error("failed to load image file: " + path_);
+	build_mips();
+	if (!decoded.empty())
+		engine.decoded_cache_.put(decoded, std::make_shared<const std::vector<unsigned char>>(serialize()));
+}
+std::vector<unsigned char> texture::serialize() const {
+	std::vector<unsigned char> out;
+	if (data_ == nullptr || compressed_format_)
+		return out;
+	int32_t header[] = { width_, height_, comp_, levels_ };
+	out.reserve(sizeof(texture_blob_tag) + sizeof(header) + pixel_bytes());
+	append(out, &texture_blob_tag, 1);
+	append(out, header, 4);
+	append(out, data_, pixel_bytes());
+	return out;
+}
+bool texture::deserialize(std::span<const unsigned char> blob) {
+	uint32_t tag = 0;
+	int32_t header[4] = {};
+	if (!take(blob, &tag, 1) || tag != texture_blob_tag || !take(blob, header, 4))
+		return false;
+	if (header[0] <= 0 || header[1] <= 0 || header[2] < 1 || header[2] > 4)
+		return false;
+	size_t chain = mip_levels(header[0], header[1], header[2]).size();
+	size_t bytes = header[3] == 1 ? (size_t)header[0] * header[1] * header[2] : mip_chain_bytes(header[0], header[1], header[2]);
+	if ((header[3] != 1 && header[3] != (int32_t)chain) || blob.size() != bytes)
+		return false;
+
+	unsigned char* pixels = (unsigned char*)malloc(blob.size());
+	if (pixels == nullptr)
+		throw std::bad_alloc();
+	memcpy(pixels, blob.data(), blob.size());
+	free();
+	width_ = header[0];
+	height_ = header[1];
+	comp_ = header[2];
+	levels_ = header[3];
+	data_ = pixels;
+	build_mips();
+	return true;
+}
+void texture::load_ktx2(std::span<const unsigned char> file) {
+	DE2_TRACE_SCOPE("loader", "texture::load_ktx2");
+	ktx2::image img = ktx2::parse(file);
+	unsigned char* blocks = (unsigned char*)malloc(img.bytes());
+	if (blocks == nullptr)
+		throw std::bad_alloc();
+	size_t at = 0;
+	for (auto& l : img.levels) {
+		memcpy(blocks + at, l.blocks.data(), l.blocks.size());
+		at += l.blocks.size();
+	}
+	free();
+	width_ = img.width;
+	height_ = img.height;
+	comp_ = img.format == bc_format::bc4 ? 1 : img.format == bc_format::bc5 ? 2 : img.format == bc_format::bc1 ? 3 : 4;
+	levels_ = (int)img.levels.size();
+	compressed_format_ = img.gl_format();
+	block_format_ = img.format;
+	compressed_bytes_ = img.bytes();
+	data_ = blocks;
+}
+void texture::adopt(decoded_image& img) {
+	width_ = img.width;
+	height_ = img.height;
+	comp_ = img.comp;
+	levels_ = img.levels;
+	data_ = img.release();
+	build_mips();
+}
+void texture::build_mips() {
+	if (!cpu_mipmaps || levels_ > 1 || data_ == nullptr || compressed_format_)
+		return;
+	DE2_TRACE_SCOPE("loader", "texture::build_mips");
+	data_ = append_mip_chain(data_, width_, height_, comp_, srgb_mipmaps, levels_);
+}
+GLenum texture::pixel_format(int comp) {
+	static const GLenum formats[] = { GL_RED, GL_RG, GL_RGB, GL_RGBA };
+	if (comp < 1 || comp > 4)
+		throw std::invalid_argument("texture: unsupported channel count " + std::to_string(comp));
+	return formats[comp - 1];
+}
+size_t texture::pixel_bytes() const {
+	if (compressed_format_)
+		return compressed_bytes_;
+	return levels_ > 1 ? mip_chain_bytes(width_, height_, comp_) : (size_t)width_ * height_ * comp_;
 }
 
 void texture::upload() {
-	glGenTextures(1, &vbo_texture);
+	if (vbo_texture || streaming_)
+		return;
+	DE2_TRACE_SCOPE("gl", "texture::upload");
+	//term: rgtc (bc4/bc5) is core since 3.0, s3tc (bc1/bc3) is an extension missing on some drivers
+	if (compressed_format_ && (block_format_ == bc_format::bc1 || block_format_ == bc_format::bc3) && !GLAD_GL_EXT_texture_compression_s3tc)
+		throw std::runtime_error("texture: " + path_ + " is bc1/bc3 compressed but the context has no EXT_texture_compression_s3tc");
+	de2& engine = de2::get_instance();
+	texture_streamer& streamer = engine.texture_uploads_;
+	bool stream = data_ && !compressed_format_ && streamer.streams(width_, height_, comp_);
+	GLenum format = compressed_format_ ? 0 : pixel_format(comp_);
+
+	GLuint name = 0;
+	glGenTextures(1, &name);
 	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, vbo_texture);
+	glBindTexture(GL_TEXTURE_2D, name);
 
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-	glTexImage2D(GL_TEXTURE_2D, 0, comp_ == 3 ? GL_RGB : GL_RGBA, width_, height_, 0, comp_ == 3 ? GL_RGB : GL_RGBA, GL_UNSIGNED_BYTE, data_);
-	glGenerateMipmap(GL_TEXTURE_2D);
+	//term: levels are tightly packed, rgb rows of the small levels are not 4 byte aligned
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	//term: gray and gray+alpha images sample as gray instead of red
+	if (format == GL_RED || format == GL_RG) {
+		const GLint swizzle[] = { GL_RED, GL_RED, GL_RED, format == GL_RG ? GL_GREEN : GL_ONE };
+		glTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_RGBA, swizzle);
+	}
+	//term: block compressed levels go up as stored, a file without mips samples its only level
+	if (compressed_format_) {
+		size_t offset = 0;
+		for (int l = 0; l < levels_; l++) {
+			int w = std::max(width_ >> l, 1), h = std::max(height_ >> l, 1);
+			size_t bytes = bc_level_bytes(w, h, block_format_);
+			glCompressedTexImage2D(GL_TEXTURE_2D, l, compressed_format_, w, h, 0, (GLsizei)bytes, data_ ? data_ + offset : nullptr);
+			offset += bytes;
+		}
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levels_ - 1);
+		vbo_texture = name;
+		free();
+		if (!cache_key.empty())
+			engine.residency_.update(string_id::hashed(cache_key), cpu_bytes(), gpu_bytes());
+		return;
+	}
+	if (engine.mip_residency_.begin(*this)) {
+		vbo_texture = name;
+		if (!cache_key.empty())
+			engine.residency_.update(string_id::hashed(cache_key), cpu_bytes(), gpu_bytes());
+		return;
+	}
+	//term: a streamed texture only gets its storage here, the pixels follow in bands from the staging buffer
+	std::vector<mip_level> levels = mip_levels(width_, height_, comp_);
+	levels.resize(levels_);
+	for (size_t i = 0; i < levels.size(); i++)
+		glTexImage2D(GL_TEXTURE_2D, (GLint)i, format, levels[i].width, levels[i].height, 0, format, GL_UNSIGNED_BYTE, stream || !data_ ? nullptr : data_ + levels[i].offset);
+	if (levels_ > 1)
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levels_ - 1);
+	if (stream) {
+		glBindTexture(GL_TEXTURE_2D, 0);
+		streaming_ = true;
+		streamer.submit(this, name, width_, height_, comp_, levels_, data_);
+		data_ = nullptr;
+		return;
+	}
+	if (levels_ == 1)
+		glGenerateMipmap(GL_TEXTURE_2D);
+	vbo_texture = name;
 
 	free();
+	if (!cache_key.empty())
+		engine.residency_.update(string_id::hashed(cache_key), cpu_bytes(), gpu_bytes());
+}
+void texture::streamed(GLuint name) {
+	vbo_texture = name;
+	streaming_ = false;
+	if (!cache_key.empty())
+		de2::get_instance().residency_.update(string_id::hashed(cache_key), cpu_bytes(), gpu_bytes());
+}
+size_t texture::cpu_bytes() const {
+	return data_ ? pixel_bytes() : 0;
+}
+//term: a full mip chain adds a third on top of the base level
+size_t texture::gpu_bytes() const {
+	if (compressed_format_)
+		return vbo_texture ? compressed_bytes_ : 0;
+	if (progressive_ && vbo_texture)
+		return pixel_bytes() - mip_levels(width_, height_, comp_)[resident_level_].offset;
+	return vbo_texture ? (size_t)width_ * height_ * comp_ * 4 / 3 : 0;
 }
 void texture::activate() {
+	render_stats::frame().texture_binds++;
+	if (gl_capture::recording())
+		gl_capture::bind_texture(0, vbo_texture);
 	glActiveTexture(GL_TEXTURE0);
 	glBindTexture(GL_TEXTURE_2D, vbo_texture);
 }
@@ -102,10 +347,66 @@ mesh::mesh(std::string& mesh_path, bool is_left_handed) {
 }
 mesh::~mesh() {
 	//std::cout << "~mesh -> " << name << std::endl;
-	glDeleteBuffers(1, &vbo_vertices);
-	glDeleteBuffers(1, &ebo_indices);
+	if (vbo_vertices == 0)
+		return;
+	de2::get_instance().release_gl([vbo = vbo_vertices, ebo = ebo_indices]() {
+		GLuint buffers[] = { vbo, ebo };
+		glDeleteBuffers(2, buffers);
+	});
 }
 bool mesh::load_mesh(std::string& mesh_path, bool is_left_handed) {
+	DE2_TRACE_SCOPE("loader", "mesh::load_mesh");
+	name = mesh_path;
+	de2& engine = de2::get_instance();
+	std::string decoded = engine.decoded_key(is_left_handed ? "mesh" : "mesh_rh", mesh_path);
+	if (!decoded.empty()) {
+		if (auto blob = engine.decoded_cache_.try_get(decoded); blob && deserialize(**blob))
+			return true;
+	}
+
+	bool parsed = false;
+	if (auto blob = engine.read_asset(mesh_path)) {
+		asset_streambuf buf(blob->data);
+		std::istream in(&buf);
+		parsed = parse_obj(in, is_left_handed);
+	}
+	else {
+		std::fstream f;
+		f.open(mesh_path, std::fstream::in | std::fstream::binary);
+		if (!f.is_open())
+			throw std::runtime_error("could not open file");
+		parsed = parse_obj(f, is_left_handed);
+	}
+	if (parsed && !decoded.empty())
+		engine.decoded_cache_.put(decoded, std::make_shared<const std::vector<unsigned char>>(serialize()));
+	return parsed;
+}
+std::vector<unsigned char> mesh::serialize() const {
+	std::vector<unsigned char> out;
+	uint64_t counts[] = { vertices.size(), indices.size() };
+	out.reserve(sizeof(mesh_blob_tag) + sizeof(counts) + sizeof(vertex) * vertices.size() + sizeof(int) * indices.size());
+	append(out, &mesh_blob_tag, 1);
+	append(out, counts, 2);
+	append(out, vertices.data(), vertices.size());
+	append(out, indices.data(), indices.size());
+	return out;
+}
+bool mesh::deserialize(std::span<const unsigned char> blob) {
+	uint32_t tag = 0;
+	uint64_t counts[2] = {};
+	if (!take(blob, &tag, 1) || tag != mesh_blob_tag || !take(blob, counts, 2))
+		return false;
+	if (counts[0] > blob.size() / sizeof(vertex) || blob.size() != sizeof(vertex) * counts[0] + sizeof(int) * counts[1])
+		return false;
+
+	vertices.resize((size_t)counts[0]);
+	indices.resize((size_t)counts[1]);
+	take(blob, vertices.data(), vertices.size());
+	take(blob, indices.data(), indices.size());
+	size_of_indices = indices.size();
+	return true;
+}
+bool mesh::parse_obj(std::istream& f, bool is_left_handed) {
 	//TODO: for god sake use assimp
 	std::vector<glm::vec3> vs;
 	std::vector<glm::vec2> vt;
@@ -114,12 +415,6 @@ bool mesh::load_mesh(std::string& mesh_path, bool is_left_handed) {
 	std::vector<vertex> vvx;
 	std::vector<std::string> icombos;
 
-	name = mesh_path;
-	std::fstream f;
-	f.open(mesh_path, std::fstream::in | std::fstream::binary);
-	if (!f.is_open())
-		throw std::runtime_error("could not open file");
-
 	try {
 		std::string line;
 		while (getline(f, line)) {
@@ -169,7 +464,6 @@ bool mesh::load_mesh(std::string& mesh_path, bool is_left_handed) {
 				}
 			}
 		}
-		f.close();
 		for (auto it : mvx) {
 			vertices.push_back(it.second);
 		}
@@ -181,47 +475,72 @@ bool mesh::load_mesh(std::string& mesh_path, bool is_left_handed) {
 		size_of_indices = indices.size();
 	}
 	catch (...) {
-		f.close();
 		return false;
 	}
 
 	return true;
 }
 void mesh::free() {
-	vertices.clear();
-	indices.clear();
+	//term: clear() keeps the capacity, swap it away so the cpu copy is really released
+	std::vector<vertex>().swap(vertices);
+	std::vector<int>().swap(indices);
+}
+size_t mesh::cpu_bytes() const {
+	return vertices.capacity() * sizeof(vertex) + indices.capacity() * sizeof(int);
 }
 bool mesh::upload() {
+	upload_buffers();
+	bind_attributes();
+	return true;
+}
+//term: buffers are created once and can be shared by any number of vaos, no vao needs to be bound
+void mesh::upload_buffers() {
 	if (vbo_vertices)
-		return true;
+		return;
+	DE2_TRACE_SCOPE("gl", "mesh::upload_buffers");
 
 	try {
 		glGenBuffers(1, &vbo_vertices);
 		glGenBuffers(1, &ebo_indices);
 
- 		glBindBuffer(GL_ARRAY_BUFFER, vbo_vertices);
+		glBindBuffer(GL_ARRAY_BUFFER, vbo_vertices);
 		glBufferData(GL_ARRAY_BUFFER, sizeof(vertex) * vertices.size(), vertices.data(), GL_STATIC_DRAW);
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo_indices);
-		glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(int) * indices.size(), indices.data(), GL_STATIC_DRAW);
-
-		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(vertex), (void*)0);
-		glEnableVertexAttribArray(0);
-
-		glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(vertex), (void*)offsetof(vertex, normal));
-		glEnableVertexAttribArray(1);
-
-		glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(vertex), (void*)offsetof(vertex, uv));
-		glEnableVertexAttribArray(2);
-
+		glBindBuffer(GL_ARRAY_BUFFER, ebo_indices);
+		glBufferData(GL_ARRAY_BUFFER, sizeof(int) * indices.size(), indices.data(), GL_STATIC_DRAW);
 		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		uploaded_bytes = sizeof(vertex) * vertices.size() + sizeof(int) * indices.size();
+		if (!vertices.empty()) {
+			glm::vec3 lo = vertices[0].position, hi = lo;
+			for (auto& v : vertices) {
+				lo = glm::min(lo, v.position);
+				hi = glm::max(hi, v.position);
+			}
+			bounds_center = (lo + hi) * 0.5f;
+			bounds_radius = glm::length(hi - lo) * 0.5f;
+		}
 
 		free();
+		if (!cache_key.empty())
+			de2::get_instance().residency_.update(string_id::hashed(cache_key), cpu_bytes(), gpu_bytes());
 	}
 	catch (...) {
 		throw std::runtime_error("failed to load mesh: " + name);
 	}
+}
+void mesh::bind_attributes() {
+	glBindBuffer(GL_ARRAY_BUFFER, vbo_vertices);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo_indices);
 
-	return true;
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(vertex), (void*)0);
+	glEnableVertexAttribArray(0);
+
+	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(vertex), (void*)offsetof(vertex, normal));
+	glEnableVertexAttribArray(1);
+
+	glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(vertex), (void*)offsetof(vertex, uv));
+	glEnableVertexAttribArray(2);
+
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
 }
 
 //POINT LIGHT
@@ -255,25 +574,36 @@ model::~model() {
 	//std::cout << "~model -> " << m->name << std::endl;
 } 
 bool model::upload() {
-	throw std::exception("model::upload not implemented");
+	throw std::runtime_error("model::upload not implemented");
 }
 void model::draw() {
-	throw std::exception("model::upload not implemented");
+	throw std::runtime_error("model::upload not implemented");
 }
 void model::attach_program(std::shared_ptr<program> p) {
 	prg = p;
 }
+size_t model::cpu_bytes() const {
+	return m && m->cache_key.empty() ? m->cpu_bytes() : 0;
+}
+size_t model::gpu_bytes() const {
+	return m && m->cache_key.empty() ? m->gpu_bytes() : 0;
+}
 
 //TEXTURE MODEL
 texture_model::texture_model() {
 
 }
 texture_model::texture_model(std::string mesh_path, std::string texture_path, bool is_left_handed) {
-	m = make_shared<mesh>(mesh_path, is_left_handed);
-	tex = std::make_shared<texture>(texture_path);
+	m = de2::get_instance().load_mesh(mesh_path, is_left_handed);
+	tex = de2::get_instance().load_texture(texture_path);
+}
+texture_model::texture_model(std::shared_ptr<mesh> shared_mesh, std::shared_ptr<texture> shared_texture) {
+	m = shared_mesh;
+	tex = shared_texture;
 }
 texture_model::~texture_model() {
-	//glDeleteVertexArrays(1, &vao);
+	if (vao)
+		de2::get_instance().release_gl([name = vao]() { glDeleteVertexArrays(1, &name); });
 }
 bool texture_model::upload() {
 	//std::cout << "texture_model::upload() -> (" << m->name << ", "<<  vao <<")" << std::endl;
@@ -287,14 +617,32 @@ bool texture_model::upload() {
 	glBindVertexArray(0);
 	return true;
 }
+size_t texture_model::cpu_bytes() const {
+	return model::cpu_bytes() + (tex && tex->cache_key.empty() ? tex->cpu_bytes() : 0);
+}
+size_t texture_model::gpu_bytes() const {
+	return model::gpu_bytes() + (tex && tex->cache_key.empty() ? tex->gpu_bytes() : 0);
+}
 void texture_model::draw() {
 	prg->use();
-	prg->setuniform("model", mat_model);
-	prg->setuniform("material.specular", m->specular);
-	prg->setuniform("material.shininess", m->shininess);
-
+	prg->setuniform("model"_id, mat_model);
+	prg->setuniform("material.specular"_id, m->specular);
+	prg->setuniform("material.shininess"_id, m->shininess);
+
+	render_stats& stats = render_stats::frame();
+	stats.vao_binds++;
+	stats.draw_calls++;
+	stats.triangles += m->size_of_indices / 3;
+	bool capturing = gl_capture::recording();
+	if (capturing)
+		gl_capture::bind_vao(vao);
 	glBindVertexArray(vao);
+	de2::get_instance().mip_residency_.request(*tex, *m, mat_model);
 	tex->activate();
+	if (capturing) {
+		gl_capture::draw_elements(GL_TRIANGLES, (GLsizei)m->size_of_indices, GL_UNSIGNED_INT, 0);
+		gl_capture::bind_vao(0);
+	}
 	glDrawElements(GL_TRIANGLES, m->size_of_indices, GL_UNSIGNED_INT, 0);
 	glBindVertexArray(0);
 }
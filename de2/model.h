@@ -2,7 +2,10 @@
 
 #include "framework.h"
 #include "shader.h"
+#include "bc_encoder.h"
+#include <span>
 
+struct decoded_image;
 
 struct color_vertex {
 	glm::vec3 position;
@@ -21,17 +24,51 @@ protected:
 	int width_{ 0 }, height_{ 0 }, comp_{ 0 };
 	unsigned char* data_{ nullptr };
 	std::string path_;
+	//term: render thread only, set while de2::texture_uploads_ owns the pixels and the name
+	bool streaming_{ false };
+	int levels_{ 1 };
+	//term: progressive textures keep data_ after upload
+	friend class mip_residency;
+	bool progressive_{ false };
+	int resident_level_{ 0 }, needed_level_{ 0 };
+	float requested_pixels_{ 0 };
+	uint64_t requested_frame_{ 0 }, needed_frame_{ 0 };
+
+	GLenum compressed_format_{ 0 };
+	bc_format block_format_{ bc_format::bc1 };
+	size_t compressed_bytes_{ 0 };
+
+	void load_ktx2(std::span<const unsigned char> file);
+	void adopt(decoded_image& img);
+	void build_mips();
+	size_t pixel_bytes() const;
 public:
+	static inline bool cpu_mipmaps{ true };
+	static inline bool srgb_mipmaps{ false };
+	static GLenum pixel_format(int comp);
+
+	texture();
 	texture(const std::string& filename);
 	texture(const std::shared_ptr<std::vector<unsigned char>> data);
+	texture(const unsigned char* encoded, size_t size);
+	texture(int width, int height, int comp, const unsigned char* pixels);
+	texture(decoded_image& img);
 	~texture();
 	//TODO operator overload
 	GLuint vbo_texture{ 0 };
+	std::string cache_key;
 
 	void free();
 	void load();
 	void upload();
+	bool compressed() const { return compressed_format_ != 0; }
+	//term: render thread, under the streamer's lock
+	void streamed(GLuint name);
 	void activate();
+	size_t cpu_bytes() const;
+	size_t gpu_bytes() const;
+	std::vector<unsigned char> serialize() const;
+	bool deserialize(std::span<const unsigned char> blob);
 	void operator=(GLuint val);
 	operator GLuint();
 };
@@ -43,12 +80,23 @@ public:
 	virtual ~mesh();
 	virtual void free();
 	virtual bool upload();
+	void upload_buffers();
+	void bind_attributes();
 	virtual bool load_mesh(std::string& mesh_path, bool is_left_handed);
+	bool parse_obj(std::istream& f, bool is_left_handed);
+	size_t cpu_bytes() const;
+	size_t gpu_bytes() const { return uploaded_bytes; }
+	std::vector<unsigned char> serialize() const;
+	bool deserialize(std::span<const unsigned char> blob);
 
 	std::vector<vertex> vertices;
 	std::vector<int> indices;
+	//term: model space, set by upload_buffers before the vertices are released
+	glm::vec3 bounds_center{ 0, 0, 0 };
+	float bounds_radius{ 0 };
 	std::string name;
-	size_t size_of_indices{ 0 };
+	std::string cache_key;
+	size_t size_of_indices{ 0 }, uploaded_bytes{ 0 };
 	GLuint vbo_vertices{ 0 }, ebo_indices{ 0 };
 	float shininess{ 16.0 };
 	glm::vec3 specular{ 0.5, 0.5, 0.5 };
@@ -86,11 +134,15 @@ public:
 	virtual void draw();
 	virtual bool upload();
 	virtual void attach_program(std::shared_ptr<program> p);
+	//term: shared meshes and textures are accounted on their own
+	virtual size_t cpu_bytes() const;
+	virtual size_t gpu_bytes() const;
 
 	std::shared_ptr<program> prg;
 	std::shared_ptr<mesh> m;
 	GLuint vao{ 0 };
 	glm::mat4 mat_model;
+	string_id cache_key;
 };
 
 
@@ -98,10 +150,13 @@ class texture_model : public model {
 public:
 	texture_model();
 	texture_model(std::string mesh_path, std::string texture_path, bool is_left_handed = true);
+	texture_model(std::shared_ptr<mesh> shared_mesh, std::shared_ptr<texture> shared_texture);
 	~texture_model() override;
 
 	void draw() override;
 	bool upload() override;
+	size_t cpu_bytes() const override;
+	size_t gpu_bytes() const override;
 
 	std::string path_;
 	std::shared_ptr<texture> tex;
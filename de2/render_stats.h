@@ -0,0 +1,26 @@
+#pragma once
+
+#include <string>
+#include <cstdint>
+#include <sstream>
+
+//term: render thread only, de2::run resets it when a frame starts
+struct render_stats {
+	uint64_t draw_calls{ 0 }, triangles{ 0 };
+	uint64_t program_binds{ 0 }, vao_binds{ 0 }, texture_binds{ 0 }, uniform_uploads{ 0 };
+
+	uint64_t state_changes() const { return program_binds + vao_binds + texture_binds; }
+	void reset() { *this = render_stats(); }
+	std::string to_json() const {
+		std::ostringstream o;
+		o << "{\"draw_calls\":" << draw_calls << ",\"triangles\":" << triangles << ",\"program_binds\":" << program_binds
+			<< ",\"vao_binds\":" << vao_binds << ",\"texture_binds\":" << texture_binds << ",\"uniform_uploads\":" << uniform_uploads
+			<< ",\"state_changes\":" << state_changes() << "}";
+		return o.str();
+	}
+
+	static render_stats& frame() {
+		static render_stats s;
+		return s;
+	}
+};
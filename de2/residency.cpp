@@ -0,0 +1,127 @@
+#include "pch.h"
+#include "residency.h"
+
+//GL DELETION QUEUE
+void gl_deletion_queue::release(std::function<void()> f) {
+	if (on_owner_thread()) {
+		f();
+		return;
+	}
+	std::unique_lock<std::mutex> lock(mutex_);
+	queue_.push_back(std::move(f));
+}
+size_t gl_deletion_queue::drain() {
+	std::vector<std::function<void()>> work;
+	{
+		std::unique_lock<std::mutex> lock(mutex_);
+		work.swap(queue_);
+	}
+	for (auto& f : work)
+		f();
+	return work.size();
+}
+size_t gl_deletion_queue::pending() {
+	std::unique_lock<std::mutex> lock(mutex_);
+	return queue_.size();
+}
+
+
+//RESIDENCY MANAGER
+void residency_manager::set_budget(size_t cpu_bytes, size_t gpu_bytes) {
+	std::unique_lock<std::mutex> lock(mutex_);
+	cpu_budget_ = cpu_bytes;
+	gpu_budget_ = gpu_bytes;
+}
+void residency_manager::track(string_id key, size_t cpu_bytes, size_t gpu_bytes, evict_callback on_evict, cache_stats* owner) {
+	std::unique_lock<std::mutex> lock(mutex_);
+	auto it = entries_.find(key);
+	if (it != entries_.end())
+		remove(it->second);
+
+	order_.push_front({ key, cpu_bytes, gpu_bytes, frame_, std::move(on_evict), owner });
+	entries_[key] = order_.begin();
+	add(order_.front());
+}
+void residency_manager::update(string_id key, size_t cpu_bytes, size_t gpu_bytes) {
+	std::unique_lock<std::mutex> lock(mutex_);
+	auto it = entries_.find(key);
+	if (it == entries_.end())
+		return;
+	entry& e = *it->second;
+	subtract(e);
+	e.cpu_bytes = cpu_bytes;
+	e.gpu_bytes = gpu_bytes;
+	add(e);
+}
+void residency_manager::touch(string_id key) {
+	std::unique_lock<std::mutex> lock(mutex_);
+	auto it = entries_.find(key);
+	if (it == entries_.end())
+		return;
+	it->second->frame = frame_;
+	order_.splice(order_.begin(), order_, it->second);
+}
+void residency_manager::untrack(string_id key) {
+	std::unique_lock<std::mutex> lock(mutex_);
+	auto it = entries_.find(key);
+	if (it != entries_.end())
+		remove(it->second);
+}
+void residency_manager::remove(std::list<entry>::iterator it) {
+	subtract(*it);
+	entries_.erase(it->key);
+	order_.erase(it);
+}
+void residency_manager::next_frame() {
+	std::unique_lock<std::mutex> lock(mutex_);
+	frame_++;
+}
+size_t residency_manager::enforce() {
+	std::list<entry> victims;
+	{
+		std::unique_lock<std::mutex> lock(mutex_);
+		while (over_budget()) {
+			bool gpu_pressure = gpu_bytes_ > gpu_budget_;
+			auto victim = order_.end();
+			size_t scanned = 0;
+			for (auto r = order_.rbegin(); r != order_.rend() && scanned < eviction_window; ++r, ++scanned) {
+				//term: everything in front of an entry used this frame is newer, nothing left to evict
+				if (r->frame == frame_)
+					break;
+				size_t cost = gpu_pressure ? r->gpu_bytes : r->cpu_bytes;
+				if (victim == order_.end() || cost > (gpu_pressure ? victim->gpu_bytes : victim->cpu_bytes))
+					victim = std::prev(r.base());
+			}
+			if (victim == order_.end())
+				break;
+			subtract(*victim);
+			entries_.erase(victim->key);
+			victims.splice(victims.end(), order_, victim);
+		}
+	}
+
+	//term: callbacks run without the lock, they usually take the owning cache's lock which may call back into untrack
+	size_t evicted = 0;
+	for (auto& v : victims) {
+		if (v.on_evict && v.on_evict()) {
+			std::unique_lock<std::mutex> lock(mutex_);
+			evictions_++;
+			evicted_bytes_ += v.cpu_bytes + v.gpu_bytes;
+			evicted++;
+			continue;
+		}
+		//term: still referenced, keep accounting for it and leave it alone for the rest of this frame
+		std::unique_lock<std::mutex> lock(mutex_);
+		if (entries_.contains(v.key))
+			continue;
+		v.frame = frame_;
+		add(v);
+		order_.push_front(std::move(v));
+		entries_[order_.front().key] = order_.begin();
+	}
+	return evicted;
+}
+residency_manager::stats residency_manager::get_stats() {
+	std::unique_lock<std::mutex> lock(mutex_);
+	return { cpu_bytes_, gpu_bytes_, cpu_budget_, gpu_budget_, entries_.size(), evictions_, evicted_bytes_ };
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include "framework.h"
+#include "cache_stats.h"
+#include "string_id.h"
+#include <thread>
+
+//term: gl objects may only be deleted on the thread that owns the context, releases from other threads wait for drain()
+class gl_deletion_queue {
+public:
+	void set_owner_thread() { owner_ = std::this_thread::get_id(); }
+	bool on_owner_thread() const { return owner_ == std::this_thread::get_id(); }
+
+	void release(std::function<void()> f);
+	size_t drain();
+	size_t pending();
+protected:
+	std::thread::id owner_{ std::this_thread::get_id() };
+	std::vector<std::function<void()>> queue_;
+	std::mutex mutex_;
+};
+
+//term: the victim is the biggest entry within the oldest eviction_window in the over budget domain
+class residency_manager {
+public:
+	//term: runs without the manager's lock; false when the resource is still referenced elsewhere
+	using evict_callback = std::function<bool()>;
+
+	struct stats {
+		size_t cpu_bytes{ 0 }, gpu_bytes{ 0 };
+		size_t cpu_budget{ 0 }, gpu_budget{ 0 };
+		size_t entries{ 0 }, evictions{ 0 }, evicted_bytes{ 0 };
+	};
+
+	void set_budget(size_t cpu_bytes, size_t gpu_bytes);
+	//term: owner's resident_bytes follows this entry
+	void track(string_id key, size_t cpu_bytes, size_t gpu_bytes, evict_callback on_evict, cache_stats* owner = nullptr);
+	void update(string_id key, size_t cpu_bytes, size_t gpu_bytes);
+	void touch(string_id key);
+	void untrack(string_id key);
+
+	//term: entries touched in the current frame are never evicted
+	void next_frame();
+	size_t enforce();
+	stats get_stats();
+
+	size_t eviction_window{ 8 };
+protected:
+	struct entry {
+		string_id key;
+		size_t cpu_bytes{ 0 }, gpu_bytes{ 0 };
+		uint64_t frame{ 0 };
+		evict_callback on_evict;
+		cache_stats* owner{ nullptr };
+	};
+	std::list<entry> order_;
+	std::unordered_map<string_id, std::list<entry>::iterator> entries_;
+	size_t cpu_bytes_{ 0 }, gpu_bytes_{ 0 };
+	size_t cpu_budget_{ SIZE_MAX }, gpu_budget_{ SIZE_MAX };
+	size_t evictions_{ 0 }, evicted_bytes_{ 0 };
+	uint64_t frame_{ 0 };
+	std::mutex mutex_;
+
+	bool over_budget() const { return cpu_bytes_ > cpu_budget_ || gpu_bytes_ > gpu_budget_; }
+	void add(entry& e) {
+		cpu_bytes_ += e.cpu_bytes;
+		gpu_bytes_ += e.gpu_bytes;
+		if (e.owner)
+			e.owner->resident_bytes.fetch_add((int64_t)(e.cpu_bytes + e.gpu_bytes), std::memory_order_relaxed);
+	}
+	void subtract(entry& e) {
+		cpu_bytes_ -= e.cpu_bytes;
+		gpu_bytes_ -= e.gpu_bytes;
+		if (e.owner)
+			e.owner->resident_bytes.fetch_sub((int64_t)(e.cpu_bytes + e.gpu_bytes), std::memory_order_relaxed);
+	}
+	void remove(std::list<entry>::iterator it);
+};
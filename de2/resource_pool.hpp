@@ -0,0 +1,103 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <utility>
+#include <stdexcept>
+
+//term: stale handles resolve to nullptr instead of a recycled resource
+template<typename Tag> struct handle {
+	static constexpr uint32_t index_bits = 20;
+	static constexpr uint32_t index_mask = (1u << index_bits) - 1;
+	static constexpr uint32_t generation_mask = (1u << (32 - index_bits)) - 1;
+
+	uint32_t value{ 0 };
+
+	uint32_t index() const { return value & index_mask; }
+	uint32_t generation() const { return value >> index_bits; }
+	//term: generations start at 1, the zero handle is never valid
+	explicit operator bool() const { return value != 0; }
+	bool operator==(const handle& other) const { return value == other.value; }
+	bool operator!=(const handle& other) const { return value != other.value; }
+
+	static handle make(uint32_t index, uint32_t generation) { return { (generation << index_bits) | (index & index_mask) }; }
+};
+
+//term: render thread only; release swaps the last element into the hole, so iteration order is not stable
+template<typename T, typename Tag = T> class resource_pool {
+public:
+	using handle_t = handle<Tag>;
+
+	template<typename... Args>
+	handle_t emplace(Args&&... args) {
+		uint32_t index;
+		if (!free_slots_.empty()) {
+			index = free_slots_.back();
+			free_slots_.pop_back();
+		}
+		else {
+			if (slots_.size() > handle_t::index_mask)
+				throw std::length_error("resource_pool: out of handles");
+			index = (uint32_t)slots_.size();
+			slots_.push_back({ 0, 1 });
+		}
+		dense_.emplace_back(std::forward<Args>(args)...);
+		dense_slots_.push_back(index);
+		slots_[index].dense = (uint32_t)dense_.size() - 1;
+		return handle_t::make(index, slots_[index].generation);
+	}
+
+	bool release(handle_t h) {
+		if (!valid(h))
+			return false;
+		slot& s = slots_[h.index()];
+		uint32_t hole = s.dense, last = (uint32_t)dense_.size() - 1;
+		if (hole != last) {
+			dense_[hole] = std::move(dense_[last]);
+			dense_slots_[hole] = dense_slots_[last];
+			slots_[dense_slots_[hole]].dense = hole;
+		}
+		dense_.pop_back();
+		dense_slots_.pop_back();
+
+		s.generation = (s.generation + 1) & handle_t::generation_mask;
+		if (s.generation == 0)
+			s.generation = 1;
+		free_slots_.push_back(h.index());
+		return true;
+	}
+
+	bool valid(handle_t h) const {
+		return h && h.index() < slots_.size() && slots_[h.index()].generation == h.generation() && slots_[h.index()].dense < dense_.size()
+			&& dense_slots_[slots_[h.index()].dense] == h.index();
+	}
+	T* get(handle_t h) {
+		return valid(h) ? &dense_[slots_[h.index()].dense] : nullptr;
+	}
+	const T* get(handle_t h) const {
+		return valid(h) ? &dense_[slots_[h.index()].dense] : nullptr;
+	}
+	handle_t handle_at(size_t dense_index) const {
+		uint32_t index = dense_slots_[dense_index];
+		return handle_t::make(index, slots_[index].generation);
+	}
+
+	size_t size() const { return dense_.size(); }
+	bool empty() const { return dense_.empty(); }
+	void clear() {
+		while (!dense_.empty())
+			release(handle_at(dense_.size() - 1));
+	}
+	typename std::vector<T>::iterator begin() { return dense_.begin(); }
+	typename std::vector<T>::iterator end() { return dense_.end(); }
+
+protected:
+	struct slot {
+		uint32_t dense;
+		uint32_t generation;
+	};
+	std::vector<T> dense_;
+	std::vector<uint32_t> dense_slots_;
+	std::vector<slot> slots_;
+	std::vector<uint32_t> free_slots_;
+};
@@ -0,0 +1,156 @@
+#include "pch.h"
+#include "scene_loader.h"
+#include "json.h"
+#include "model.h"
+#include <fstream>
+
+namespace {
+	glm::vec3 read_vec3(const json_value& v, float def) {
+		return { (float)v[0].as_number(def), (float)v[1].as_number(def), (float)v[2].as_number(def) };
+	}
+	glm::mat4 read_transform(const json_value& e) {
+		glm::vec3 rotation = glm::radians(read_vec3(e["rotation"], 0));
+		return glm::translate(glm::mat4(1.0f), read_vec3(e["position"], 0))
+			* glm::eulerAngleXYZ(rotation.x, rotation.y, rotation.z)
+			* glm::scale(glm::mat4(1.0f), read_vec3(e["scale"], 1));
+	}
+	std::string as_text(asset_blob blob) {
+		return std::string((const char*)blob.data.data(), blob.data.size());
+	}
+}
+
+scene_loader::scene scene_loader::load(const std::string& manifest_path, ecs_s::registry& world) {
+	std::string text;
+	if (auto blob = de2::get_instance().read_asset(manifest_path)) {
+		text = as_text(*blob);
+	}
+	else {
+		std::ifstream f(manifest_path, std::ios::binary);
+		if (!f.is_open())
+			throw std::runtime_error("could not open scene manifest: " + manifest_path);
+		text.assign(std::istreambuf_iterator<char>(f), std::istreambuf_iterator<char>());
+	}
+	return load(json_value::parse(text), world);
+}
+
+scene_loader::scene scene_loader::load(const json_value& manifest, ecs_s::registry& world) {
+	de2& engine = de2::get_instance();
+	scene s;
+
+	//term: the manifest is validated before anything loads, a bad entity must not leave half a scene in world or de2::programs
+	std::unordered_set<std::string> model_keys, program_names;
+	for (auto& m : manifest["models"].items()) {
+		if (m["mesh"].as_string().empty() || m["texture"].as_string().empty())
+			throw std::runtime_error("scene: model '" + m["key"].as_string() + "' needs a mesh and a texture");
+		model_keys.insert(m["key"].as_string());
+	}
+	for (auto& p : manifest["programs"].items())
+		program_names.insert(p["name"].as_string());
+	for (auto& e : manifest["entities"].items()) {
+		if (!model_keys.contains(e["model"].as_string()))
+			throw std::runtime_error("scene: unknown model '" + e["model"].as_string() + "'");
+		//term: texture_model draws through its program, an entity without one would crash the first frame
+		if (!e.has("program"))
+			throw std::runtime_error("scene: entity without program");
+		const std::string& name = e["program"].as_string();
+		if (!program_names.contains(name) && !engine.programs.contains(name))
+			throw std::runtime_error("scene: unknown program '" + name + "'");
+	}
+
+	//term: fan out, every unique source is requested once and parsed/decoded on the pool
+	struct program_sources {
+		std::string name;
+		std::future<std::string> vertex, fragment;
+	};
+	std::vector<program_sources> pending_programs;
+	for (auto& p : manifest["programs"].items()) {
+		const std::string& name = p["name"].as_string();
+		if (std::any_of(pending_programs.begin(), pending_programs.end(), [&](const program_sources& ps) { return ps.name == name; }))
+			continue;
+		pending_programs.push_back({ name, engine.read_asset_async(p["vertex"].as_string(), as_text), engine.read_asset_async(p["fragment"].as_string(), as_text) });
+	}
+
+	struct model_spec {
+		std::string mesh_key, texture_key;
+	};
+	std::unordered_map<std::string, model_spec> models;
+	std::vector<std::pair<std::string, std::future<std::shared_ptr<mesh>>>> pending_meshes;
+	std::vector<std::pair<std::string, std::future<std::shared_ptr<texture>>>> pending_textures;
+	std::unordered_set<std::string> requested;
+	for (auto& m : manifest["models"].items()) {
+		const std::string& mesh_path = m["mesh"].as_string();
+		const std::string& texture_path = m["texture"].as_string();
+		bool is_left_handed = m["left_handed"].as_bool(true);
+
+		//term: resources already shared through the engine caches are reused, not decoded again
+		std::string mesh_key = de2::mesh_key(mesh_path, is_left_handed);
+		std::string texture_key = de2::texture_key(texture_path);
+		if (requested.insert(mesh_key).second) {
+			if (auto cached = engine.mesh_cache_.try_get(mesh_key))
+				s.meshes[mesh_key] = *cached;
+			else
+				pending_meshes.emplace_back(mesh_key, engine.load_mesh_async(mesh_path, is_left_handed));
+		}
+		if (requested.insert(texture_key).second) {
+			if (auto cached = engine.texture_cache_.try_get(texture_key))
+				s.textures[texture_key] = *cached;
+			else
+				pending_textures.emplace_back(texture_key, engine.load_texture_async(texture_path));
+		}
+		models[m["key"].as_string()] = { mesh_key, texture_key };
+	}
+
+	//term: gpu work stays on this thread, each resource is uploaded as soon as its decode is done
+	for (auto& p : pending_programs) {
+		auto prg = std::make_shared<program>();
+		vertex_shader vs;
+		vs.compile(p.vertex.get());
+		frag_shader fs;
+		fs.compile(p.fragment.get());
+		prg->attach_shader(vs);
+		prg->attach_shader(fs);
+		prg->link();
+		prg->name = p.name;
+		s.programs[p.name] = prg;
+	}
+	for (auto& [key, f] : pending_meshes) {
+		auto m = engine.share_mesh(key, f.get());
+		m->upload_buffers();
+		s.meshes[key] = m;
+	}
+	for (auto& [key, f] : pending_textures) {
+		auto t = engine.share_texture(key, f.get());
+		t->upload();
+		s.textures[key] = t;
+	}
+
+	//term: one model instance per entity so transforms stay per entity, the gpu buffers are shared
+	//all of them are built before the first entity is created or a program is published
+	auto& list = manifest["entities"].items();
+	std::vector<std::shared_ptr<texture_model>> instances;
+	instances.reserve(list.size());
+	for (auto& e : list) {
+		const model_spec& spec = models.at(e["model"].as_string());
+		auto md = std::make_shared<texture_model>(s.meshes[spec.mesh_key], s.textures[spec.texture_key]);
+		md->upload();
+		md->mat_model = read_transform(e);
+		auto prg = s.programs.find(e["program"].as_string());
+		md->attach_program(prg != s.programs.end() ? prg->second : engine.programs.at(e["program"].as_string()));
+		instances.push_back(md);
+	}
+
+	for (auto& [name, prg] : s.programs)
+		engine.programs[name] = prg;
+	s.entities.reserve(list.size());
+	s.models.reserve(list.size());
+	for (size_t i = 0; i < list.size(); i++) {
+		ecs_s::entity ent = world.new_entity();
+		model_handle h = engine.add_model(instances[i]);
+		world.add_component(ent, h);
+		s.models.push_back(h);
+		if (list[i]["visible"].as_bool(true))
+			world.add_component(ent, visible{});
+		s.entities.push_back(ent);
+	}
+	return s;
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include "framework.h"
+#include "de2.h"
+
+class json_value;
+
+//term: manifest:
+//{
+//	"programs": [ { "name": "c_t_direct", "vertex": "shaders/c_t_direct.vert", "fragment": "shaders/c_t_direct.frag" } ],
+//	"models": [ { "key": "earth", "mesh": "models/earthn.obj", "texture": "textures/earth.bmp", "left_handed": true } ],
+//	"entities": [ { "model": "earth", "program": "c_t_direct", "visible": true,
+//		"position": [0, 0, 0], "rotation": [0, 90, 0], "scale": [1, 1, 1] } ]
+//}
+//an entity needs "model" and "program", the rest is optional
+class scene_loader {
+public:
+	struct scene {
+		std::vector<ecs_s::entity> entities;
+		//term: release them with de2::release_model when the scene is unloaded
+		std::vector<model_handle> models;
+		std::unordered_map<std::string, std::shared_ptr<program>> programs;
+		std::unordered_map<std::string, std::shared_ptr<mesh>> meshes;
+		std::unordered_map<std::string, std::shared_ptr<texture>> textures;
+	};
+
+	//term: render thread; nothing is created or registered in de2::programs unless the whole scene loads
+	static scene load(const std::string& manifest_path, ecs_s::registry& world);
+	static scene load(const json_value& manifest, ecs_s::registry& world);
+};
@@ -1,6 +1,9 @@
 #include "pch.h"
 #include "framework.h"
 #include "shader.h"
+#include "de2.h"
+#include "render_stats.h"
+#include "gl_capture.h"
 
 
 shader::shader(GLenum shader_type)
@@ -10,6 +13,11 @@ shader::shader(GLenum shader_type)
 
 shader::shader(GLenum shader_type, std::string filepath) : shader(shader_type)
 {
+	if (auto blob = de2::get_instance().read_asset(filepath)) {
+		compile((const char*)blob->data.data(), blob->data.size());
+		return;
+	}
+
 	std::fstream f;
 	f.open(filepath, std::fstream::in | std::fstream::binary);
 	if (!f.is_open())
@@ -33,12 +41,18 @@ shader::~shader()
 
 void shader::compile(const std::string& source)
 {
-	if (source.length() < 1)
+	compile(source.c_str(), source.length());
+}
+
+void shader::compile(const char* source, size_t length)
+{
+	if (length < 1)
 		return;
 
-	const GLchar* src = static_cast<const GLchar*>(source.c_str());
+	const GLchar* src = static_cast<const GLchar*>(source);
+	GLint len = (GLint)length;
 
-	glShaderSource(id, 1, &src, 0);
+	glShaderSource(id, 1, &src, &len);
 	glCompileShader(id);
 
 	GLint shader_compiled;
@@ -48,7 +62,7 @@ void shader::compile(const std::string& source)
 		GLsizei log_length = 0;
 		GLchar message[1024];
 		glGetProgramInfoLog(id, 1024, &log_length, message);
-		throw std::exception(std::string(message, log_length).c_str());
+		throw std::runtime_error(std::string(message, log_length));
 	}
 }
 
@@ -121,6 +135,10 @@ void program::attach_shader(shader& s)
 
 void program::link()
 {
+	DE2_TRACE_SCOPE("gl", "program::link");
+	//term: lets gl_capture snapshot the linked program, program binaries need gl 4.1 or ARB_get_program_binary
+	if (GLAD_GL_VERSION_4_1 || GLAD_GL_ARB_get_program_binary)
+		glProgramParameteri(id, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
 	glLinkProgram(id);
 
 	GLint program_linked;
@@ -130,7 +148,7 @@ void program::link()
 		GLsizei log_length = 0;
 		GLchar message[1024];
 		glGetProgramInfoLog(id, 1024, &log_length, message);
-		throw std::exception(std::string(message, log_length).c_str());
+		throw std::runtime_error(std::string(message, log_length));
 	}
 
 }
@@ -139,6 +157,9 @@ GLuint program::get_id(){
 	return id;
 }
 void program::use() {
+	render_stats::frame().program_binds++;
+	if (gl_capture::recording())
+		gl_capture::use_program(id);
 	glUseProgram(id);
 }
 
@@ -147,18 +168,67 @@ void program::operator=(GLuint val){
 }
 
 
-void program::setuniform(const std::string& name, GLint v){
-	glUniform1i(glGetUniformLocation(id, name.c_str()), v);
+//term: glProgramUniform needs gl 4.1 or ARB_separate_shader_objects, a plain 3.3 context binds the program and uses glUniform
+bool program::direct_uniforms() {
+	return GLAD_GL_VERSION_4_1 || GLAD_GL_ARB_separate_shader_objects;
+}
+
+GLint program::uniform_location(string_id name) {
+	auto it = uniform_locations_.find(name);
+	if (it != uniform_locations_.end())
+		return it->second;
+	string_id::check(name);
+	return uniform_locations_[name] = glGetUniformLocation(id, name.c_str());
+}
+
+void program::setuniform(string_id name, GLint v){
+	render_stats::frame().uniform_uploads++;
+	GLint location = uniform_location(name);
+	if (gl_capture::recording())
+		gl_capture::uniform(id, location, v);
+	if (direct_uniforms()) {
+		glProgramUniform1i(id, location, v);
+		return;
+	}
+	glUseProgram(id);
+	glUniform1i(location, v);
 }
 
-void program::setuniform(const std::string& name, GLfloat v){
-	glUniform1f(glGetUniformLocation(id, name.c_str()), v);
+void program::setuniform(string_id name, GLfloat v){
+	render_stats::frame().uniform_uploads++;
+	GLint location = uniform_location(name);
+	if (gl_capture::recording())
+		gl_capture::uniform(id, location, v);
+	if (direct_uniforms()) {
+		glProgramUniform1f(id, location, v);
+		return;
+	}
+	glUseProgram(id);
+	glUniform1f(location, v);
 }
 
-void program::setuniform(const std::string& name, const glm::vec3& v){
-	glUniform3fv(glGetUniformLocation(id, name.c_str()), 1, &v[0]);
+void program::setuniform(string_id name, const glm::vec3& v){
+	render_stats::frame().uniform_uploads++;
+	GLint location = uniform_location(name);
+	if (gl_capture::recording())
+		gl_capture::uniform(id, location, v);
+	if (direct_uniforms()) {
+		glProgramUniform3fv(id, location, 1, &v[0]);
+		return;
+	}
+	glUseProgram(id);
+	glUniform3fv(location, 1, &v[0]);
 }
 
-void program::setuniform(const std::string& name, const glm::mat4& v){
-	glUniformMatrix4fv(glGetUniformLocation(id, name.c_str()), 1, GL_FALSE, &v[0][0]);
+void program::setuniform(string_id name, const glm::mat4& v){
+	render_stats::frame().uniform_uploads++;
+	GLint location = uniform_location(name);
+	if (gl_capture::recording())
+		gl_capture::uniform(id, location, v);
+	if (direct_uniforms()) {
+		glProgramUniformMatrix4fv(id, location, 1, GL_FALSE, &v[0][0]);
+		return;
+	}
+	glUseProgram(id);
+	glUniformMatrix4fv(location, 1, GL_FALSE, &v[0][0]);
 }
\ No newline at end of file
@@ -1,6 +1,8 @@
 #pragma once
 #include "glad/glad.h"
 #include <string>
+#include <unordered_map>
+#include "string_id.h"
 #include "GLFW/glfw3.h"
 #include "glm/glm.hpp"
 #include "glm/gtc/type_ptr.hpp"
@@ -19,6 +21,7 @@ public:
 
 
 	virtual void compile(const std::string& source);
+	virtual void compile(const char* source, size_t length);
 	operator GLuint() { return id; }
 	void operator=(GLuint);
 };
@@ -38,6 +41,7 @@ class program
 {
 protected:
 	GLuint id;
+	std::unordered_map<string_id, GLint> uniform_locations_;
 	
 public:
 	program();
@@ -47,12 +51,15 @@ public:
 	void attach_shader(shader& s);
 	void link();
 	void use();
+	static bool direct_uniforms();
 	GLuint get_id();
 
-	void setuniform(const std::string& name, GLfloat v);
-	void setuniform(const std::string& name, GLint v);
-	void setuniform(const std::string& name, const glm::vec3& v);
-	void setuniform(const std::string& name, const glm::mat4& v);
+	GLint uniform_location(string_id name);
+	//term: leaves the program bound when glProgramUniform is unavailable
+	void setuniform(string_id name, GLfloat v);
+	void setuniform(string_id name, GLint v);
+	void setuniform(string_id name, const glm::vec3& v);
+	void setuniform(string_id name, const glm::mat4& v);
 
 	operator GLuint() { return id; }
 	void operator=(GLuint);
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <future>
+#include <mutex>
+#include <memory>
+#include <unordered_map>
+
+template<typename K, typename V> class single_flight {
+public:
+	//term: true for the leader, which must finish the flight with complete() or fail()
+	std::pair<std::shared_future<V>, bool> join(const K& key) {
+		std::unique_lock<std::mutex> lock(mutex_);
+		auto it = flights_.find(key);
+		if (it != flights_.end())
+			return { it->second->future, false };
+
+		auto f = std::make_shared<flight>();
+		f->future = f->promise.get_future().share();
+		flights_.emplace(key, f);
+		return { f->future, true };
+	}
+
+	//term: publish the result where late callers look (a cache) before completing
+	void complete(const K& key, V value) {
+		if (auto f = take(key))
+			f->promise.set_value(std::move(value));
+	}
+	void fail(const K& key, std::exception_ptr e) {
+		if (auto f = take(key))
+			f->promise.set_exception(e);
+	}
+
+	template<typename F>
+	std::shared_future<V> run(const K& key, F&& work) {
+		auto [future, leader] = join(key);
+		if (leader) {
+			try {
+				complete(key, work());
+			}
+			catch (...) {
+				fail(key, std::current_exception());
+			}
+		}
+		return future;
+	}
+
+	size_t in_flight() {
+		std::unique_lock<std::mutex> lock(mutex_);
+		return flights_.size();
+	}
+protected:
+	struct flight {
+		std::promise<V> promise;
+		std::shared_future<V> future;
+	};
+	std::unordered_map<K, std::shared_ptr<flight>> flights_;
+	std::mutex mutex_;
+
+	std::shared_ptr<flight> take(const K& key) {
+		std::unique_lock<std::mutex> lock(mutex_);
+		auto it = flights_.find(key);
+		if (it == flights_.end())
+			return nullptr;
+		auto f = it->second;
+		flights_.erase(it);
+		return f;
+	}
+};
@@ -0,0 +1,51 @@
+#include "pch.h"
+#include "string_id.h"
+#include <shared_mutex>
+
+namespace {
+	//term: node based so interned names never move
+	struct string_registry {
+		std::unordered_map<uint64_t, std::string> names;
+		std::shared_mutex mutex;
+	};
+	string_registry& registry() {
+		static string_registry r;
+		return r;
+	}
+
+	const char* intern(uint64_t hash, std::string_view name) {
+		string_registry& r = registry();
+		{
+			std::shared_lock<std::shared_mutex> lock(r.mutex);
+			auto it = r.names.find(hash);
+			if (it != r.names.end()) {
+#ifdef _DEBUG
+				if (it->second != name)
+					throw std::logic_error("string_id collision: '" + it->second + "' and '" + std::string(name) + "'");
+#endif
+				return it->second.c_str();
+			}
+		}
+		std::unique_lock<std::shared_mutex> lock(r.mutex);
+		auto [it, inserted] = r.names.try_emplace(hash, name);
+#ifdef _DEBUG
+		//term: another thread may have interned a colliding name between the two locks
+		if (!inserted && it->second != name)
+			throw std::logic_error("string_id collision: '" + it->second + "' and '" + std::string(name) + "'");
+#endif
+		return it->second.c_str();
+	}
+}
+
+string_id::string_id(const std::string& s) : hash_(fnv1a_64(s)) {
+	name_ = intern(hash_, s);
+}
+string_id::string_id(const char* s) : hash_(fnv1a_64(s)) {
+	name_ = intern(hash_, s);
+}
+void string_id::check([[maybe_unused]] const string_id& id) {
+#ifdef _DEBUG
+	if (*id.name_)
+		intern(id.hash_, id.name_);
+#endif
+}
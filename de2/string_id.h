@@ -0,0 +1,58 @@
+#pragma once
+
+#include <string>
+#include <cstdint>
+#include <string_view>
+#include <functional>
+
+constexpr uint64_t fnv1a_64(std::string_view s) {
+	uint64_t h = 0xcbf29ce484222325ull;
+	for (char c : s)
+		h = (h ^ (unsigned char)c) * 0x100000001b3ull;
+	return h;
+}
+
+//term: strings are interned for the whole run, convert names, not per-asset keys
+//debug builds keep every name in a registry and throw on two names sharing a hash
+class string_id {
+	uint64_t hash_{ 0 };
+	const char* name_{ "" };
+public:
+	constexpr string_id() = default;
+	string_id(const std::string& s);
+	string_id(const char* s);
+
+	//term: not interned, c_str() is empty
+	static constexpr string_id hashed(std::string_view s) {
+		string_id id;
+		id.hash_ = fnv1a_64(s);
+		return id;
+	}
+	//term: the name must outlive the id
+	static constexpr string_id from_static(const char* name, size_t length) {
+		string_id id;
+		id.hash_ = fnv1a_64(std::string_view(name, length));
+		id.name_ = name;
+		return id;
+	}
+
+	constexpr uint64_t value() const { return hash_; }
+	constexpr const char* c_str() const { return name_; }
+	constexpr bool operator==(const string_id& other) const { return hash_ == other.hash_; }
+	constexpr bool operator!=(const string_id& other) const { return hash_ != other.hash_; }
+	constexpr bool operator<(const string_id& other) const { return hash_ < other.hash_; }
+
+	//term: no-op in release builds
+	static void check(const string_id& id);
+};
+
+namespace string_id_literals {
+	consteval string_id operator""_id(const char* name, size_t length) {
+		return string_id::from_static(name, length);
+	}
+}
+using namespace string_id_literals;
+
+template<> struct std::hash<string_id> {
+	size_t operator()(const string_id& id) const noexcept { return (size_t)id.value(); }
+};
@@ -0,0 +1,212 @@
+#include "pch.h"
+#include "texture_streamer.h"
+#include "de2.h"
+#include "tracer.h"
+
+texture_streamer::job::~job() {
+	std::free(pixels);
+}
+
+//term: stop() is what waits for the copies, the pool may already be gone here
+texture_streamer::~texture_streamer() {
+}
+
+bool texture_streamer::init(size_t block_bytes, size_t blocks) {
+	if (buffer_)
+		return true;
+	if (!glBufferStorage || block_bytes == 0 || blocks == 0)
+		return false;
+
+	const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+	glGenBuffers(1, &buffer_);
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer_);
+	glBufferStorage(GL_PIXEL_UNPACK_BUFFER, block_bytes * blocks, nullptr, flags);
+	mapped_ = (unsigned char*)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, block_bytes * blocks, flags);
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	if (!mapped_) {
+		glDeleteBuffers(1, &buffer_);
+		buffer_ = 0;
+		return false;
+	}
+	block_bytes_ = block_bytes;
+	for (size_t i = 0; i < blocks; i++) {
+		auto b = std::make_unique<block>();
+		b->offset = i * block_bytes;
+		blocks_.push_back(std::move(b));
+	}
+	return true;
+}
+
+void texture_streamer::submit(texture* target, GLuint name, int width, int height, int comp, int levels, unsigned char* pixels) {
+	if (!streams(width, height, comp))
+		throw std::invalid_argument("texture_streamer: texture can't be streamed");
+	auto j = std::make_shared<job>();
+	j->target = target;
+	j->name = name;
+	j->comp = comp;
+	j->levels = mip_levels(width, height, comp);
+	if (levels < 1 || levels > (int)j->levels.size())
+		throw std::invalid_argument("texture_streamer: bad level count");
+	j->levels.resize(levels);
+	j->bytes = j->levels.back().offset + j->levels.back().bytes;
+	j->pixels = pixels;
+	std::unique_lock<std::mutex> lock(mutex_);
+	jobs_.push_back(j);
+}
+
+bool texture_streamer::cancel(texture* target) {
+	std::unique_lock<std::mutex> lock(mutex_);
+	for (auto& j : jobs_) {
+		if (j->target == target) {
+			j->target = nullptr;
+			return true;
+		}
+	}
+	return false;
+}
+
+void texture_streamer::pump() {
+	if (!buffer_)
+		return;
+	DE2_TRACE_SCOPE("gl", "texture_streamer::pump");
+	auto begin = std::chrono::steady_clock::now();
+
+	for (auto& b : blocks_) {
+		if (b->state.load(std::memory_order_acquire) != block_state::in_flight)
+			continue;
+		if (glClientWaitSync(b->fence, 0, 0) == GL_TIMEOUT_EXPIRED)
+			continue;
+		glDeleteSync(b->fence);
+		b->fence = nullptr;
+		b->state.store(block_state::free, std::memory_order_release);
+	}
+
+	//term: bands whose copy has finished, up to the frame's byte budget
+	size_t issued = 0;
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer_);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	for (auto& b : blocks_) {
+		if (issued >= bytes_per_frame)
+			break;
+		if (b->state.load(std::memory_order_acquire) != block_state::ready)
+			continue;
+		job& j = *b->owner;
+		const mip_level& level = j.levels[b->level];
+		size_t bytes = (size_t)level.width * j.comp * b->rows;
+		glBindTexture(GL_TEXTURE_2D, j.name);
+		glTexSubImage2D(GL_TEXTURE_2D, (GLint)b->level, 0, b->y, level.width, b->rows, texture::pixel_format(j.comp), GL_UNSIGNED_BYTE, (const void*)b->offset);
+		b->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		b->state.store(block_state::in_flight, std::memory_order_release);
+		j.bytes_landed += bytes;
+		b->owner.reset();
+		issued += bytes;
+		stats_.bands++;
+		stats_.bytes += bytes;
+	}
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+	//term: landed jobs stay in jobs_ until land() hands them over, so cancel still finds them meanwhile
+	std::vector<std::shared_ptr<job>> landed;
+	{
+		std::unique_lock<std::mutex> lock(mutex_);
+		for (auto& j : jobs_)
+			if (j->bytes_landed == j->bytes)
+				landed.push_back(j);
+	}
+	for (auto& j : landed)
+		land(j);
+
+	//term: free blocks go to the oldest textures first, a band is as many rows as fit a block
+	std::unique_lock<std::mutex> lock(mutex_);
+	auto next_job = jobs_.begin();
+	for (auto& b : blocks_) {
+		if (b->state.load(std::memory_order_acquire) != block_state::free)
+			continue;
+		while (next_job != jobs_.end() && (*next_job)->next_level >= (*next_job)->levels.size())
+			++next_job;
+		if (next_job == jobs_.end())
+			break;
+		std::shared_ptr<job> j = *next_job;
+		const mip_level& level = j->levels[j->next_level];
+		size_t stride = (size_t)level.width * j->comp;
+		int rows = (int)std::min<size_t>(block_bytes_ / stride, (size_t)(level.height - j->next_row));
+		b->owner = j;
+		b->level = j->next_level;
+		b->y = j->next_row;
+		b->rows = rows;
+		j->next_row += rows;
+		if (j->next_row == level.height) {
+			j->next_level++;
+			j->next_row = 0;
+		}
+		b->state.store(block_state::copying, std::memory_order_relaxed);
+		copying_++;
+		block* target = b.get();
+		const unsigned char* source = j->pixels + level.offset + stride * b->y;
+		de2::get_instance().get_pool().enqueue([this, target, j, source, stride]() {
+			DE2_TRACE_SCOPE("loader", "texture_streamer::copy");
+			memcpy(mapped_ + target->offset, source, stride * target->rows);
+			target->state.store(block_state::ready, std::memory_order_release);
+			copying_--;
+		});
+	}
+	stats_.last_pump = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - begin);
+}
+
+//term: the job leaves jobs_ and reaches its texture under one lock, a texture being destroyed either cancels it first or sees the name
+void texture_streamer::land(const std::shared_ptr<job>& j) {
+	if (j->levels.size() == 1) {
+		glBindTexture(GL_TEXTURE_2D, j->name);
+		glGenerateMipmap(GL_TEXTURE_2D);
+		glBindTexture(GL_TEXTURE_2D, 0);
+	}
+	std::free(j->pixels);
+	j->pixels = nullptr;
+	stats_.textures++;
+
+	std::unique_lock<std::mutex> lock(mutex_);
+	jobs_.erase(std::find(jobs_.begin(), jobs_.end(), j));
+	if (j->target)
+		j->target->streamed(j->name);
+	else
+		glDeleteTextures(1, &j->name);
+}
+
+void texture_streamer::finish() {
+	while (pending() > 0) {
+		pump();
+		std::this_thread::yield();
+	}
+}
+
+void texture_streamer::stop() {
+	if (!buffer_)
+		return;
+	while (copying_.load() > 0)
+		std::this_thread::yield();
+	for (auto& b : blocks_)
+		if (b->fence)
+			glDeleteSync(b->fence);
+	blocks_.clear();
+	{
+		std::unique_lock<std::mutex> lock(mutex_);
+		for (auto& j : jobs_)
+			glDeleteTextures(1, &j->name);
+		jobs_.clear();
+	}
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer_);
+	glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	glDeleteBuffers(1, &buffer_);
+	buffer_ = 0;
+	mapped_ = nullptr;
+}
+
+size_t texture_streamer::pending() const {
+	std::unique_lock<std::mutex> lock(mutex_);
+	return jobs_.size();
+}
+
+texture_streamer::counts texture_streamer::stats() const {
+	return stats_;
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include "glad/glad.h"
+#include "mipmap.h"
+#include <deque>
+#include <mutex>
+#include <chrono>
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <cstdint>
+
+class texture;
+
+//term: pool threads copy row bands into a persistently mapped unpack buffer, the render thread uploads and fences them
+//the texture keeps no gl name until its last band has landed
+class texture_streamer {
+public:
+	struct counts {
+		uint64_t textures{ 0 }, bands{ 0 }, bytes{ 0 };
+		std::chrono::nanoseconds last_pump{ 0 };
+	};
+
+	texture_streamer() = default;
+	virtual ~texture_streamer();
+	texture_streamer(const texture_streamer& other) = delete;
+	texture_streamer& operator=(const texture_streamer& other) = delete;
+
+	//term: render thread; false without glBufferStorage, uploads stay synchronous then
+	bool init(size_t block_bytes = 8 << 20, size_t blocks = 8);
+	bool enabled() const { return buffer_ != 0; }
+	bool streams(int width, int height, int comp) const {
+		size_t stride = (size_t)width * comp;
+		return enabled() && stride * height >= min_streamed_bytes && stride <= block_bytes_;
+	}
+
+	//term: takes ownership of pixels (malloc'd); name already has storage for the levels
+	void submit(texture* target, GLuint name, int width, int height, int comp, int levels, unsigned char* pixels);
+	//term: any thread, from the texture's destructor; false when its name has already been handed over
+	bool cancel(texture* target);
+
+	//term: render thread, once per frame
+	void pump();
+	void finish();
+	//term: textures still pending stay without a name
+	void stop();
+
+	size_t pending() const;
+	counts stats() const;
+
+	size_t bytes_per_frame{ 32 << 20 };
+	size_t min_streamed_bytes{ 1 << 20 };
+protected:
+	struct job {
+		texture* target{ nullptr };
+		GLuint name{ 0 };
+		int comp{ 0 };
+		std::vector<mip_level> levels;
+		unsigned char* pixels{ nullptr };
+		size_t next_level{ 0 };
+		int next_row{ 0 };
+		size_t bytes_landed{ 0 }, bytes{ 0 };
+		~job();
+	};
+	enum class block_state { free, copying, ready, in_flight };
+	struct block {
+		size_t offset{ 0 };
+		std::atomic<block_state> state{ block_state::free };
+		GLsync fence{ nullptr };
+		std::shared_ptr<job> owner;
+		size_t level{ 0 };
+		int y{ 0 }, rows{ 0 };
+	};
+
+	void land(const std::shared_ptr<job>& j);
+
+	GLuint buffer_{ 0 };
+	unsigned char* mapped_{ nullptr };
+	size_t block_bytes_{ 0 };
+	std::vector<std::unique_ptr<block>> blocks_;
+	//term: guards jobs_ and their targets against cancel from other threads
+	mutable std::mutex mutex_;
+	std::deque<std::shared_ptr<job>> jobs_;
+	std::atomic<size_t> copying_{ 0 };
+	counts stats_;
+};
@@ -5,9 +5,18 @@
 #include <vector>
 #include <future>
 #include <queue>
+#include "tracer.h"
 
 class thread_pool {
+    static thread_pool*& current() {
+        thread_local thread_pool* pool = nullptr;
+        return pool;
+    }
     void loop_func() {
+        current() = this;
+#ifdef DE2_TRACING
+        tracer::set_thread_name("pool worker");
+#endif
         while (true) {
             std::function<void()> task;
             {
@@ -37,6 +46,11 @@ public:
         }
     }
 
+    //term: waiting on the pool from a worker can starve it
+    bool on_worker_thread() {
+        return current() == this;
+    }
+
     template<class F, class... Args>
     auto enqueue(F&& f, Args&&... args) -> std::future<decltype(f(std::forward<Args>(args)...))>
     {
@@ -47,9 +61,17 @@ public:
         std::future<decltype(f(std::forward<Args>(args)...))> result = task->get_future();
         {
             std::unique_lock<std::mutex> lock(queue_mutex_);
+#ifdef DE2_TRACING
+            tasks_.emplace([task, queued = tracer::now_ns()]() {
+                DE2_TRACE_COMPLETE("pool", "queue_wait", queued);
+                DE2_TRACE_SCOPE("pool", "task");
+                (*task)();
+            });
+#else
             tasks_.emplace([task]() {
                 (*task)();
             });
+#endif
         }
         
         cv_.notify_one();
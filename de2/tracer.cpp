@@ -0,0 +1,124 @@
+#include "pch.h"
+#include "tracer.h"
+#include <iomanip>
+
+namespace {
+	struct thread_buffer {
+		std::array<tracer::event, tracer::events_per_thread> events;
+		//term: head is written by the owning thread, tail by flush under the registry lock
+		std::atomic<uint64_t> head{ 0 }, tail{ 0 }, dropped{ 0 };
+		uint32_t tid{ 0 };
+		std::string name;
+	};
+	struct trace_registry {
+		std::mutex mutex;
+		std::vector<std::shared_ptr<thread_buffer>> buffers;
+		std::vector<std::pair<uint32_t, tracer::event>> flushed;
+	};
+	trace_registry& registry() {
+		static trace_registry r;
+		return r;
+	}
+
+	//term: buffers stay registered after their thread exits so nothing recorded is lost
+	thread_buffer& own_buffer() {
+		thread_local std::shared_ptr<thread_buffer> buffer;
+		if (!buffer) {
+			buffer = std::make_shared<thread_buffer>();
+			trace_registry& r = registry();
+			std::unique_lock<std::mutex> lock(r.mutex);
+			buffer->tid = (uint32_t)r.buffers.size() + 1;
+			r.buffers.push_back(buffer);
+		}
+		return *buffer;
+	}
+
+	void write_escaped(std::ostream& o, const std::string& s) {
+		for (char c : s) {
+			if (c == '"' || c == '\\')
+				o << '\\';
+			o << c;
+		}
+	}
+}
+
+std::atomic<bool> tracer::enabled_{ false };
+
+void tracer::complete(const char* category, const char* name, uint64_t begin_ns, uint64_t end_ns) {
+	thread_buffer& b = own_buffer();
+	uint64_t head = b.head.load(std::memory_order_relaxed);
+	if (head - b.tail.load(std::memory_order_acquire) >= events_per_thread) {
+		b.dropped.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+	b.events[head % events_per_thread] = { category, name, begin_ns, end_ns - begin_ns };
+	b.head.store(head + 1, std::memory_order_release);
+}
+
+void tracer::set_thread_name(const std::string& name) {
+	thread_buffer& b = own_buffer();
+	std::unique_lock<std::mutex> lock(registry().mutex);
+	b.name = name;
+}
+
+void tracer::flush() {
+	trace_registry& r = registry();
+	std::unique_lock<std::mutex> lock(r.mutex);
+	for (auto& b : r.buffers) {
+		uint64_t tail = b->tail.load(std::memory_order_relaxed), head = b->head.load(std::memory_order_acquire);
+		for (; tail < head; tail++)
+			r.flushed.push_back({ b->tid, b->events[tail % events_per_thread] });
+		b->tail.store(tail, std::memory_order_release);
+	}
+}
+
+void tracer::reset() {
+	flush();
+	std::unique_lock<std::mutex> lock(registry().mutex);
+	registry().flushed.clear();
+}
+
+std::string tracer::to_chrome_json() {
+	flush();
+	trace_registry& r = registry();
+	std::unique_lock<std::mutex> lock(r.mutex);
+
+	uint64_t origin = UINT64_MAX;
+	for (auto& [tid, e] : r.flushed)
+		origin = std::min(origin, e.begin_ns);
+
+	std::ostringstream o;
+	o << std::fixed << std::setprecision(3) << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+	bool first = true;
+	for (auto& b : r.buffers) {
+		if (b->name.empty())
+			continue;
+		o << (first ? "" : ",") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << b->tid << ",\"args\":{\"name\":\"";
+		write_escaped(o, b->name);
+		o << "\"}}";
+		first = false;
+	}
+	for (auto& [tid, e] : r.flushed) {
+		o << (first ? "" : ",") << "{\"name\":\"" << e.name << "\",\"cat\":\"" << e.category << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << tid
+			<< ",\"ts\":" << (e.begin_ns - origin) / 1000.0 << ",\"dur\":" << e.duration_ns / 1000.0 << "}";
+		first = false;
+	}
+	o << "]}";
+	return o.str();
+}
+
+void tracer::write_chrome_json(const std::string& path) {
+	std::ofstream f(path, std::ios::binary | std::ios::trunc);
+	if (!f.is_open())
+		throw std::runtime_error("tracer: can't write " + path);
+	f << to_chrome_json();
+}
+
+uint64_t tracer::dropped() {
+	trace_registry& r = registry();
+	std::unique_lock<std::mutex> lock(r.mutex);
+	uint64_t n = 0;
+	for (auto& b : r.buffers)
+		n += b->dropped.load(std::memory_order_relaxed);
+	return n;
+}
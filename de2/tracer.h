@@ -0,0 +1,63 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <cstdint>
+
+//term: each thread appends to its own ring without a lock; names and categories must be string literals
+class tracer {
+public:
+	struct event {
+		const char* category;
+		const char* name;
+		uint64_t begin_ns, duration_ns;
+	};
+
+	static void enable(bool on) { enabled_.store(on, std::memory_order_relaxed); }
+	static bool enabled() { return enabled_.load(std::memory_order_relaxed); }
+	static uint64_t now_ns() {
+		return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	static void complete(const char* category, const char* name, uint64_t begin_ns, uint64_t end_ns);
+	static void set_thread_name(const std::string& name);
+
+	//term: drained events are kept for export until reset
+	static void flush();
+	static void reset();
+	static std::string to_chrome_json();
+	static void write_chrome_json(const std::string& path);
+	static uint64_t dropped();
+
+	static constexpr size_t events_per_thread = 16384;
+protected:
+	static std::atomic<bool> enabled_;
+};
+
+class trace_scope {
+	const char* category_;
+	const char* name_;
+	uint64_t begin_;
+public:
+	trace_scope(const char* category, const char* name) : category_(category), name_(name), begin_(tracer::enabled() ? tracer::now_ns() : 0) {}
+	~trace_scope() {
+		if (begin_)
+			tracer::complete(category_, name_, begin_, tracer::now_ns());
+	}
+	trace_scope(const trace_scope& other) = delete;
+	trace_scope& operator=(const trace_scope& other) = delete;
+};
+
+#ifdef DE2_TRACING
+#define DE2_TRACE_CONCAT_(a, b) a##b
+#define DE2_TRACE_CONCAT(a, b) DE2_TRACE_CONCAT_(a, b)
+#define DE2_TRACE_SCOPE(category, name) trace_scope DE2_TRACE_CONCAT(trace_scope_, __LINE__)(category, name)
+#define DE2_TRACE_NOW() tracer::now_ns()
+#define DE2_TRACE_COMPLETE(category, name, begin_ns) (tracer::enabled() ? tracer::complete(category, name, begin_ns, tracer::now_ns()) : (void)0)
+#else
+#define DE2_TRACE_SCOPE(category, name) ((void)0)
+#define DE2_TRACE_NOW() uint64_t(0)
+#define DE2_TRACE_COMPLETE(category, name, begin_ns) ((void)0)
+#endif
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <map>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <memory>
+#include <vector>
+#include <functional>
+
+struct bench_result {
+	std::string name;
+	size_t iterations{ 0 };
+	double seconds{ 0 };
+	std::map<std::string, double> metrics;
+};
+
+using bench_func = std::function<void(std::vector<bench_result>& out)>;
+
+inline std::vector<std::pair<std::string, bench_func>>& bench_registry() {
+	static std::vector<std::pair<std::string, bench_func>> benches;
+	return benches;
+}
+struct bench_registrar {
+	bench_registrar(const std::string& group, bench_func f) {
+		bench_registry().emplace_back(group, f);
+	}
+};
+
+//term: DE2_BENCH(group) { out.push_back(...); } registers a group that main() runs by name
+#define DE2_BENCH(group) \
+	static void group##_bench(std::vector<bench_result>& out); \
+	static bench_registrar group##_registrar(#group, group##_bench); \
+	static void group##_bench(std::vector<bench_result>& out)
+
+template<typename F>
+double time_seconds(F&& f) {
+	auto begin = std::chrono::steady_clock::now();
+	f();
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+}
+
+//term: keeps the optimizer from dropping a result, the compiler must assume the value is read
+template<typename T>
+void do_not_optimize(T const& value) {
+#if defined(__GNUC__) || defined(__clang__)
+	asm volatile("" : : "r,m"(value) : "memory");
+#else
+	static volatile const void* sink;
+	sink = &value;
+	std::atomic_signal_fence(std::memory_order_seq_cst);
+#endif
+}
+
+//term: synthetic assets, generated in memory so every run measures the same input
+std::string make_sphere_obj(size_t rings, size_t segments);
+std::vector<unsigned char> make_bmp(int width, int height);
+//term: rgba png with stored deflate blocks, exercises the png path of the decoder without an encoder dependency
+std::vector<unsigned char> make_png(int width, int height);
+
+//term: hidden window with a current gl context, false when no display is available
+bool bench_gl_context();
+//term: textured, unlit program with model, view and projection uniforms; needs bench_gl_context
+class program;
+std::shared_ptr<program> make_bench_program();
+//term: gl_capture files named on the command line with --replay, replayed by the replay group
+std::vector<std::string>& bench_capture_files();
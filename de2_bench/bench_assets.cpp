@@ -0,0 +1,112 @@
+#include <cmath>
+#include <sstream>
+#include "bench.h"
+#include "../de2/disk_cache.h"
+
+std::string make_sphere_obj(size_t rings, size_t segments) {
+	const double pi = 3.14159265358979323846;
+	std::ostringstream o;
+	for (size_t r = 0; r <= rings; r++) {
+		double phi = pi * r / rings;
+		for (size_t s = 0; s <= segments; s++) {
+			double theta = 2 * pi * s / segments;
+			double x = std::sin(phi) * std::cos(theta), y = std::cos(phi), z = std::sin(phi) * std::sin(theta);
+			o << "v " << x << " " << y << " " << z << "\n";
+			o << "vt " << (double)s / segments << " " << (double)r / rings << "\n";
+			o << "vn " << x << " " << y << " " << z << "\n";
+		}
+	}
+	auto at = [&](size_t r, size_t s) { return r * (segments + 1) + s + 1; };
+	auto corner = [&](size_t i) { return std::to_string(i) + "/" + std::to_string(i) + "/" + std::to_string(i); };
+	for (size_t r = 0; r < rings; r++) {
+		for (size_t s = 0; s < segments; s++) {
+			size_t a = at(r, s), b = at(r + 1, s), c = at(r + 1, s + 1), d = at(r, s + 1);
+			o << "f " << corner(a) << " " << corner(b) << " " << corner(c) << "\n";
+			o << "f " << corner(a) << " " << corner(c) << " " << corner(d) << "\n";
+		}
+	}
+	return o.str();
+}
+
+namespace {
+	void put_le(std::vector<unsigned char>& out, uint32_t v, int bytes) {
+		for (int i = 0; i < bytes; i++)
+			out.push_back((unsigned char)(v >> (8 * i)));
+	}
+	void put_be(std::vector<unsigned char>& out, uint32_t v) {
+		for (int i = 3; i >= 0; i--)
+			out.push_back((unsigned char)(v >> (8 * i)));
+	}
+	unsigned char pattern(int x, int y, int c) {
+		return (unsigned char)((x * (c + 1) + y * (3 - c)) ^ (x >> 3) ^ (y << 1));
+	}
+	void put_chunk(std::vector<unsigned char>& out, const char* type, const std::vector<unsigned char>& data) {
+		put_be(out, (uint32_t)data.size());
+		size_t start = out.size();
+		out.insert(out.end(), type, type + 4);
+		out.insert(out.end(), data.begin(), data.end());
+		put_be(out, disk_cache::crc32(out.data() + start, out.size() - start));
+	}
+}
+
+std::vector<unsigned char> make_bmp(int width, int height) {
+	uint32_t row = ((uint32_t)width * 3 + 3) & ~3u, image = row * height;
+	std::vector<unsigned char> out;
+	out.push_back('B');
+	out.push_back('M');
+	put_le(out, 54 + image, 4);
+	put_le(out, 0, 4);
+	put_le(out, 54, 4);
+	put_le(out, 40, 4);
+	put_le(out, width, 4);
+	put_le(out, height, 4);
+	put_le(out, 1, 2);
+	put_le(out, 24, 2);
+	for (int i = 0; i < 6; i++)
+		put_le(out, 0, 4);
+	for (int y = 0; y < height; y++) {
+		for (int x = 0; x < width; x++)
+			for (int c = 0; c < 3; c++)
+				out.push_back(pattern(x, y, c));
+		out.resize(out.size() + row - width * 3, 0);
+	}
+	return out;
+}
+
+std::vector<unsigned char> make_png(int width, int height) {
+	std::vector<unsigned char> raw;
+	for (int y = 0; y < height; y++) {
+		raw.push_back(0);
+		for (int x = 0; x < width; x++)
+			for (int c = 0; c < 4; c++)
+				raw.push_back(c == 3 ? 255 : pattern(x, y, c));
+	}
+
+	std::vector<unsigned char> z = { 0x78, 0x01 };
+	for (size_t pos = 0; pos < raw.size() || pos == 0;) {
+		size_t n = std::min<size_t>(65535, raw.size() - pos);
+		z.push_back(pos + n == raw.size() ? 1 : 0);
+		put_le(z, (uint32_t)n, 2);
+		put_le(z, (uint32_t)~n & 0xffff, 2);
+		z.insert(z.end(), raw.begin() + pos, raw.begin() + pos + n);
+		pos += n;
+		if (n == 0)
+			break;
+	}
+	uint32_t a = 1, b = 0;
+	for (unsigned char c : raw) {
+		a = (a + c) % 65521;
+		b = (b + a) % 65521;
+	}
+	put_be(z, b << 16 | a);
+
+	std::vector<unsigned char> out = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+	std::vector<unsigned char> ihdr;
+	put_be(ihdr, width);
+	put_be(ihdr, height);
+	ihdr.insert(ihdr.end(), { 8, 6, 0, 0, 0 });
+	put_chunk(out, "IHDR", ihdr);
+	put_chunk(out, "IDAT", z);
+	put_chunk(out, "IEND", {});
+	return out;
+}
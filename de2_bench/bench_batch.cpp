@@ -0,0 +1,67 @@
+#include <atomic>
+#include <sstream>
+#include <filesystem>
+#include "bench.h"
+#include "../de2/batch_renderer.h"
+
+//term: offscreen thumbnails of one scene, images per second with and without png output
+DE2_BENCH(batch) {
+	if (!bench_gl_context()) {
+		std::cerr << "batch: no gl context, skipped" << std::endl;
+		return;
+	}
+	de2& engine = de2::get_instance();
+
+	auto prg = make_bench_program();
+	engine.programs["bench"_id] = prg;
+
+	auto shared_mesh = std::make_shared<mesh>();
+	std::istringstream obj(make_sphere_obj(16, 32));
+	shared_mesh->parse_obj(obj, true);
+	auto png = make_png(256, 256);
+	auto shared_texture = std::make_shared<texture>(png.data(), png.size());
+
+	ecs_s::registry world;
+	for (size_t i = 0; i < 100; i++) {
+		auto md = std::make_shared<texture_model>(shared_mesh, shared_texture);
+		md->attach_program(prg);
+		md->upload();
+		md->mat_model = glm::translate(glm::mat4(1.0f), glm::vec3((float)(i % 10) - 5, (float)(i / 10) - 5, -30));
+		ecs_s::entity e = world.new_entity();
+		world.add_component(e, std::shared_ptr<model>(md));
+		world.add_component(e, visible{});
+	}
+	auto cam = std::make_shared<euler_angle_orbit>();
+	auto dir = std::filesystem::temp_directory_path() / "de2_bench_batch";
+	std::filesystem::create_directories(dir);
+
+	batch_renderer batch;
+	for (int size : { 64, 256, 1024 }) {
+		for (bool write_png : { false, true }) {
+			const size_t jobs = size >= 1024 ? 64 : 256;
+			std::atomic<size_t> delivered{ 0 };
+			for (size_t i = 0; i < jobs; i++) {
+				render_job job;
+				job.world = &world;
+				job.cam = cam;
+				job.width = job.height = size;
+				if (write_png)
+					job.output_path = (dir / ("thumb_" + std::to_string(i % 16) + ".png")).string();
+				job.on_done = [&delivered](const render_job&, std::span<const unsigned char>) { delivered++; };
+				batch.submit(std::move(job));
+			}
+			batch_renderer::counts c = batch.run();
+
+			bench_result r;
+			r.name = std::to_string(size) + "x" + std::to_string(size) + (write_png ? "/png" : "/readback");
+			r.iterations = c.jobs;
+			r.seconds = c.seconds;
+			r.metrics["images_per_sec"] = c.images_per_sec();
+			r.metrics["failed"] = (double)(c.failed + c.jobs - delivered);
+			out.push_back(r);
+		}
+	}
+	std::filesystem::remove_all(dir);
+	engine.programs.erase("bench"_id);
+	engine.gl_deletions_.drain();
+}
@@ -0,0 +1,51 @@
+#include "bench.h"
+#include "../de2/de2.h"
+
+//term: per-frame camera math, view and projection plus the model-view-projection of a batch of objects
+DE2_BENCH(camera) {
+	const size_t frames = 1000000;
+	euler_angle_orbit cam;
+	double secs = time_seconds([&]() {
+		glm::mat4 acc(0.0f);
+		for (size_t i = 0; i < frames; i++)
+			acc += cam.getview();
+		do_not_optimize(acc);
+	});
+
+	bench_result r;
+	r.name = "euler_angle_orbit_getview";
+	r.iterations = frames;
+	r.seconds = secs;
+	r.metrics["ns_per_op"] = secs * 1e9 / frames;
+	out.push_back(r);
+
+	renderer_system renderer;
+	secs = time_seconds([&]() {
+		glm::mat4 acc(0.0f);
+		for (size_t i = 0; i < frames; i++)
+			acc += renderer.get_projection() * renderer.get_view();
+		do_not_optimize(acc);
+	});
+	r.name = "renderer_view_projection";
+	r.seconds = secs;
+	r.metrics["ns_per_op"] = secs * 1e9 / frames;
+	out.push_back(r);
+
+	std::vector<glm::mat4> models(1024), mvps(models.size());
+	for (size_t i = 0; i < models.size(); i++)
+		models[i] = glm::translate(glm::mat4(1.0f), glm::vec3((float)i, 0, 0)) * glm::eulerAngleXYZ(0.1f * i, 0.2f, 0.3f);
+	const size_t batches = 2000;
+	secs = time_seconds([&]() {
+		for (size_t b = 0; b < batches; b++) {
+			glm::mat4 vp = renderer.get_projection() * renderer.get_view();
+			for (size_t i = 0; i < models.size(); i++)
+				mvps[i] = vp * models[i];
+			do_not_optimize(mvps.data());
+		}
+	});
+	r.name = "mvp_batch/objects:1024";
+	r.iterations = batches * models.size();
+	r.seconds = secs;
+	r.metrics["ns_per_op"] = secs * 1e9 / r.iterations;
+	out.push_back(r);
+}
@@ -0,0 +1,56 @@
+#include "../de2/de2.h"
+#include "bench.h"
+
+namespace {
+	const char* vertex_source = R"(#version 330 core
+layout(location = 0) in vec3 position;
+layout(location = 1) in vec3 normal;
+layout(location = 2) in vec2 uv;
+uniform mat4 model, view, projection;
+out vec2 tex_uv;
+void main() { tex_uv = uv; gl_Position = projection * view * model * vec4(position, 1.0); }
+)";
+	const char* fragment_source = R"(#version 330 core
+in vec2 tex_uv;
+uniform sampler2D tex;
+out vec4 color;
+void main() { color = texture(tex, tex_uv); }
+)";
+}
+
+bool bench_gl_context() {
+	static bool ready = []() {
+		if (!glfwInit())
+			return false;
+		glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+		glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+		GLFWwindow* window = glfwCreateWindow(1024, 768, "de2_bench", nullptr, nullptr);
+		if (!window)
+			return false;
+		glfwMakeContextCurrent(window);
+		if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
+			return false;
+
+		de2& engine = de2::get_instance();
+		engine.window = window;
+		engine.gl_deletions_.set_owner_thread();
+		glEnable(GL_DEPTH_TEST);
+		glViewport(0, 0, 1024, 768);
+		return true;
+	}();
+	return ready;
+}
+
+std::shared_ptr<program> make_bench_program() {
+	auto prg = std::make_shared<program>();
+	vertex_shader vs;
+	vs.compile(vertex_source);
+	frag_shader fs;
+	fs.compile(fragment_source);
+	prg->attach_shader(vs);
+	prg->attach_shader(fs);
+	prg->link();
+	return prg;
+}
@@ -0,0 +1,99 @@
+#include <list>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <memory>
+#include <unordered_map>
+#include "bench.h"
+#include "../de2/lru_cache.hpp"
+
+//term: the previous global-lock cache with linear list scans, kept as the baseline
+template<typename K, typename V, size_t capacity = 8192> class legacy_lru_cache {
+public:
+	V get(K key) {
+		std::unique_lock<std::mutex> lock(cache_mutex);
+		auto it = data_.find(key);
+		if (it == data_.end())
+			throw std::range_error("no such item in the list");
+		auto oit = std::find(order_.begin(), order_.end(), key);
+		order_.splice(order_.begin(), order_, oit);
+		return it->second;
+	}
+	std::optional<V> try_get(K key) {
+		{
+			std::unique_lock<std::mutex> lock(cache_mutex);
+			if (data_.find(key) == data_.end())
+				return std::nullopt;
+		}
+		return get(key);
+	}
+	void put(K key, V val) {
+		std::unique_lock<std::mutex> lock(cache_mutex);
+		auto it = data_.find(key);
+		if (it == data_.end())
+			data_[key] = val;
+		else
+			order_.remove(key);
+		order_.push_front(key);
+		if (data_.size() > capacity) {
+			data_.erase(order_.back());
+			order_.pop_back();
+		}
+	}
+protected:
+	std::unordered_map<K, V> data_;
+	std::list<K> order_;
+	std::mutex cache_mutex;
+};
+
+namespace {
+	const size_t key_space = 8192;
+
+	//term: 90% lookups, 10% inserts over a warm cache of model-like keys
+	template<typename C>
+	bench_result run_cache(const std::string& name, size_t threads, size_t ops_per_thread) {
+		C cache;
+		std::vector<std::string> keys;
+		for (size_t i = 0; i < key_space; i++) {
+			keys.push_back("models/tile_" + std::to_string(i) + ".obj");
+			cache.put(keys.back(), std::make_shared<int>((int)i));
+		}
+
+		double secs = time_seconds([&]() {
+			std::vector<std::thread> workers;
+			for (size_t t = 0; t < threads; t++) {
+				workers.emplace_back([&, t]() {
+					std::mt19937 rng((unsigned)t + 1);
+					std::uniform_int_distribution<size_t> pick(0, key_space - 1);
+					size_t found = 0;
+					for (size_t i = 0; i < ops_per_thread; i++) {
+						const std::string& k = keys[pick(rng)];
+						if (i % 10 == 0)
+							cache.put(k, std::make_shared<int>((int)i));
+						else if (cache.try_get(k))
+							found++;
+					}
+					do_not_optimize(found);
+				});
+			}
+			for (auto& w : workers)
+				w.join();
+		});
+
+		bench_result r;
+		r.name = name + "/threads:" + std::to_string(threads);
+		r.iterations = threads * ops_per_thread;
+		r.seconds = secs;
+		r.metrics["mops_per_sec"] = r.iterations / secs / 1e6;
+		r.metrics["ns_per_op"] = secs * 1e9 / r.iterations;
+		return r;
+	}
+}
+
+DE2_BENCH(lru_cache) {
+	for (size_t threads : { 1, 2, 4, 8, 16 }) {
+		//term: the legacy cache scans its order list on every hit, fewer ops keep its runs short
+		out.push_back(run_cache<legacy_lru_cache<std::string, std::shared_ptr<int>>>("legacy", threads, 5000));
+		out.push_back(run_cache<thread_safe_lru_cache<std::string, std::shared_ptr<int>>>("sharded", threads, 200000));
+	}
+}
@@ -0,0 +1,31 @@
+#include <sstream>
+#include "bench.h"
+#include "../de2/de2.h"
+
+//term: mesh::parse_obj on uv spheres, from a small prop to a dense terrain tile
+DE2_BENCH(obj) {
+	for (size_t segments : { 16, 64, 192 }) {
+		std::string source = make_sphere_obj(segments / 2, segments);
+		size_t reps = std::max<size_t>(1, 2000000 / source.size());
+		size_t vertices = 0;
+
+		double secs = time_seconds([&]() {
+			for (size_t i = 0; i < reps; i++) {
+				mesh m;
+				std::istringstream in(source);
+				m.parse_obj(in, true);
+				vertices = m.vertices.size();
+				do_not_optimize(m.vertices.data());
+			}
+		});
+
+		bench_result r;
+		r.name = "parse/triangles:" + std::to_string(segments * segments);
+		r.iterations = reps;
+		r.seconds = secs;
+		r.metrics["ms_per_mesh"] = secs * 1000 / reps;
+		r.metrics["mb_per_sec"] = source.size() * reps / secs / 1e6;
+		r.metrics["vertices"] = (double)vertices;
+		out.push_back(r);
+	}
+}
@@ -0,0 +1,42 @@
+#include <filesystem>
+#include "bench.h"
+#include "../de2/de2.h"
+
+//term: render thread cost of frame_recorder::capture in steady state, the encoder writes to a temporary file meanwhile
+DE2_BENCH(recorder) {
+	if (!bench_gl_context()) {
+		std::cerr << "recorder: no gl context, skipped" << std::endl;
+		return;
+	}
+	de2& engine = de2::get_instance();
+	int width = 0, height = 0;
+	glfwGetFramebufferSize(engine.window, &width, &height);
+
+	for (auto [name, format] : { std::pair{ "raw", frame_recorder::output::raw }, std::pair{ "y4m", frame_recorder::output::y4m } }) {
+		std::string path = (std::filesystem::temp_directory_path() / (std::string("de2_bench_recorder.") + name)).string();
+		frame_recorder recorder;
+		recorder.start(path, format);
+		const size_t frames = 300;
+		double cost = 0;
+		double secs = time_seconds([&]() {
+			for (size_t f = 0; f < frames; f++) {
+				glClearColor((float)(f % 256) / 255.0f, 0.2f, 0.2f, 1.0f);
+				glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+				recorder.capture(width, height);
+				cost += recorder.stats().last_cost.count();
+				glfwSwapBuffers(engine.window);
+			}
+			recorder.stop();
+		});
+		frame_recorder::counts c = recorder.stats();
+
+		bench_result r;
+		r.name = std::string(name) + "/" + std::to_string(width) + "x" + std::to_string(height);
+		r.iterations = frames;
+		r.seconds = secs;
+		r.metrics["capture_us_per_frame"] = cost / 1000 / frames;
+		r.metrics["dropped"] = (double)c.dropped;
+		out.push_back(r);
+		std::filesystem::remove(path);
+	}
+}
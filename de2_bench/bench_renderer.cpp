@@ -0,0 +1,55 @@
+#include <sstream>
+#include "bench.h"
+#include "../de2/de2.h"
+
+//term: renderer_system::process on a hidden context, every entity draws its own texture_model over one shared mesh and texture
+DE2_BENCH(renderer) {
+	if (!bench_gl_context()) {
+		std::cerr << "renderer: no gl context, skipped" << std::endl;
+		return;
+	}
+	de2& engine = de2::get_instance();
+
+	auto prg = make_bench_program();
+	engine.programs["bench"_id] = prg;
+
+	auto shared_mesh = std::make_shared<mesh>();
+	std::istringstream obj(make_sphere_obj(16, 32));
+	shared_mesh->parse_obj(obj, true);
+	auto png = make_png(256, 256);
+	auto shared_texture = std::make_shared<texture>(png.data(), png.size());
+
+	renderer_system renderer;
+	for (size_t entities : { 100, 1000, 10000 }) {
+		ecs_s::registry world;
+		for (size_t i = 0; i < entities; i++) {
+			auto md = std::make_shared<texture_model>(shared_mesh, shared_texture);
+			md->attach_program(prg);
+			md->upload();
+			md->mat_model = glm::translate(glm::mat4(1.0f), glm::vec3((float)(i % 100) - 50, (float)(i / 100) - 50, -100));
+			ecs_s::entity e = world.new_entity();
+			world.add_component(e, std::shared_ptr<model>(md));
+			world.add_component(e, visible{});
+		}
+
+		std::chrono::nanoseconds interval{ 0 };
+		renderer.process(world, interval);
+		glFinish();
+		const size_t frames = std::max<size_t>(10, 20000 / entities);
+		double secs = time_seconds([&]() {
+			for (size_t f = 0; f < frames; f++)
+				renderer.process(world, interval);
+			glFinish();
+		});
+
+		bench_result r;
+		r.name = "process/entities:" + std::to_string(entities);
+		r.iterations = frames;
+		r.seconds = secs;
+		r.metrics["ms_per_frame"] = secs * 1000 / frames;
+		r.metrics["ns_per_entity"] = secs * 1e9 / (frames * entities);
+		out.push_back(r);
+	}
+	engine.programs.erase("bench"_id);
+	engine.gl_deletions_.drain();
+}
@@ -0,0 +1,87 @@
+#include <sstream>
+#include "bench.h"
+#include "../de2/de2.h"
+
+std::vector<std::string>& bench_capture_files() {
+	static std::vector<std::string> files;
+	return files;
+}
+
+namespace {
+	bench_result time_replay(const std::string& name, const std::vector<unsigned char>& stream) {
+		gl_replay replay(stream);
+		replay.run();
+		glFinish();
+		const size_t frames = std::max<size_t>(10, 2000000 / std::max<size_t>(1, replay.commands()));
+		double secs = time_seconds([&]() {
+			for (size_t f = 0; f < frames; f++)
+				replay.run();
+			glFinish();
+		});
+
+		bench_result r;
+		r.name = name;
+		r.iterations = frames;
+		r.seconds = secs;
+		r.metrics["commands"] = (double)replay.commands();
+		r.metrics["replay_ms_per_frame"] = secs * 1000 / frames;
+		r.metrics["calls_per_sec"] = replay.commands() * frames / secs;
+		r.metrics["capture_kb"] = stream.size() / 1024.0;
+		return r;
+	}
+}
+
+//term: captures renderer_system::process once and replays the stream, the gap between the two is engine cost above the driver
+//capture files given with --replay are replayed too
+DE2_BENCH(replay) {
+	if (!bench_gl_context()) {
+		std::cerr << "replay: no gl context, skipped" << std::endl;
+		return;
+	}
+	de2& engine = de2::get_instance();
+
+	auto prg = make_bench_program();
+	engine.programs["bench"_id] = prg;
+
+	auto shared_mesh = std::make_shared<mesh>();
+	std::istringstream obj(make_sphere_obj(16, 32));
+	shared_mesh->parse_obj(obj, true);
+	auto png = make_png(256, 256);
+	auto shared_texture = std::make_shared<texture>(png.data(), png.size());
+
+	renderer_system renderer;
+	for (size_t entities : { 1000, 10000 }) {
+		ecs_s::registry world;
+		for (size_t i = 0; i < entities; i++) {
+			auto md = std::make_shared<texture_model>(shared_mesh, shared_texture);
+			md->attach_program(prg);
+			md->upload();
+			md->mat_model = glm::translate(glm::mat4(1.0f), glm::vec3((float)(i % 100) - 50, (float)(i / 100) - 50, -100));
+			ecs_s::entity e = world.new_entity();
+			world.add_component(e, std::shared_ptr<model>(md));
+			world.add_component(e, visible{});
+		}
+
+		std::chrono::nanoseconds interval{ 0 };
+		gl_capture::begin();
+		renderer.process(world, interval);
+		std::vector<unsigned char> stream = gl_capture::end();
+		glFinish();
+
+		const size_t frames = std::max<size_t>(10, 20000 / entities);
+		double process_secs = time_seconds([&]() {
+			for (size_t f = 0; f < frames; f++)
+				renderer.process(world, interval);
+			glFinish();
+		});
+
+		bench_result r = time_replay("synthetic/entities:" + std::to_string(entities), stream);
+		r.metrics["process_ms_per_frame"] = process_secs * 1000 / frames;
+		out.push_back(r);
+	}
+	engine.programs.erase("bench"_id);
+	engine.gl_deletions_.drain();
+
+	for (auto& path : bench_capture_files())
+		out.push_back(time_replay("file/" + std::filesystem::path(path).filename().string(), gl_capture::load(path)));
+}
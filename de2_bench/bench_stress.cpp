@@ -0,0 +1,171 @@
+#include <cmath>
+#include <fstream>
+#include <sstream>
+#include "bench.h"
+#include "../de2/de2.h"
+#ifdef _WIN32
+#include <Windows.h>
+#include <psapi.h>
+#pragma comment(lib, "psapi.lib")
+#else
+#include <unistd.h>
+#endif
+
+namespace {
+	struct stress_config {
+		size_t entities, meshes, textures, programs;
+		//term: fraction of entities whose transform is rewritten every frame
+		double moving;
+	};
+
+	size_t resident_bytes() {
+#ifdef _WIN32
+		PROCESS_MEMORY_COUNTERS pmc{};
+		GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc));
+		return pmc.WorkingSetSize;
+#else
+		std::ifstream f("/proc/self/statm");
+		size_t pages = 0, resident = 0;
+		f >> pages >> resident;
+		return resident * (size_t)sysconf(_SC_PAGESIZE);
+#endif
+	}
+
+	//term: entities pick their mesh, texture and program round robin, the worst order for state changes
+	bench_result run_stress(const stress_config& c, renderer_system& renderer, size_t frames) {
+		de2& engine = de2::get_instance();
+		size_t rss_before = resident_bytes();
+
+		std::vector<std::shared_ptr<mesh>> meshes;
+		for (size_t i = 0; i < c.meshes; i++) {
+			auto m = std::make_shared<mesh>();
+			std::istringstream obj(make_sphere_obj(4 + i % 8, 8 + i % 16));
+			m->parse_obj(obj, true);
+			meshes.push_back(m);
+		}
+		std::vector<unsigned char> png = make_png(64, 64);
+		std::vector<std::shared_ptr<texture>> textures;
+		for (size_t i = 0; i < c.textures; i++)
+			textures.push_back(std::make_shared<texture>(png.data(), png.size()));
+		std::vector<string_id> program_names;
+		std::vector<std::shared_ptr<program>> programs;
+		for (size_t i = 0; i < c.programs; i++) {
+			program_names.push_back(string_id("stress_" + std::to_string(i)));
+			programs.push_back(make_bench_program());
+			engine.programs[program_names.back()] = programs.back();
+		}
+
+		ecs_s::registry world;
+		std::vector<std::shared_ptr<texture_model>> moving;
+		size_t moving_count = (size_t)(c.entities * c.moving);
+		for (size_t i = 0; i < c.entities; i++) {
+			auto md = std::make_shared<texture_model>(meshes[i % c.meshes], textures[i % c.textures]);
+			md->attach_program(programs[i % c.programs]);
+			md->upload();
+			md->mat_model = glm::translate(glm::mat4(1.0f), glm::vec3((float)(i % 200) - 100, (float)(i / 200 % 200) - 100, -150.0f));
+			if (i < moving_count)
+				moving.push_back(md);
+			ecs_s::entity e = world.new_entity();
+			world.add_component(e, std::shared_ptr<model>(md));
+			world.add_component(e, visible{});
+		}
+
+		size_t gpu = 0;
+		for (auto& m : meshes)
+			gpu += m->gpu_bytes();
+		for (auto& t : textures)
+			gpu += t->gpu_bytes();
+
+		std::chrono::nanoseconds interval{ 0 };
+		auto frame = [&](size_t f) {
+			render_stats::frame().reset();
+			float t = f * 0.016f;
+			for (size_t i = 0; i < moving.size(); i++)
+				moving[i]->mat_model[3].z = -150.0f + std::sin(t + (float)i);
+			renderer.process(world, interval);
+			glFinish();
+		};
+		for (size_t f = 0; f < 3; f++)
+			frame(f);
+		double secs = time_seconds([&]() {
+			for (size_t f = 0; f < frames; f++)
+				frame(f);
+		});
+		render_stats stats = render_stats::frame();
+
+		bench_result r;
+		r.name = "entities:" + std::to_string(c.entities) + "/meshes:" + std::to_string(c.meshes) + "/textures:" + std::to_string(c.textures)
+			+ "/programs:" + std::to_string(c.programs) + "/moving:" + std::to_string((int)(c.moving * 100));
+		r.iterations = frames;
+		r.seconds = secs;
+		r.metrics["ms_per_frame"] = secs * 1000 / frames;
+		r.metrics["draw_calls"] = (double)stats.draw_calls;
+		r.metrics["state_changes"] = (double)stats.state_changes();
+		r.metrics["uniform_uploads"] = (double)stats.uniform_uploads;
+		r.metrics["gpu_mb"] = gpu / 1e6;
+		r.metrics["rss_growth_mb"] = ((double)resident_bytes() - (double)rss_before) / 1e6;
+
+		for (auto& name : program_names)
+			engine.programs.erase(name);
+		return r;
+	}
+
+	//term: least squares slope of log(frame time) over log(entities), 1 is linear scaling
+	double scaling_exponent(const std::vector<std::pair<double, double>>& points) {
+		double n = (double)points.size(), sx = 0, sy = 0, sxx = 0, sxy = 0;
+		for (auto& [x, y] : points) {
+			double lx = std::log(x), ly = std::log(y);
+			sx += lx;
+			sy += ly;
+			sxx += lx * lx;
+			sxy += lx * ly;
+		}
+		double d = n * sxx - sx * sx;
+		return d != 0 ? (n * sxy - sx * sy) / d : 0;
+	}
+}
+
+//term: scaling curves, one dimension is swept at a time around a base scene
+DE2_BENCH(stress) {
+	if (!bench_gl_context()) {
+		std::cerr << "stress: no gl context, skipped" << std::endl;
+		return;
+	}
+	renderer_system renderer;
+	const size_t frames = 30;
+	const stress_config base{ 8000, 16, 16, 4, 0.1 };
+
+	std::vector<std::pair<double, double>> curve;
+	for (size_t entities : { 500, 2000, 8000, 32000 }) {
+		stress_config c = base;
+		c.entities = entities;
+		out.push_back(run_stress(c, renderer, frames));
+		curve.push_back({ (double)entities, out.back().metrics["ms_per_frame"] });
+	}
+	bench_result r;
+	r.name = "scaling/entities";
+	r.iterations = curve.size();
+	r.metrics["frame_time_exponent"] = scaling_exponent(curve);
+	out.push_back(r);
+
+	for (size_t meshes : { 1, 64, 256 }) {
+		stress_config c = base;
+		c.meshes = meshes;
+		out.push_back(run_stress(c, renderer, frames));
+	}
+	for (size_t textures : { 1, 64, 256 }) {
+		stress_config c = base;
+		c.textures = textures;
+		out.push_back(run_stress(c, renderer, frames));
+	}
+	for (size_t programs : { 1, 8, 32 }) {
+		stress_config c = base;
+		c.programs = programs;
+		out.push_back(run_stress(c, renderer, frames));
+	}
+	for (double moving : { 0.0, 0.5, 1.0 }) {
+		stress_config c = base;
+		c.moving = moving;
+		out.push_back(run_stress(c, renderer, frames));
+	}
+}
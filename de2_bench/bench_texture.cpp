@@ -0,0 +1,226 @@
+#include "bench.h"
+#include "../de2/de2.h"
+#include "../de2/mipmap.h"
+#include "../de2/ktx2.h"
+
+namespace {
+	bench_result run_decode(const std::string& format, const std::vector<unsigned char>& encoded, int size) {
+		size_t reps = std::max<size_t>(1, (64u << 20) / ((size_t)size * size * 4));
+		double secs = time_seconds([&]() {
+			for (size_t i = 0; i < reps; i++) {
+				texture t(encoded.data(), encoded.size());
+				do_not_optimize(t);
+			}
+		});
+
+		bench_result r;
+		r.name = "decode_" + format + "/" + std::to_string(size);
+		r.iterations = reps;
+		r.seconds = secs;
+		r.metrics["ms_per_image"] = secs * 1000 / reps;
+		r.metrics["mpixels_per_sec"] = (double)size * size * reps / secs / 1e6;
+		return r;
+	}
+}
+
+//term: decode through stb_image, upload with mipmaps on a hidden context when one is available
+DE2_BENCH(texture) {
+	for (int size : { 256, 1024, 2048 }) {
+		out.push_back(run_decode("bmp", make_bmp(size, size), size));
+		out.push_back(run_decode("png", make_png(size, size), size));
+	}
+
+	//term: offline block compression throughput, what de2_texconv spends per image and worker
+	for (auto [name, format] : { std::pair{ "bc1", bc_format::bc1 }, std::pair{ "bc3", bc_format::bc3 }, std::pair{ "bc5", bc_format::bc5 } }) {
+		const int size = 1024;
+		std::vector<unsigned char> rgba((size_t)size * size * 4);
+		for (size_t i = 0; i < rgba.size(); i++)
+			rgba[i] = (unsigned char)(i * 2654435761u >> 13);
+		double secs = time_seconds([&]() {
+			do_not_optimize(encode_bc(rgba.data(), size, size, format));
+		});
+		bench_result r;
+		r.name = std::string("encode_") + name + "/" + std::to_string(size);
+		r.iterations = 1;
+		r.seconds = secs;
+		r.metrics["mpixels_per_sec"] = (double)size * size / secs / 1e6;
+		out.push_back(r);
+	}
+
+	if (!bench_gl_context()) {
+		std::cerr << "texture: no gl context, upload skipped" << std::endl;
+		return;
+	}
+	for (int size : { 256, 1024, 2048 }) {
+		std::vector<unsigned char> encoded = make_png(size, size);
+		size_t reps = std::max<size_t>(1, (256u << 20) / ((size_t)size * size * 4));
+		std::vector<std::unique_ptr<texture>> textures;
+		for (size_t i = 0; i < reps; i++)
+			textures.push_back(std::make_unique<texture>(encoded.data(), encoded.size()));
+
+		double secs = time_seconds([&]() {
+			for (auto& t : textures)
+				t->upload();
+			glFinish();
+		});
+
+		bench_result r;
+		r.name = "upload/" + std::to_string(size);
+		r.iterations = reps;
+		r.seconds = secs;
+		r.metrics["ms_per_texture"] = secs * 1000 / reps;
+		r.metrics["mb_per_sec"] = (double)size * size * 4 * reps / secs / 1e6;
+		out.push_back(r);
+		textures.clear();
+		de2::get_instance().gl_deletions_.drain();
+	}
+
+	//term: mip chain by glGenerateMipmap on the render thread against append_mip_chain, which the engine runs on the pool, plus the upload of its levels
+	for (int size : { 1024, 2048, 4096 }) {
+		const size_t reps = std::max<size_t>(1, (256u << 20) / ((size_t)size * size * 4));
+		std::vector<unsigned char> base((size_t)size * size * 4);
+		for (size_t i = 0; i < base.size(); i++)
+			base[i] = (unsigned char)(i * 2654435761u >> 13);
+		std::vector<GLuint> names(reps);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+		glGenTextures((GLsizei)reps, names.data());
+		double driver = time_seconds([&]() {
+			for (GLuint name : names) {
+				glBindTexture(GL_TEXTURE_2D, name);
+				glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, size, size, 0, GL_RGBA, GL_UNSIGNED_BYTE, base.data());
+				glGenerateMipmap(GL_TEXTURE_2D);
+			}
+			glFinish();
+		});
+		glDeleteTextures((GLsizei)reps, names.data());
+
+		std::vector<unsigned char*> chains(reps, nullptr);
+		int levels = 1;
+		double build = time_seconds([&]() {
+			for (auto& chain : chains) {
+				chain = (unsigned char*)malloc(base.size());
+				memcpy(chain, base.data(), base.size());
+				chain = append_mip_chain(chain, size, size, 4, false, levels);
+			}
+		});
+		std::vector<mip_level> chain_levels = mip_levels(size, size, 4);
+		glGenTextures((GLsizei)reps, names.data());
+		double upload = time_seconds([&]() {
+			for (size_t i = 0; i < reps; i++) {
+				glBindTexture(GL_TEXTURE_2D, names[i]);
+				for (size_t l = 0; l < chain_levels.size(); l++)
+					glTexImage2D(GL_TEXTURE_2D, (GLint)l, GL_RGBA, chain_levels[l].width, chain_levels[l].height, 0, GL_RGBA, GL_UNSIGNED_BYTE, chains[i] + chain_levels[l].offset);
+			}
+			glFinish();
+		});
+		glDeleteTextures((GLsizei)reps, names.data());
+		glBindTexture(GL_TEXTURE_2D, 0);
+		for (auto chain : chains)
+			free(chain);
+
+		bench_result d;
+		d.name = "mips_driver/" + std::to_string(size);
+		d.iterations = reps;
+		d.seconds = driver;
+		d.metrics["render_ms_per_texture"] = driver * 1000 / reps;
+		out.push_back(d);
+
+		bench_result c;
+		c.name = "mips_cpu/" + std::to_string(size);
+		c.iterations = reps;
+		c.seconds = build + upload;
+		c.metrics["render_ms_per_texture"] = upload * 1000 / reps;
+		c.metrics["worker_ms_per_texture"] = build * 1000 / reps;
+		out.push_back(c);
+	}
+
+	//term: a bc1 ktx2 file against the same image as rgba8, both with a full mip chain
+	for (int size : { 1024, 2048 }) {
+		std::vector<unsigned char> png = make_png(size, size);
+		std::vector<unsigned char> file = ktx2::convert(png, nullptr, false);
+		for (bool compressed : { false, true }) {
+			const size_t reps = 16;
+			std::vector<std::unique_ptr<texture>> textures;
+			for (size_t i = 0; i < reps; i++)
+				textures.push_back(compressed ? std::make_unique<texture>(file.data(), file.size()) : std::make_unique<texture>(png.data(), png.size()));
+			double secs = time_seconds([&]() {
+				for (auto& t : textures)
+					t->upload();
+				glFinish();
+			});
+			bench_result r;
+			r.name = std::string(compressed ? "upload_ktx2_bc1/" : "upload_rgba8/") + std::to_string(size);
+			r.iterations = reps;
+			r.seconds = secs;
+			r.metrics["ms_per_texture"] = secs * 1000 / reps;
+			r.metrics["gpu_mb"] = textures[0]->gpu_bytes() / 1048576.0;
+			out.push_back(r);
+			textures.clear();
+			de2::get_instance().gl_deletions_.drain();
+		}
+	}
+
+	//term: time to first draw and gpu bytes of a 4096 texture uploaded whole and progressively, before any draw asks for finer levels
+	{
+		de2& engine = de2::get_instance();
+		std::vector<unsigned char> encoded = make_png(4096, 4096);
+		for (bool progressive : { false, true }) {
+			engine.mip_residency_.enabled = progressive;
+			auto t = std::make_unique<texture>(encoded.data(), encoded.size());
+			double secs = time_seconds([&]() {
+				t->upload();
+				glFinish();
+			});
+			bench_result r;
+			r.name = std::string(progressive ? "upload_progressive/" : "upload_full/") + "4096";
+			r.iterations = 1;
+			r.seconds = secs;
+			r.metrics["first_draw_ms"] = secs * 1000;
+			r.metrics["gpu_mb"] = t->gpu_bytes() / 1048576.0;
+			out.push_back(r);
+			t.reset();
+			engine.gl_deletions_.drain();
+		}
+		engine.mip_residency_.enabled = false;
+	}
+
+	//term: the same 4096 texture uploaded directly and through texture_uploads_, the streamed one is pumped once per simulated frame
+	de2& engine = de2::get_instance();
+	if (!engine.texture_uploads_.init()) {
+		std::cerr << "texture: no glBufferStorage, streamed upload skipped" << std::endl;
+		return;
+	}
+	const int size = 4096;
+	std::vector<unsigned char> encoded = make_png(size, size);
+	for (bool streamed : { false, true }) {
+		size_t min_streamed = engine.texture_uploads_.min_streamed_bytes;
+		if (!streamed)
+			engine.texture_uploads_.min_streamed_bytes = SIZE_MAX;
+		auto t = std::make_unique<texture>(encoded.data(), encoded.size());
+		double worst = 0;
+		size_t frames = 0;
+		double secs = time_seconds([&]() {
+			auto begin = std::chrono::steady_clock::now();
+			t->upload();
+			worst = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+			while (engine.texture_uploads_.pending() > 0) {
+				engine.texture_uploads_.pump();
+				worst = std::max(worst, engine.texture_uploads_.stats().last_pump.count() / 1e6);
+				frames++;
+			}
+			glFinish();
+		});
+		engine.texture_uploads_.min_streamed_bytes = min_streamed;
+
+		bench_result r;
+		r.name = std::string(streamed ? "upload_streamed/" : "upload_direct/") + std::to_string(size);
+		r.iterations = 1;
+		r.seconds = secs;
+		r.metrics["worst_frame_ms"] = worst;
+		r.metrics["pumps"] = (double)frames;
+		out.push_back(r);
+		t.reset();
+		engine.gl_deletions_.drain();
+	}
+}
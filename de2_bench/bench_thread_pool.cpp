@@ -0,0 +1,65 @@
+#include "bench.h"
+#include "../de2/thread_pool.h"
+#include "../de2/cache_stats.h"
+
+namespace {
+	bench_result latency_result(const std::string& name, const latency_histogram& h, double secs) {
+		latency_histogram::snapshot s = h.get_snapshot();
+		bench_result r;
+		r.name = name;
+		r.iterations = s.count;
+		r.seconds = secs;
+		r.metrics["mean_us"] = s.mean_ns() / 1000;
+		r.metrics["p50_us"] = s.percentile_ns(0.5) / 1000.0;
+		r.metrics["p99_us"] = s.percentile_ns(0.99) / 1000.0;
+		r.metrics["max_us"] = s.max_ns / 1000.0;
+		return r;
+	}
+}
+
+//term: enqueue throughput with empty tasks, and enqueue to start latency for an idle and for a saturated pool
+DE2_BENCH(thread_pool) {
+	for (size_t workers : { 1, 4, 8 }) {
+		//term: thread_pool(max) starts max + 1 workers
+		thread_pool pool(workers - 1);
+		const size_t tasks = 200000;
+		std::vector<std::future<void>> futures;
+		futures.reserve(tasks);
+
+		double secs = time_seconds([&]() {
+			for (size_t i = 0; i < tasks; i++)
+				futures.push_back(pool.enqueue([]() {}));
+			for (auto& f : futures)
+				f.get();
+		});
+
+		bench_result r;
+		r.name = "throughput/workers:" + std::to_string(workers);
+		r.iterations = tasks;
+		r.seconds = secs;
+		r.metrics["mtasks_per_sec"] = tasks / secs / 1e6;
+		r.metrics["ns_per_task"] = secs * 1e9 / tasks;
+		out.push_back(r);
+
+		latency_histogram idle;
+		secs = time_seconds([&]() {
+			for (size_t i = 0; i < 2000; i++) {
+				auto queued = std::chrono::steady_clock::now();
+				pool.enqueue([&idle, queued]() { idle.record(std::chrono::steady_clock::now() - queued); }).get();
+			}
+		});
+		out.push_back(latency_result("latency_idle/workers:" + std::to_string(workers), idle, secs));
+
+		latency_histogram burst;
+		futures.clear();
+		secs = time_seconds([&]() {
+			for (size_t i = 0; i < 20000; i++) {
+				auto queued = std::chrono::steady_clock::now();
+				futures.push_back(pool.enqueue([&burst, queued]() { burst.record(std::chrono::steady_clock::now() - queued); }));
+			}
+			for (auto& f : futures)
+				f.get();
+		});
+		out.push_back(latency_result("latency_burst/workers:" + std::to_string(workers), burst, secs));
+	}
+}
@@ -0,0 +1,123 @@
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <map>
+#include <sstream>
+#include "bench.h"
+#include "../de2/json.h"
+#include "../de2/gl_capture.h"
+
+namespace {
+	std::string to_json(const std::vector<std::pair<std::string, bench_result>>& results) {
+		std::ostringstream o;
+		o << std::setprecision(6) << "{\"results\":[";
+		for (size_t i = 0; i < results.size(); i++) {
+			auto& [group, r] = results[i];
+			o << (i ? "," : "") << "\n{\"group\":\"" << group << "\",\"name\":\"" << r.name << "\",\"iterations\":" << r.iterations
+				<< ",\"seconds\":" << r.seconds << ",\"metrics\":{";
+			bool first = true;
+			for (auto& [k, v] : r.metrics) {
+				o << (first ? "" : ",") << "\"" << k << "\":" << v;
+				first = false;
+			}
+			o << "}}";
+		}
+		o << "\n]}\n";
+		return o.str();
+	}
+
+	//term: lower is better for every metric except rates
+	bool higher_is_better(const std::string& metric) {
+		return metric.size() > 8 && metric.compare(metric.size() - 8, 8, "_per_sec") == 0;
+	}
+
+	//term: prints every metric that moved past threshold in the bad direction, returns how many did
+	size_t check_baseline(const std::string& path, const std::vector<std::pair<std::string, bench_result>>& results, double threshold) {
+		std::ifstream f(path, std::ios::binary);
+		if (!f.is_open())
+			throw std::runtime_error("can't read baseline " + path);
+		std::string text((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+		json_value baseline = json_value::parse(text);
+
+		std::map<std::string, const json_value*> previous;
+		for (auto& r : baseline["results"].items())
+			previous[r["group"].as_string() + "/" + r["name"].as_string()] = &r;
+
+		size_t regressions = 0;
+		for (auto& [group, r] : results) {
+			auto it = previous.find(group + "/" + r.name);
+			if (it == previous.end())
+				continue;
+			for (auto& [metric, value] : r.metrics) {
+				const json_value& old = (*it->second)["metrics"][metric];
+				if (old.is_null() || old.as_number() == 0)
+					continue;
+				double change = (value - old.as_number()) / std::abs(old.as_number());
+				if (higher_is_better(metric) ? change < -threshold : change > threshold) {
+					std::cout << "REGRESSION " << group << "/" << r.name << " " << metric << " " << old.as_number() << " -> " << value
+						<< " (" << std::showpos << std::setprecision(1) << change * 100 << std::noshowpos << "%)" << std::endl;
+					regressions++;
+				}
+			}
+		}
+		return regressions;
+	}
+}
+
+//usage: de2_bench [--json file] [--baseline file] [--threshold 0.1] [--replay capture]... [group...]   runs every registered group when none is given
+//       de2_bench --dump capture   prints a gl_capture file one call per line
+//groups: lru_cache obj texture thread_pool camera renderer stress replay recorder batch; the json file is meant to be diffed between releases
+//with a baseline json, metrics worse than threshold (relative) are reported and the exit code is 2
+int main(int argc, char** argv)
+{
+	std::vector<std::string> filter;
+	std::string json_path, baseline_path;
+	double threshold = 0.1;
+	for (int i = 1; i < argc; i++) {
+		if (std::string(argv[i]) == "--json" && i + 1 < argc)
+			json_path = argv[++i];
+		else if (std::string(argv[i]) == "--baseline" && i + 1 < argc)
+			baseline_path = argv[++i];
+		else if (std::string(argv[i]) == "--threshold" && i + 1 < argc)
+			threshold = atof(argv[++i]);
+		else if (std::string(argv[i]) == "--replay" && i + 1 < argc)
+			bench_capture_files().push_back(argv[++i]);
+		else if (std::string(argv[i]) == "--dump" && i + 1 < argc) {
+			std::cout << gl_capture::to_text(gl_capture::load(argv[++i]));
+			return 0;
+		}
+		else
+			filter.push_back(argv[i]);
+	}
+
+	std::vector<std::pair<std::string, bench_result>> all;
+	for (auto& [group, f] : bench_registry()) {
+		if (!filter.empty() && std::find(filter.begin(), filter.end(), group) == filter.end())
+			continue;
+
+		std::vector<bench_result> results;
+		f(results);
+		for (auto& r : results) {
+			std::cout << std::left << std::setw(48) << (group + "/" + r.name) << std::right
+				<< std::setw(12) << r.iterations << " it " << std::fixed << std::setprecision(3) << std::setw(10) << r.seconds * 1000 << " ms";
+			for (auto& [k, v] : r.metrics)
+				std::cout << "  " << k << "=" << std::setprecision(3) << v;
+			std::cout << std::endl;
+			all.push_back({ group, r });
+		}
+	}
+
+	if (!json_path.empty()) {
+		std::ofstream f(json_path, std::ios::binary | std::ios::trunc);
+		if (!f.is_open()) {
+			std::cerr << "can't write " << json_path << std::endl;
+			return 1;
+		}
+		f << to_json(all);
+	}
+	if (!baseline_path.empty() && check_baseline(baseline_path, all, threshold) > 0)
+		return 2;
+	return 0;
+}
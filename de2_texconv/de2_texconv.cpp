@@ -0,0 +1,113 @@
+#include <iostream>
+#include <fstream>
+#include <filesystem>
+#include <algorithm>
+#include <functional>
+#include <atomic>
+#include <mutex>
+#include "../de2/ktx2.h"
+#include "../de2/thread_pool.h"
+
+namespace {
+	std::mutex console_mutex;
+	const std::vector<std::string> source_types{ ".bmp", ".png", ".jpg", ".jpeg", ".tga", ".psd", ".gif", ".pnm" };
+
+	bool is_source(const std::filesystem::path& p) {
+		std::string ext = p.extension().string();
+		std::transform(ext.begin(), ext.end(), ext.begin(), [](char c) { return (char)tolower(c); });
+		return std::find(source_types.begin(), source_types.end(), ext) != source_types.end();
+	}
+
+	void convert(const std::filesystem::path& in, const std::filesystem::path& out, const bc_format* format, bool srgb, bool mips) {
+		std::ifstream f(in, std::ios::binary);
+		if (!f.is_open())
+			throw std::runtime_error("can't read " + in.string());
+		std::vector<unsigned char> encoded((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+		std::vector<unsigned char> file = ktx2::convert(encoded, format, srgb, mips);
+		std::ofstream o(out, std::ios::binary | std::ios::trunc);
+		if (!o.is_open())
+			throw std::runtime_error("can't write " + out.string());
+		o.write((const char*)file.data(), file.size());
+		std::unique_lock<std::mutex> lock(console_mutex);
+		std::cout << in.string() << " -> " << out.string() << " (" << encoded.size() << " -> " << file.size() << " bytes)" << std::endl;
+	}
+}
+
+//usage: de2_texconv [--format bc1|bc3|bc4|bc5] [--srgb] [--no-mips] [-o output] input...
+//every input is written next to itself with a .ktx2 extension, -o names the output of a single file; directories are converted recursively
+//without --format, images with any translucent texel become bc3 and the rest bc1; --srgb filters the mips of color formats in linear space
+int main(int argc, char** argv)
+{
+	bc_format format = bc_format::bc1;
+	bool has_format = false, srgb = false, mips = true;
+	std::string output;
+	std::vector<std::filesystem::path> inputs;
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		if (arg == "--format" && i + 1 < argc) {
+			std::string f = argv[++i];
+			has_format = true;
+			if (f == "bc1") format = bc_format::bc1;
+			else if (f == "bc3") format = bc_format::bc3;
+			else if (f == "bc4") format = bc_format::bc4;
+			else if (f == "bc5") format = bc_format::bc5;
+			else {
+				std::cerr << "unknown format " << f << std::endl;
+				return 1;
+			}
+		}
+		else if (arg == "--srgb")
+			srgb = true;
+		else if (arg == "--no-mips")
+			mips = false;
+		else if (arg == "-o" && i + 1 < argc)
+			output = argv[++i];
+		else
+			inputs.push_back(arg);
+	}
+
+	std::vector<std::pair<std::filesystem::path, std::filesystem::path>> jobs;
+	for (auto& in : inputs) {
+		if (std::filesystem::is_directory(in)) {
+			for (auto& e : std::filesystem::recursive_directory_iterator(in))
+				if (e.is_regular_file() && is_source(e.path()))
+					jobs.push_back({ e.path(), std::filesystem::path(e.path()).replace_extension(".ktx2") });
+		}
+		else {
+			jobs.push_back({ in, std::filesystem::path(in).replace_extension(".ktx2") });
+		}
+	}
+	if (jobs.empty()) {
+		std::cerr << "usage: de2_texconv [--format bc1|bc3|bc4|bc5] [--srgb] [--no-mips] [-o output] input..." << std::endl;
+		return 1;
+	}
+	if (!output.empty()) {
+		if (jobs.size() != 1) {
+			std::cerr << "-o needs a single input file" << std::endl;
+			return 1;
+		}
+		jobs[0].second = output;
+	}
+
+	//term: one image per worker, block compression dominates and every image is independent
+	std::atomic<int> failed{ 0 };
+	{
+		thread_pool pool;
+		std::vector<std::future<void>> done;
+		for (auto& [in, out] : jobs) {
+			done.push_back(pool.enqueue([&, in, out]() {
+				try {
+					convert(in, out, has_format ? &format : nullptr, srgb, mips);
+				}
+				catch (const std::exception& e) {
+					std::unique_lock<std::mutex> lock(console_mutex);
+					std::cerr << in.string() << ": " << e.what() << std::endl;
+					failed++;
+				}
+			}));
+		}
+		for (auto& f : done)
+			f.wait();
+	}
+	return failed > 0 ? 1 : 0;
+}